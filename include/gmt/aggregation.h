@@ -62,6 +62,19 @@ typedef struct cmd_block_t {
     block_info_t block_info;
     uint8_t * cmds;
     ag_data_t * data_array;
+    /* with agg_combine, destination node (high 32 bits) and offset + 1 in 
+     * cmds (low 32 bits) of the last put value or atomic add for each slot
+     * (0 if empty), comb_used slots are set */
+    uint64_t * comb_slots;
+    uint32_t comb_used;
+    /* offset + 1 in cmds of the last GMT_CMD_ROUTE header (0 if none) */
+    uint32_t route_pos;
+    /* encoder state of the compact commands in the block */
+    cmd_c_state_t c_state;
+    /* offset + 1 in cmds of the last GMT_CMD_GATHER header (0 if none) */
+    uint32_t gather_pos;
+    /* offset + 1 in cmds of the last GMT_CMD_SCATTER header (0 if none) */
+    uint32_t scatter_pos;
 } cmd_block_t;
 
 DEFINE_QUEUE_MPMC(cmdb_queue, cmd_block_t *, NUM_CMD_BLOCKS);
@@ -83,9 +96,23 @@ typedef struct agm_t {
     /* bytes equivalent in the queue */
     int32_t equiv_bytes;
 
+    /* bytes pushed since the start, for the arrival rate (only counted 
+     * with agg_min_deadline) */
+    volatile uint64_t pushed_bytes;
+
     /* tick when last aggregation was performed for this node */
     uint64_t tick;
 
+    /* adaptive flush deadline in ticks (see agm_adapt_deadline), the bytes
+     * pushed since the last update give the arrival rate */
+    volatile uint32_t deadline;
+    uint64_t ctl_pushed;
+    uint64_t ctl_tick;
+
+    /* command blocks, pool, queues and p_cmdbs are allocated (ready) on
+     * first use when routing through proxies, see agm_init_blocks */
+    volatile uint32_t init_lock;
+    volatile bool ready;
 } agm_t;
 
 /* Array of  node_aggreg structs (one for each remote node ) */
@@ -93,6 +120,35 @@ extern agm_t *agms;
 
 void aggreg_init();
 void aggreg_destroy();
+void agm_init_blocks(uint32_t rnid);
+#if !ENABLE_HELPER_BUFF_COPY
+void helper_release_recv_buff(uint32_t hid);
+#endif
+
+/* thid is about to wait for a buffer or a block to be sent, helpers must
+ * not hold a receive buffer meanwhile */
+INLINE void agm_before_wait(uint32_t thid)
+{
+#if !ENABLE_HELPER_BUFF_COPY
+    if (thid >= NUM_WORKERS && thid < NUM_WORKERS + NUM_HELPERS)
+        helper_release_recv_buff(thid - NUM_WORKERS);
+#endif
+}
+
+/* Two-level routing: with route_group_size != 0 nodes are split in groups 
+ * of that many consecutive ids. Commands without payload for a node of 
+ * another group go to the proxy of that group, the member with the same 
+ * index in its group as this node, which forwards them. Each node then 
+ * aggregates towards its own group and one proxy per group only */
+INLINE uint32_t agm_route(uint32_t rnid)
+{
+    uint32_t g = config.route_group_size;
+    if (g == 0 || rnid / g == node_id / g)
+        return rnid;
+    uint32_t first = rnid - rnid % g;
+    uint32_t size = MIN(g, num_nodes - first);
+    return first + (node_id % g) % size;
+}
 
 /* Get the next command pointer from the current block */
 INLINE void *agm_get_cmd_na(uint32_t rnid, uint32_t thid,
@@ -104,6 +160,8 @@ INLINE void *agm_get_cmd_na(uint32_t rnid, uint32_t thid,
     _assert(thid <= NUM_HELPERS + NUM_WORKERS);
 
     net_buffer_t *buff = comm_server_pop_send_buff(thid);
+    if (buff == NULL)
+        agm_before_wait(thid);
     while (buff == NULL)
         buff = comm_server_pop_send_buff(thid);
 
@@ -153,19 +211,160 @@ INLINE uint32_t agm_get_cmdb_eq_bytes(cmd_block_t * cmdb)
         cmdb->block_info.data_bytes + sizeof(block_info_t);
 }
 
+/* get a send buffer of class c, if it is a timeout then no need to try 
+ * again to get a buff */
+INLINE net_buffer_t *agm_pop_send_buff(uint32_t c, uint32_t thid,
+                                       bool is_timeout)
+{
+    net_buffer_t *buff = comm_server_pop_class_send_buff(c, thid);
+    if (buff == NULL && !is_timeout)
+        agm_before_wait(thid);
+    while (buff == NULL && !is_timeout)
+        buff = comm_server_pop_class_send_buff(c, thid);
+    return buff;
+}
+
+/* copy a command block and its data into the buffer */
+INLINE void agm_append_cmdb(net_buffer_t * buff, cmd_block_t * cmdb)
+{
+    netbuffer_append(buff, &cmdb->block_info, sizeof(block_info_t));
+    netbuffer_append(buff, cmdb->cmds, cmdb->block_info.cmds_bytes);
+    uint32_t i;
+    for (i = 0; i < cmdb->data_cnt; i++)
+        netbuffer_append(buff, cmdb->data_array[i].ptr,
+                         cmdb->data_array[i].size);
+}
+
+/* scatter-gather version, commands and data of at least sg_min_bytes are
+ * left in place. Returns true if the commands are, the block then goes back
+ * into the pool when the send completes */
+INLINE bool agm_append_cmdb_sg(net_buffer_t * buff, cmd_block_t * cmdb)
+{
+    netbuffer_sg_copy(buff, &cmdb->block_info, sizeof(block_info_t));
+    bool hold = false;
+    if (cmdb->block_info.cmds_bytes >= config.sg_min_bytes)
+        hold = netbuffer_sg_ref(buff, cmdb->cmds, cmdb->block_info.cmds_bytes);
+    else
+        netbuffer_sg_copy(buff, cmdb->cmds, cmdb->block_info.cmds_bytes);
+    if (hold) {
+        buff->sg_hold[buff->sg_hold_cnt++] = cmdb;
+        INCR_EVENT(AGGREGATION_SG_BYTES, cmdb->block_info.cmds_bytes);
+    }
+
+    uint32_t i;
+    for (i = 0; i < cmdb->data_cnt; i++) {
+        ag_data_t *d = &cmdb->data_array[i];
+        if (d->size < config.sg_min_bytes)
+            netbuffer_sg_copy(buff, d->ptr, d->size);
+        else if (netbuffer_sg_ref(buff, d->ptr, d->size)) {
+            INCR_EVENT(AGGREGATION_SG_BYTES, d->size);
+        }
+    }
+    return hold;
+}
+
+/* give back the command blocks of a completed scatter-gather send */
+INLINE void agm_sg_release(net_buffer_t * buff)
+{
+    uint32_t i;
+    for (i = 0; i < buff->sg_hold_cnt; i++)
+        cmdb_queue_push(&agms[buff->rnode_id].pool_cmdb,
+                        (cmd_block_t *) buff->sg_hold[i]);
+    netbuffer_sg_reset(buff);
+}
+
+/* command block of thid being filled for rnid, NULL if there is none or 
+ * the blocks of rnid are not allocated yet */
+INLINE cmd_block_t *agm_open_cmdb(uint32_t rnid, uint32_t thid)
+{
+    return agms[rnid].ready ? agms[rnid].p_cmdbs[thid] : NULL;
+}
+
+/* bytes of the command blocks queued for rnid */
+INLINE int64_t agm_queued_bytes(uint32_t rnid)
+{
+    return agms[rnid].equiv_bytes;
+}
+
+/* bytes pushed for rnid since the start */
+INLINE uint64_t agm_pushed_bytes(uint32_t rnid)
+{
+    return agms[rnid].pushed_bytes;
+}
+
+/* a buffer for rnid of the smallest class that holds nbytes */
+INLINE net_buffer_t *agm_start_buff(uint32_t rnid, uint32_t thid,
+                                    int64_t nbytes, bool is_timeout)
+{
+    uint32_t c = comm_server_buff_class((uint32_t)
+                                        MIN(MAX(nbytes, 0), COMM_BUFFER_SIZE));
+    net_buffer_t *buff = agm_pop_send_buff(c, thid, is_timeout);
+    if (buff != NULL) {
+        netbuffer_sg_reset(buff);
+        buff->rnode_id = rnid;
+    }
+    return buff;
+}
+
+/* the queue changed after the class of buff was picked and a block of
+ * eq_bytes does not fit, move to the class that holds it (the unused buffer
+ * stays current in its channel) */
+INLINE net_buffer_t *agm_fit_buff(net_buffer_t * buff, uint32_t thid,
+                                  uint32_t eq_bytes, bool is_timeout)
+{
+    if (buff->num_bytes == 0 && eq_bytes > buff->size) {
+        net_buffer_t *b = agm_start_buff(buff->rnode_id, thid, eq_bytes,
+                                         is_timeout);
+        if (b != NULL)
+            return b;
+    }
+    return buff;
+}
+
+/* append cmdb to buff, the block goes back to the pool unless the buffer
+ * still references it */
+INLINE void agm_aggregate_cmdb(net_buffer_t * buff, cmd_block_t * cmdb)
+{
+    bool hold = false;
+    if (netbuffer_has_sg(buff))
+        hold = agm_append_cmdb_sg(buff, cmdb);
+    else
+        agm_append_cmdb(buff, cmdb);
+
+    INCR_EVENT(AGGREGATION_CMD_BYTES, cmdb->block_info.cmds_bytes);
+    INCR_EVENT(AGGREGATION_DATA_BYTES, cmdb->block_info.data_bytes);
+    INCR_EVENT(AGGREGATION_BLOCK_INFO_BYTES, sizeof(block_info_t));
+
+    /* cmd_block empty put back into pool */
+    if (!hold)
+        cmdb_queue_push(&agms[buff->rnode_id].pool_cmdb, cmdb);
+}
+
+INLINE int32_t agm_send_aggregated(net_buffer_t * buff, bool is_timeout)
+{
+    if (buff->num_bytes > 0) {
+        netbuffer_sg_close(buff);
+        comm_server_push_buff_send(buff);
+        if (is_timeout) {
+            COUNT_EVENT(AGGREGATION_ON_TIMEOUT);
+        }
+        INCR_EVENT(AGGREGATION_BYTE_WASTE, buff->size - buff->num_bytes);
+    }
+    return buff->num_bytes;
+}
+
 /* Aggregate for a given remote node and send buffer */
 INLINE int32_t agm_aggregate_and_send(uint32_t rnid, uint32_t thid,
                                       bool is_timeout)
 {
-    /* try to get a buffer */
-    net_buffer_t *buff = comm_server_pop_send_buff(thid);
-    /* if it is a timeout then no need to try again to get a buff */
-    if (buff == NULL && is_timeout) {
-        return -1;
-    }
+    if (!agms[rnid].ready)
+        return 0;
 
-    while (buff == NULL) {      /* keep trying */
-        buff = comm_server_pop_send_buff(thid);
+    /* try to get a buffer of the smallest class that fits what is queued */
+    net_buffer_t *buff = agm_start_buff(rnid, thid, agms[rnid].equiv_bytes,
+                                        is_timeout);
+    if (buff == NULL) {
+        return -1;
     }
 
     int32_t rbytes = __sync_fetch_and_sub(&agms[rnid].equiv_bytes,
@@ -176,8 +375,6 @@ INLINE int32_t agm_aggregate_and_send(uint32_t rnid, uint32_t thid,
         return -2;
     }
 
-    buff->num_bytes = 0;
-    buff->rnode_id = rnid;
     cmd_block_t *cmdb;
 
     while (cmdb_queue_pop(&agms[rnid].queue_cmdb, &cmdb)) {
@@ -188,30 +385,17 @@ INLINE int32_t agm_aggregate_and_send(uint32_t rnid, uint32_t thid,
 //              cmdb->block_info.data_bytes);
 
         /* _assert equivalent bytes of cmd_block is <= buffer size */
-        _assert(agm_get_cmdb_eq_bytes(cmdb) <= COMM_BUFFER_SIZE);
-
-        if (buff->num_bytes + agm_get_cmdb_eq_bytes(cmdb) <= COMM_BUFFER_SIZE) {
-
-            /* copy block_info and commands */
-            netbuffer_append(buff, &cmdb->block_info, sizeof(block_info_t));
-            netbuffer_append(buff, cmdb->cmds, cmdb->block_info.cmds_bytes);
-
-            /* copy all data from memory */
-            uint32_t i;
-            for (i = 0; i < cmdb->data_cnt; i++) {
-                netbuffer_append(buff, cmdb->data_array[i].ptr,
-                                 cmdb->data_array[i].size);
-            }
+        uint32_t eq_bytes = agm_get_cmdb_eq_bytes(cmdb);
+        _assert(eq_bytes <= COMM_BUFFER_SIZE);
 
-            INCR_EVENT(AGGREGATION_CMD_BYTES, cmdb->block_info.cmds_bytes);
-            INCR_EVENT(AGGREGATION_DATA_BYTES, cmdb->block_info.data_bytes);
-            INCR_EVENT(AGGREGATION_BLOCK_INFO_BYTES, sizeof(block_info_t));
+        buff = agm_fit_buff(buff, thid, eq_bytes, is_timeout);
 
-            /* cmd_block empty put back into pool */
-            cmdb_queue_push(&agms[rnid].pool_cmdb, cmdb);
+        if (buff->num_bytes + eq_bytes <= buff->size) {
+            agm_aggregate_cmdb(buff, cmdb);
         } else {
-            /* this is impossible, a cmdb should always fit in an empty buffer */
-            _assert(buff->num_bytes != 0);
+            /* this is impossible, a cmdb should always fit in an empty buffer
+             * of its class (unless no such buffer is free on a timeout) */
+            _assert(buff->num_bytes != 0 || is_timeout);
             /* cmdb has not been aggregated on buffer, put back into the queue */
             cmdb_queue_push(&agms[rnid].queue_cmdb, cmdb);
             break;
@@ -224,19 +408,12 @@ INLINE int32_t agm_aggregate_and_send(uint32_t rnid, uint32_t thid,
                                    COMM_BUFFER_SIZE - buff->num_bytes);
     }
 
-    if (buff->num_bytes > 0) {
-        comm_server_push_send_buff(thid);
-        if (is_timeout) {
-            COUNT_EVENT(AGGREGATION_ON_TIMEOUT);
-        }
-        INCR_EVENT(AGGREGATION_BYTE_WASTE, COMM_BUFFER_SIZE - buff->num_bytes);
-    }
-    return buff->num_bytes;
+    return agm_send_aggregated(buff, is_timeout);
 }
 
-INLINE int32_t agm_push_cmdb(uint32_t rnid, uint32_t thid, bool is_timeout)
+INLINE int64_t agm_push_cmdb(uint32_t rnid, uint32_t thid, bool is_timeout)
 {
-    cmd_block_t *cmdb = agms[rnid].p_cmdbs[thid];
+    cmd_block_t *cmdb = agm_open_cmdb(rnid, thid);
     if (cmdb == NULL)
         return 0;
 
@@ -246,10 +423,13 @@ INLINE int32_t agm_push_cmdb(uint32_t rnid, uint32_t thid, bool is_timeout)
     agms[rnid].p_cmdbs[thid] = NULL;
     _assert(cmdb->tick > 0);
     _assert(cmdb->block_info.cmds_bytes > 0);
+    uint32_t eq_bytes = agm_get_cmdb_eq_bytes(cmdb);
     cmdb_queue_push(&agms[rnid].queue_cmdb, cmdb);
-    int32_t ret = __sync_fetch_and_add(&agms[rnid].equiv_bytes,
-                                       agm_get_cmdb_eq_bytes(cmdb));
-    if (ret >= (int32_t) COMM_BUFFER_SIZE) {
+    /* only the adaptive deadline reads the arrival rate */
+    if (config.agg_min_deadline != 0)
+        (void)__sync_fetch_and_add(&agms[rnid].pushed_bytes, eq_bytes);
+    int64_t ret = __sync_fetch_and_add(&agms[rnid].equiv_bytes, eq_bytes);
+    if (ret >= (int64_t) COMM_BUFFER_SIZE) {
         int bytes = agm_aggregate_and_send(rnid, thid, is_timeout);
         if (bytes > 0) {
             COUNT_EVENT(AGGREGATION_ON_FULLBLOCK);
@@ -274,17 +454,63 @@ INLINE void agm_force_aggr_a(int32_t rnid, uint32_t thid)
     }
 }
 
+/* Adaptive flush deadline of rnid. Waiting about as long as the queue of
+ * rnid takes to fill a buffer at the current arrival rate sends full 
+ * buffers, but while uthreads wait for replies every tick of delay is idle 
+ * time, so the deadline shrinks with the fraction of live uthreads that are
+ * waiting. The result is clamped to [agg_min_deadline, 
+ * node_agg_check_interv] and smoothed over the previous updates. */
+INLINE void agm_adapt_deadline(uint32_t rnid, uint64_t tick,
+                               uint32_t live, uint32_t waiting)
+{
+    agm_t *agm = &agms[rnid];
+    uint64_t elapsed = tick - agm->ctl_tick;
+    if (elapsed < config.agg_min_deadline)
+        return;
+    agm->ctl_tick = tick;
+    uint64_t pushed = agm_pushed_bytes(rnid);
+    uint64_t bytes = pushed - agm->ctl_pushed;
+    agm->ctl_pushed = pushed;
+
+    uint64_t target = config.node_agg_check_interv;
+    if (bytes > 0) {
+        int64_t queued = MAX(agm_queued_bytes(rnid), 0);
+        uint64_t missing = COMM_BUFFER_SIZE -
+            MIN((uint64_t) queued, COMM_BUFFER_SIZE);
+        target = MIN(elapsed * missing / bytes, target);
+    }
+    if (waiting > 0 && live > 0) {
+        target = target * (live - MIN(waiting, live)) / live;
+        COUNT_EVENT(AGGREGATION_ADAPT_LATENCY);
+    }
+    target = MAX(target, config.agg_min_deadline);
+    agm->deadline = (uint32_t) ((3 * (uint64_t) agm->deadline + target) / 4);
+
+    COUNT_EVENT(AGGREGATION_ADAPT_UPDATES);
+    INCR_EVENT(AGGREGATION_ADAPT_TICKS, agm->deadline);
+}
+
+/* ticks a command block for rnid can wait before being flushed */
+INLINE uint32_t agm_cmdb_deadline(uint32_t rnid)
+{
+    if (config.agg_min_deadline != 0)
+        return agms[rnid].deadline;
+    return config.cmdb_check_interv;
+}
+
 INLINE bool agm_check_cmdb_timeout_a(uint32_t thid, uint64_t * const old_tick)
 {
     bool ret = false;
     uint64_t tick = rdtsc();
-    if (tick - *old_tick > config.cmdb_check_interv) {
+    uint32_t interv = (config.agg_min_deadline != 0) ?
+        config.agg_min_deadline : config.cmdb_check_interv;
+    if (tick - *old_tick > interv) {
         uint32_t i;
         for (i = 0; i < num_nodes; i++) {
             if (i != node_id) {
-                cmd_block_t *cmdb = agms[i].p_cmdbs[thid];
+                cmd_block_t *cmdb = agm_open_cmdb(i, thid);
                 if (cmdb != NULL) {
-                    if (tick - cmdb->tick > config.cmdb_check_interv)
+                    if (tick - cmdb->tick > agm_cmdb_deadline(i))
                         agm_push_cmdb(i, thid, true);
                 }
             }
@@ -295,10 +521,19 @@ INLINE bool agm_check_cmdb_timeout_a(uint32_t thid, uint64_t * const old_tick)
     return ret;
 }
 
+INLINE bool agm_cmdb_fits(cmd_block_t * cmdb, uint32_t cmd_size)
+{
+    return cmdb->block_info.cmds_bytes + cmd_size <= CMD_BLOCK_SIZE
+        && agm_get_cmdb_eq_bytes(cmdb) + cmd_size <= COMM_BUFFER_SIZE;
+}
+
 /* Returns an available cmd_block */
 INLINE cmd_block_t *agm_set_cmdb(const uint32_t rnid, const uint32_t thid)
 {
+    if (!agms[rnid].ready)
+        agm_init_blocks(rnid);
     while (!cmdb_queue_pop(&agms[rnid].pool_cmdb, &agms[rnid].p_cmdbs[thid])) {
+        agm_before_wait(thid);
         int32_t num_bytes = agm_aggregate_and_send(rnid, thid, false);
         if (num_bytes > 0) {
             COUNT_EVENT(AGGREGATION_ON_MISS_CMDB);
@@ -311,6 +546,14 @@ INLINE cmd_block_t *agm_set_cmdb(const uint32_t rnid, const uint32_t thid)
     cmdb->data_cnt = 0;
     cmdb->block_info.cmds_bytes = 0;
     cmdb->block_info.data_bytes = 0;
+    cmdb->route_pos = 0;
+    cmdb->gather_pos = 0;
+    cmdb->scatter_pos = 0;
+    cmd_c_state_reset(&cmdb->c_state);
+    if (cmdb->comb_used != 0) {
+        memset(cmdb->comb_slots, 0, sizeof(uint64_t) << AGG_COMB_SLOTS_BITS);
+        cmdb->comb_used = 0;
+    }
     return cmdb;
 }
 
@@ -321,14 +564,13 @@ INLINE void *agm_get_cmd_a(uint32_t rnid, uint32_t thid,
     _assert(rnid < num_nodes);
     _assert(cmd_size <= CMD_BLOCK_SIZE);
 
-    cmd_block_t *cmdb = agms[rnid].p_cmdbs[thid];
+    cmd_block_t *cmdb = agm_open_cmdb(rnid, thid);
     if (cmdb == NULL)
         cmdb = agm_set_cmdb(rnid, thid);
 
     /* if we can't fit more commands in this command block
      * push it and get a new one */
-    if (cmdb->block_info.cmds_bytes + cmd_size > CMD_BLOCK_SIZE
-        || agm_get_cmdb_eq_bytes(cmdb) + cmd_size > COMM_BUFFER_SIZE) {
+    if (!agm_cmdb_fits(cmdb, cmd_size)) {
         agm_push_cmdb(rnid, thid, false);
         cmdb = agm_set_cmdb(rnid, thid);
     }
@@ -357,6 +599,84 @@ INLINE void *agm_get_cmd_a(uint32_t rnid, uint32_t thid,
     return ret;
 }
 
+/* Get a command for rnid from the block of its proxy pnid. Consecutive 
+ * commands for the same node share one GMT_CMD_ROUTE header */
+INLINE void *agm_get_routed_cmd_a(uint32_t rnid, uint32_t pnid,
+                                  uint32_t thid, uint32_t cmd_size)
+{
+    COUNT_EVENT(AGGREGATION_ROUTE_CMDS);
+    cmd_block_t *cmdb = agm_open_cmdb(pnid, thid);
+    if (cmdb != NULL && cmdb->route_pos != 0 && agm_cmdb_fits(cmdb, cmd_size)) {
+        uint32_t pos = cmdb->route_pos - 1;
+        cmd_route_t *r = (cmd_route_t *) &cmdb->cmds[pos];
+        if (r->dst == rnid && pos + sizeof(cmd_route_t) + r->cmds_bytes
+            == cmdb->block_info.cmds_bytes) {
+            void *ret = agm_get_cmd_a(pnid, thid, cmd_size, 0, NULL);
+            r->cmds_bytes += cmd_size;
+            return ret;
+        }
+    }
+    cmd_route_t *r = (cmd_route_t *) agm_get_cmd_a(pnid, thid,
+                                                   sizeof(cmd_route_t) +
+                                                   cmd_size, 0, NULL);
+    /* the block may have been replaced, take the current one */
+    cmdb = agms[pnid].p_cmdbs[thid];
+    cmdb->route_pos = ((uint8_t *) r - cmdb->cmds) + 1;
+    r->type = GMT_CMD_ROUTE;
+    r->dst = rnid;
+    r->src = node_id;
+    r->cmds_bytes = cmd_size;
+    return (void *)(r + 1);
+}
+
+/* Get a command without data for rnid from the block of its proxy pnid 
+ * (agm_route) or, when it is not routed, from its own block */
+INLINE void *agm_get_cmd_to_a(uint32_t rnid, uint32_t pnid, uint32_t thid,
+                              uint32_t cmd_size)
+{
+    if (pnid != rnid)
+        return agm_get_routed_cmd_a(rnid, pnid, thid, cmd_size);
+    return agm_get_cmd_a(rnid, thid, cmd_size, 0, NULL);
+}
+
+/* true when the command at pos, which ends the open block cmdb of pnid, is
+ * for rnid: it is in the GMT_CMD_ROUTE section for rnid that ends the block
+ * or, outside of any section, rnid is pnid itself */
+INLINE bool agm_last_cmd_is_for(cmd_block_t * cmdb, uint32_t pnid,
+                                uint32_t rnid, uint32_t pos)
+{
+    if (cmdb->route_pos != 0 && cmdb->route_pos - 1 < pos) {
+        uint32_t rpos = cmdb->route_pos - 1;
+        cmd_route_t *r = (cmd_route_t *) &cmdb->cmds[rpos];
+        if (rpos + sizeof(cmd_route_t) + r->cmds_bytes
+            == cmdb->block_info.cmds_bytes)
+            return r->dst == rnid;
+    }
+    return pnid == rnid;
+}
+
+/* Append a compact command (see cmd_c_encode) to the block of thid for 
+ * rnid, its size is known only once encoded against the block state */
+INLINE void agm_set_c_cmd_a(uint32_t rnid, uint32_t thid, uint8_t type,
+                            uint32_t tid, gmt_data_t gmt_array,
+                            uint64_t offset, uint64_t value,
+                            uint64_t ret_value_ptr)
+{
+    _assert(rnid < num_nodes);
+    cmd_block_t *cmdb = agm_open_cmdb(rnid, thid);
+    if (cmdb == NULL)
+        cmdb = agm_set_cmdb(rnid, thid);
+    if (!agm_cmdb_fits(cmdb, CMD_C_MAX_BYTES)) {
+        agm_push_cmdb(rnid, thid, false);
+        cmdb = agm_set_cmdb(rnid, thid);
+    }
+    cmdb->block_info.cmds_bytes +=
+        cmd_c_encode(&cmdb->cmds[cmdb->block_info.cmds_bytes],
+                     &cmdb->c_state, type, tid, gmt_array, offset, value,
+                     ret_value_ptr);
+    _assert(cmdb->block_info.cmds_bytes <= CMD_BLOCK_SIZE);
+}
+
 /* Set data for the current command */
 INLINE void agm_set_cmd_data_a(uint32_t rnid, uint32_t thid,
                                const uint8_t * data, uint32_t data_size)
@@ -366,7 +686,7 @@ INLINE void agm_set_cmd_data_a(uint32_t rnid, uint32_t thid,
         return;
     }
     _assert(rnid < num_nodes);
-    cmd_block_t *cmdb = agms[rnid].p_cmdbs[thid];
+    cmd_block_t *cmdb = agm_open_cmdb(rnid, thid);
 
     _assert(cmdb != NULL);
     _assert(data_size > 0);
@@ -380,11 +700,226 @@ INLINE void agm_set_cmd_data_a(uint32_t rnid, uint32_t thid,
     _assert(agm_get_cmdb_eq_bytes(cmdb) <= COMM_BUFFER_SIZE);
 }
 
+INLINE uint32_t agm_comb_slot(uint32_t rnid, gmt_data_t gmt_array,
+                              uint64_t offset)
+{
+    uint64_t h = (offset ^ ((uint64_t) gmt_array << 32) ^
+                  ((uint64_t) rnid << 48)) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t) (h >> (64 - AGG_COMB_SLOTS_BITS));
+}
+
+/* Commands appended to the open command block of thid after the last put 
+ * value or atomic add to an element must not be reordered with a later one, 
+ * any other command empties the combining table. Combinable commands for a 
+ * routed node are in the block of its proxy, so that is the table emptied */
+INLINE void agm_comb_clear(uint32_t rnid, uint32_t thid)
+{
+    cmd_block_t *cmdb = agm_open_cmdb(agm_route(rnid), thid);
+    if (cmdb != NULL && cmdb->comb_used != 0) {
+        memset(cmdb->comb_slots, 0, sizeof(uint64_t) << AGG_COMB_SLOTS_BITS);
+        cmdb->comb_used = 0;
+    }
+}
+
+/* Returns the last combinable command for rnid of the open command block of
+ * thid that hashed to the slot of (gmt_array, offset) or NULL. With routing 
+ * that is the block of the proxy, which also holds commands for the other 
+ * nodes of its group, hence the destination kept in the slot. The caller 
+ * checks the command type, element and task before merging into it */
+INLINE void *agm_comb_find_a(uint32_t rnid, uint32_t thid,
+                             gmt_data_t gmt_array, uint64_t offset)
+{
+    cmd_block_t *cmdb = agm_open_cmdb(agm_route(rnid), thid);
+    if (cmdb == NULL)
+        return NULL;
+    uint64_t s = cmdb->comb_slots[agm_comb_slot(rnid, gmt_array, offset)];
+    if (s == 0 || (uint32_t) (s >> 32) != rnid)
+        return NULL;
+    return (void *)&cmdb->cmds[(uint32_t) s - 1];
+}
+
+/* Like agm_get_cmd for a command without data that later ones to the same 
+ * element may be merged into */
+INLINE void *agm_get_comb_cmd_a(uint32_t rnid, uint32_t thid,
+                                uint32_t cmd_size, gmt_data_t gmt_array,
+                                uint64_t offset)
+{
+    uint32_t pnid = agm_route(rnid);
+    uint8_t *ret = (uint8_t *) agm_get_cmd_to_a(rnid, pnid, thid, cmd_size);
+    /* the block may have been replaced, take the current one */
+    cmd_block_t *cmdb = agm_open_cmdb(pnid, thid);
+    uint64_t *slot = &cmdb->comb_slots[agm_comb_slot(rnid, gmt_array,
+                                                     offset)];
+    if (*slot == 0)
+        cmdb->comb_used++;
+    *slot = ((uint64_t) rnid << 32) | ((ret - cmdb->cmds) + 1);
+    return ret;
+}
+
+INLINE void *agm_comb_find(uint32_t rnid, uint32_t thid,
+                           gmt_data_t gmt_array, uint64_t offset)
+{
+#if ENABLE_AGGREGATION
+    return agm_comb_find_a(rnid, thid, gmt_array, offset);
+#else
+    _unused(rnid);
+    _unused(thid);
+    _unused(gmt_array);
+    _unused(offset);
+    return NULL;
+#endif
+}
+
+INLINE void *agm_get_comb_cmd(uint32_t rnid, uint32_t thid,
+                              uint32_t cmd_size, gmt_data_t gmt_array,
+                              uint64_t offset)
+{
+#if ENABLE_AGGREGATION
+    return agm_get_comb_cmd_a(rnid, thid, cmd_size, gmt_array, offset);
+#else
+    _unused(gmt_array);
+    _unused(offset);
+    return agm_get_cmd_na(rnid, thid, cmd_size, 0, NULL);
+#endif
+}
+
+/* Add a get of the element at offset of gmt_array (nbytes_elem bytes) into
+ * ret to the block of thid for rnid, or for its proxy when routed. The 
+ * GMT_CMD_GATHER that ends the block is extended when it is for rnid, of the
+ * same uthread and array and ret can be reached from its ret_data_ptr, 
+ * otherwise a new one is started */
+INLINE void agm_set_gather_ent_a(uint32_t rnid, uint32_t thid, uint32_t tid,
+                                 gmt_data_t gmt_array, uint64_t offset,
+                                 uint8_t * ret, uint32_t nbytes_elem)
+{
+    _assert(rnid < num_nodes);
+    _assert((uint64_t) ret >> VIRT_ADDR_PTR_BITS == 0);
+    uint32_t pnid = agm_route(rnid);
+    cmd_block_t *cmdb = agm_open_cmdb(pnid, thid);
+    if (cmdb != NULL && cmdb->gather_pos != 0 &&
+        agm_cmdb_fits(cmdb, sizeof(gather_ent_t))) {
+        uint32_t pos = cmdb->gather_pos - 1;
+        cmd_gather_t *c = (cmd_gather_t *) &cmdb->cmds[pos];
+        uint64_t diff = (uint64_t) ret - c->ret_data_ptr;
+        if (c->tid == tid && c->gmt_array == gmt_array &&
+            c->num < UINT16_MAX && (uint64_t) ret >= c->ret_data_ptr &&
+            diff % nbytes_elem == 0 && diff / nbytes_elem <= UINT32_MAX &&
+            pos + sizeof(cmd_gather_t) + c->num * sizeof(gather_ent_t)
+            == cmdb->block_info.cmds_bytes &&
+            agm_last_cmd_is_for(cmdb, pnid, rnid, pos)) {
+            gather_ent_t *e = (gather_ent_t *)
+                agm_get_cmd_to_a(rnid, pnid, thid, sizeof(gather_ent_t));
+            e->offset = offset;
+            e->idx = (uint32_t) (diff / nbytes_elem);
+            c->num++;
+            return;
+        }
+    }
+    if (config.agg_combine)
+        agm_comb_clear(rnid, thid);
+    cmd_gather_t *c = (cmd_gather_t *)
+        agm_get_cmd_to_a(rnid, pnid, thid, sizeof(cmd_gather_t) +
+                         sizeof(gather_ent_t));
+    /* the block may have been replaced, take the current one */
+    cmdb = agms[pnid].p_cmdbs[thid];
+    cmdb->gather_pos = ((uint8_t *) c - cmdb->cmds) + 1;
+    c->type = GMT_CMD_GATHER;
+    c->tid = tid;
+    c->gmt_array = gmt_array;
+    c->ret_data_ptr = (uint64_t) ret;
+    c->num = 1;
+    gather_ent_t *e = (gather_ent_t *) (c + 1);
+    e->offset = offset;
+    e->idx = 0;
+}
+
+/* Add a put or an atomic add (op) to the element at offset of gmt_array to
+ * the block of thid for rnid (or its proxy), the value is val_bytes long. As
+ * for gathers the GMT_CMD_SCATTER that ends the block is extended when it 
+ * can */
+INLINE void agm_set_scatter_ent_a(uint32_t rnid, uint32_t thid, uint32_t tid,
+                                  gmt_data_t gmt_array, uint8_t op,
+                                  uint64_t offset, const void *value,
+                                  uint32_t val_bytes)
+{
+    _assert(rnid < num_nodes);
+    uint32_t ent_bytes = sizeof(uint64_t) + val_bytes;
+    uint8_t *ent = NULL;
+    uint32_t pnid = agm_route(rnid);
+    cmd_block_t *cmdb = agm_open_cmdb(pnid, thid);
+    if (cmdb != NULL && cmdb->scatter_pos != 0 &&
+        agm_cmdb_fits(cmdb, ent_bytes)) {
+        uint32_t pos = cmdb->scatter_pos - 1;
+        cmd_scatter_t *c = (cmd_scatter_t *) &cmdb->cmds[pos];
+        if (c->tid == tid && c->gmt_array == gmt_array && c->op == op &&
+            c->num < UINT16_MAX &&
+            pos + sizeof(cmd_scatter_t) + c->num * ent_bytes
+            == cmdb->block_info.cmds_bytes &&
+            agm_last_cmd_is_for(cmdb, pnid, rnid, pos)) {
+            ent = (uint8_t *) agm_get_cmd_to_a(rnid, pnid, thid, ent_bytes);
+            c->num++;
+        }
+    }
+    if (ent == NULL) {
+        if (config.agg_combine)
+            agm_comb_clear(rnid, thid);
+        cmd_scatter_t *c = (cmd_scatter_t *)
+            agm_get_cmd_to_a(rnid, pnid, thid,
+                             sizeof(cmd_scatter_t) + ent_bytes);
+        /* the block may have been replaced, take the current one */
+        cmdb = agms[pnid].p_cmdbs[thid];
+        cmdb->scatter_pos = ((uint8_t *) c - cmdb->cmds) + 1;
+        c->type = GMT_CMD_SCATTER;
+        c->tid = tid;
+        c->op = op;
+        c->gmt_array = gmt_array;
+        c->num = 1;
+        ent = (uint8_t *) (c + 1);
+    }
+    *(uint64_t *) ent = offset;
+    memcpy(ent + sizeof(uint64_t), value, val_bytes);
+}
+
+/* compact commands need aggregation and are never routed, a proxy would 
+ * break the block state they are encoded against */
+INLINE bool agm_use_compact(uint32_t rnid)
+{
+#if ENABLE_AGGREGATION
+    return config.compact_cmds && agm_route(rnid) == rnid;
+#else
+    _unused(rnid);
+    return false;
+#endif
+}
+
+INLINE void agm_set_c_cmd(uint32_t rnid, uint32_t thid, uint8_t type,
+                          uint32_t tid, gmt_data_t gmt_array,
+                          uint64_t offset, uint64_t value,
+                          uint64_t ret_value_ptr)
+{
+#if ENABLE_AGGREGATION
+    agm_set_c_cmd_a(rnid, thid, type, tid, gmt_array, offset, value,
+                    ret_value_ptr);
+#else
+    _unused(rnid); _unused(thid); _unused(type); _unused(tid);
+    _unused(gmt_array); _unused(offset); _unused(value);
+    _unused(ret_value_ptr);
+#endif
+}
+
 INLINE void *agm_get_cmd(uint32_t rnid, uint32_t thid,
                          uint32_t cmd_size, uint64_t req_data_size,
                          uint32_t * const granted_data_size)
 {
 #if ENABLE_AGGREGATION
+    if (config.agg_combine)
+        agm_comb_clear(rnid, thid);
+    /* commands with payload data always go straight to rnid */
+    if (granted_data_size == NULL) {
+        uint32_t pnid = agm_route(rnid);
+        if (pnid != rnid)
+            return agm_get_routed_cmd_a(rnid, pnid, thid, cmd_size);
+    }
     return agm_get_cmd_a(rnid, thid,
                          cmd_size, req_data_size, granted_data_size);
 #else
@@ -404,6 +939,60 @@ INLINE void agm_set_cmd_data(uint32_t rnid, uint32_t thid,
 #endif
 }
 
+/* With aggregation the entries are packed in GMT_CMD_GATHER commands, many
+ * per command, routed through the proxy of rnid like any other command 
+ * without data (see agm_set_gather_ent_a). Without aggregation each entry 
+ * is a command of its own in a buffer of its own, sent straight to rnid */
+INLINE void agm_set_gather_ent(uint32_t rnid, uint32_t thid, uint32_t tid,
+                               gmt_data_t gmt_array, uint64_t offset,
+                               uint8_t * ret, uint32_t nbytes_elem)
+{
+#if ENABLE_AGGREGATION
+    agm_set_gather_ent_a(rnid, thid, tid, gmt_array, offset, ret,
+                         nbytes_elem);
+#else
+    _unused(nbytes_elem);
+    cmd_gather_t *c = (cmd_gather_t *)
+        agm_get_cmd_na(rnid, thid, sizeof(cmd_gather_t) +
+                       sizeof(gather_ent_t), 0, NULL);
+    c->type = GMT_CMD_GATHER;
+    c->tid = tid;
+    c->gmt_array = gmt_array;
+    c->ret_data_ptr = (uint64_t) ret;
+    c->num = 1;
+    gather_ent_t *e = (gather_ent_t *) (c + 1);
+    e->offset = offset;
+    e->idx = 0;
+    agm_set_cmd_data_na(rnid, thid, NULL, 0);
+#endif
+}
+
+/* Same as agm_set_gather_ent for GMT_CMD_SCATTER, the values are part of
+ * the entries so they are routed as well */
+INLINE void agm_set_scatter_ent(uint32_t rnid, uint32_t thid, uint32_t tid,
+                                gmt_data_t gmt_array, uint8_t op,
+                                uint64_t offset, const void *value,
+                                uint32_t val_bytes)
+{
+#if ENABLE_AGGREGATION
+    agm_set_scatter_ent_a(rnid, thid, tid, gmt_array, op, offset, value,
+                          val_bytes);
+#else
+    cmd_scatter_t *c = (cmd_scatter_t *)
+        agm_get_cmd_na(rnid, thid, sizeof(cmd_scatter_t) +
+                       sizeof(uint64_t) + val_bytes, 0, NULL);
+    c->type = GMT_CMD_SCATTER;
+    c->tid = tid;
+    c->op = op;
+    c->gmt_array = gmt_array;
+    c->num = 1;
+    uint8_t *ent = (uint8_t *) (c + 1);
+    *(uint64_t *) ent = offset;
+    memcpy(ent + sizeof(uint64_t), value, val_bytes);
+    agm_set_cmd_data_na(rnid, thid, NULL, 0);
+#endif
+}
+
 INLINE bool agm_check_cmdb_timeout(uint32_t thid, uint64_t * const old_tick)
 {
 #if ENABLE_AGGREGATION
@@ -419,6 +1008,95 @@ INLINE void agm_force_aggr(int32_t rnid, uint32_t thid)
     agm_force_aggr_a( rnid,  thid);
 #endif
 }
+
+/* true when thid has no command block being filled and nothing is queued
+ * for the nodes in [start_nid, end_nid), i.e. the thread has no timeout
+ * left to serve and can park */
+INLINE bool agm_is_idle(uint32_t thid, uint32_t start_nid, uint32_t end_nid)
+{
+#if ENABLE_AGGREGATION
+    uint32_t i;
+    for (i = 0; i < num_nodes; i++)
+        if (i != node_id && agm_open_cmdb(i, thid) != NULL)
+            return false;
+    for (i = start_nid; i < end_nid; i++)
+        if (i != node_id && agm_queued_bytes(i) != 0)
+            return false;
+#else
+    _unused(thid);
+    _unused(start_nid);
+    _unused(end_nid);
+#endif
+    return true;
+}
+
+/* Control commands (replies, acks and handle checks) never go through 
+ * command blocks, they are written in the open buffer of the control 
+ * channel of thid so that they do not wait behind bulk data. Consecutive 
+ * commands for the same node share the buffer, it goes out on 
+ * agm_send_ctrl_cmd() or when the next command is for another node or does
+ * not fit. Helpers send once per processed buffer, workers after each 
+ * command. */
+INLINE net_buffer_t *agm_wait_ctrl_buff(uint32_t thid)
+{
+    net_buffer_t *buff = comm_server_pop_ctrl_send_buff(thid);
+    if (buff != NULL)
+        return buff;
+    agm_before_wait(thid);
+    COUNT_EVENT(AGGREGATION_CTRL_WAIT);
+    /* buffers come back when the comm servers complete their sends, back 
+     * off and then yield so that they get the CPU */
+    uint32_t pauses = 1;
+    while ((buff = comm_server_pop_ctrl_send_buff(thid)) == NULL) {
+        if (pauses < IDLE_MAX_BACKOFF) {
+            uint32_t i;
+            for (i = 0; i < pauses; i++)
+                __asm__ __volatile__("pause");
+            pauses <<= 1;
+        } else
+            sched_yield();
+    }
+    return buff;
+}
+
+INLINE void agm_send_ctrl_cmd(uint32_t thid)
+{
+    net_buffer_t *buff = comm_server_open_ctrl_send_buff(thid);
+    if (buff == NULL)
+        return;
+    comm_server_push_ctrl_send_buff(thid);
+    COUNT_EVENT(AGGREGATION_CTRL_BUFF);
+}
+
+INLINE void *agm_get_ctrl_cmd(uint32_t rnid, uint32_t thid,
+                              uint32_t cmd_size)
+{
+    _assert(rnid < num_nodes);
+    _assert(thid < NUM_HELPERS + NUM_WORKERS);
+    _assert(sizeof(block_info_t) + cmd_size <= CTRL_BUFFER_SIZE);
+
+    net_buffer_t *buff = comm_server_open_ctrl_send_buff(thid);
+    if (buff != NULL && (buff->rnode_id != rnid ||
+                         buff->num_bytes + cmd_size > CTRL_BUFFER_SIZE)) {
+        agm_send_ctrl_cmd(thid);
+        buff = NULL;
+    }
+    if (buff == NULL) {
+        buff = agm_wait_ctrl_buff(thid);
+        buff->num_bytes = 0;
+        buff->rnode_id = rnid;
+        block_info_t bi;
+        bi.cmds_bytes = 0;
+        bi.data_bytes = 0;
+        netbuffer_append(buff, &bi, sizeof(block_info_t));
+    }
+    /* all the commands of the buffer are in its single block */
+    ((block_info_t *) buff->data)->cmds_bytes += cmd_size;
+    void *cmd = buff->data + buff->num_bytes;
+    netbuffer_skip(buff, cmd_size);
+    COUNT_EVENT(AGGREGATION_CTRL_CMD);
+    return cmd;
+}
 /* ENABLE_SINGLE_NODE_ONLY */
 #else
 INLINE void *agm_get_cmd(uint32_t rnid, uint32_t thid,
@@ -433,6 +1111,61 @@ INLINE void *agm_get_cmd(uint32_t rnid, uint32_t thid,
     return NULL;
 }
 
+INLINE void *agm_comb_find(uint32_t rnid, uint32_t thid,
+                           gmt_data_t gmt_array, uint64_t offset)
+{
+    _unused(rnid);
+    _unused(thid);
+    _unused(gmt_array);
+    _unused(offset);
+    return NULL;
+}
+
+INLINE bool agm_use_compact(uint32_t rnid)
+{
+    _unused(rnid);
+    return false;
+}
+
+INLINE void agm_set_gather_ent(uint32_t rnid, uint32_t thid, uint32_t tid,
+                               gmt_data_t gmt_array, uint64_t offset,
+                               uint8_t * ret, uint32_t nbytes_elem)
+{
+    _unused(rnid); _unused(thid); _unused(tid); _unused(gmt_array);
+    _unused(offset); _unused(ret); _unused(nbytes_elem);
+}
+
+INLINE void agm_set_scatter_ent(uint32_t rnid, uint32_t thid, uint32_t tid,
+                                gmt_data_t gmt_array, uint8_t op,
+                                uint64_t offset, const void *value,
+                                uint32_t val_bytes)
+{
+    _unused(rnid); _unused(thid); _unused(tid); _unused(gmt_array);
+    _unused(op); _unused(offset); _unused(value); _unused(val_bytes);
+}
+
+INLINE void agm_set_c_cmd(uint32_t rnid, uint32_t thid, uint8_t type,
+                          uint32_t tid, gmt_data_t gmt_array,
+                          uint64_t offset, uint64_t value,
+                          uint64_t ret_value_ptr)
+{
+    _unused(rnid); _unused(thid); _unused(type); _unused(tid);
+    _unused(gmt_array); _unused(offset); _unused(value);
+    _unused(ret_value_ptr);
+}
+
+INLINE void *agm_get_comb_cmd(uint32_t rnid, uint32_t thid,
+                              uint32_t cmd_size, gmt_data_t gmt_array,
+                              uint64_t offset)
+{
+    _unused(rnid);
+    _unused(thid);
+    _unused(cmd_size);
+    _unused(gmt_array);
+    _unused(offset);
+    return NULL;
+}
+
 INLINE void agm_set_cmd_data(uint32_t rnid, uint32_t thid,
                              const uint8_t * data, uint32_t data_size)
 {
@@ -455,6 +1188,28 @@ INLINE void agm_force_aggr(int32_t rnid, uint32_t thid)
     _unused(thid);
 }
 
+INLINE void *agm_get_ctrl_cmd(uint32_t rnid, uint32_t thid,
+                              uint32_t cmd_size)
+{
+    _unused(rnid);
+    _unused(thid);
+    _unused(cmd_size);
+    return NULL;
+}
+
+INLINE void agm_send_ctrl_cmd(uint32_t thid)
+{
+    _unused(thid);
+}
+
+INLINE bool agm_is_idle(uint32_t thid, uint32_t start_nid, uint32_t end_nid)
+{
+    _unused(thid);
+    _unused(start_nid);
+    _unused(end_nid);
+    return true;
+}
+
 
 #endif
 
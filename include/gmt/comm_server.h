@@ -45,21 +45,43 @@
 #include "gmt/network.h"
 #include "gmt/queue.h"
 #include "gmt/thread_affinity.h"
+#include "gmt/idle.h"
 
 #if !(ENABLE_SINGLE_NODE_ONLY)
 
 #define NUM_RECV_CHANNELS (NUM_HELPERS)
 #define NUM_SEND_CHANNELS (NUM_WORKERS + NUM_HELPERS)
 
+/* class of the COMM_BUFFER_SIZE buffers */
+#define BUFF_CLASS_LARGE (NUM_BUFF_CLASSES - 1)
+
+/* upper bound of the send buffers (all classes and control) of a channel */
+#define NUM_SEND_BUFFS_PER_CHANNEL \
+    ((NUM_BUFF_CLASSES - 1) * NUM_BUFFS_PER_CHANNEL + \
+     (config.num_large_buffs_per_channel > NUM_BUFFS_PER_CHANNEL ? \
+      config.num_large_buffs_per_channel : NUM_BUFFS_PER_CHANNEL) + \
+     NUM_CTRL_BUFFS_PER_CHANNEL)
+
 DEFINE_QUEUE(pend_queue, net_buffer_t *,
-             NUM_BUFFS_PER_CHANNEL * NUM_SEND_CHANNELS);
+             NUM_SEND_BUFFS_PER_CHANNEL * NUM_SEND_CHANNELS);
 DEFINE_QUEUE_SPSC(ch_queue, net_buffer_t *);
 
+/* A channel is shared by one worker or helper and all the comm servers. 
+ * There is one queue and one pool for each comm server, so that each of them
+ * stays single producer and single consumer. */
 typedef struct channel_tag {
-    ch_queue_t queue;
-    ch_queue_t pool;
+    ch_queue_t *queues;
+    ch_queue_t *pools;
+    uint32_t num_buffs;
     net_buffer_t *buffers;
     net_buffer_t *current_buff;
+    uint32_t current_cs;        /* comm server current_buff comes from */
+    uint32_t next_cs;           /* next comm server to pop from */
+    /* recv buffers without memory, they borrow the slots of the shm rings */
+    ch_queue_t *shm_pools;
+    net_buffer_t *shm_buffers;
+    /* idle state of the helper consuming the queues (recv channels only) */
+    idle_t *idle;
 } channel_t;
 
 typedef enum {
@@ -67,14 +89,74 @@ typedef enum {
     RECV_TYPE
 } chan_type_t;
 
+/* buffers with an MPI request in flight, the requests are kept contiguous
+ * so that they can be tested all together */
+typedef struct pend_array_t {
+    uint32_t count;
+    uint32_t size;
+    net_buffer_t **buffs;
+    MPI_Request *requests;
+    int *indices;
+    MPI_Status *statuses;
+} pend_array_t;
+
+/* rendezvous transfer, the payload travels in a message of its own straight
+ * from the source buffer into the destination memory. Requests are posted 
+ * by the comm server that owns rnid, received ones are then handed to the 
+ * helpers that send the ack. */
+typedef struct rndv_req_t {
+    struct rndv_req_t *next;
+    bool is_send;
+    uint32_t rnid;
+    uint8_t *data;
+    uint64_t nbytes;
+    int tag;
+    uint32_t tid;               /* uthread on rnid waiting for the ack */
+    MPI_Request request;
+} rndv_req_t;
+
+/* network emulation: an emulated link holds buffers until their release 
+ * tick, in order, next is the oldest one already out of the queue */
+typedef struct emu_link_t {
+    pend_queue_t pending;
+    net_buffer_t *next;
+    uint64_t free_tick;         /* link busy until this tick */
+} emu_link_t;
+
+/* state private to one comm server thread */
+typedef struct comm_server_thread_t {
+    uint32_t id;
+    pthread_t pthread;
+    pend_array_t pending_send;
+    pend_array_t pending_recv;
+    /* shm sends that found the remote ring full */
+    pend_queue_t pending_shm;
+    /* network emulation, control buffers do not queue behind bulk ones */
+    emu_link_t emu_ctrl;
+    emu_link_t emu_bulk;
+    idle_t idle;
+    backoff_t backoff;
+    /* rendezvous requests to post (lock-free stack) and posted ones */
+    rndv_req_t *volatile rndv_new;
+    rndv_req_t *rndv_pending;
+} comm_server_thread_t;
+
 typedef struct comm_server_t {
     volatile bool stop_flag;
     volatile bool init_done;
-    pthread_t pthread;
-    channel_t *send_channels;
-    channel_t *recv_channels;
-    pend_queue_t pending_send;
-    pend_queue_t pending_recv;
+    /* bulk channels, one set for each size class of buffers */
+    channel_t *send_channels[NUM_BUFF_CLASSES];
+    channel_t *recv_channels[NUM_BUFF_CLASSES];
+    uint32_t class_size[NUM_BUFF_CLASSES];
+    /* control channels: small buffers with their own tag for replies, acks
+     * and handle checks, served before the bulk ones */
+    channel_t *ctrl_send_channels;
+    channel_t *ctrl_recv_channels;
+    comm_server_thread_t *threads;
+    /* received rendezvous transfers waiting for their ack (lock-free stack) */
+    rndv_req_t *volatile rndv_done;
+    /* idle state of the helpers, one for each recv channel */
+    idle_t *recv_idle;
 } comm_server_t;
 
 void comm_server_init();
@@ -85,42 +167,162 @@ channel_t *comm_server_get_channel(chan_type_t type);
 
 extern comm_server_t cs;
 
-INLINE net_buffer_t *comm_server_pop_send_buff(uint32_t tid)
+/* pop from the per comm server queues starting from next_cs */
+INLINE bool comm_server_pop_any(channel_t * ch, ch_queue_t * qs,
+                                net_buffer_t ** buff)
+{
+    uint32_t i;
+    for (i = 0; i < NUM_COMM_SERVERS; i++) {
+        uint32_t c = ch->next_cs;
+        if (++ch->next_cs == NUM_COMM_SERVERS)
+            ch->next_cs = 0;
+        if (ch_queue_pop(&qs[c], buff)) {
+            ch->current_cs = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+INLINE net_buffer_t *comm_server_chan_pop_send(channel_t * ch)
 {
-    channel_t *ch = &(cs.send_channels[tid]);
     if (ch->current_buff == NULL)
-        ch_queue_pop(&ch->pool, &ch->current_buff);
+        comm_server_pop_any(ch, ch->pools, &ch->current_buff);
     return ch->current_buff;
 }
 
+INLINE void comm_server_chan_push_send(channel_t * ch)
+{
+    uint32_t c = network_comm_of(ch->current_buff->rnode_id);
+    ch_queue_push(&ch->queues[c], ch->current_buff);
+    ch->current_buff = NULL;
+    idle_wake(&cs.threads[c].idle);
+}
+
+INLINE net_buffer_t *comm_server_chan_pop_recv(channel_t * ch)
+{
+    if (ch->current_buff == NULL)
+        comm_server_pop_any(ch, ch->queues, &ch->current_buff);
+    return ch->current_buff;
+}
+
+INLINE void comm_server_chan_push_recv(channel_t * ch)
+{
+    ch_queue_push(&ch->pools[ch->current_cs], ch->current_buff);
+    ch->current_buff = NULL;
+    idle_wake(&cs.threads[ch->current_cs].idle);
+}
+
+/* smallest class of buffers that can hold nbytes */
+INLINE uint32_t comm_server_buff_class(uint32_t nbytes)
+{
+    uint32_t c = 0;
+    while (c < BUFF_CLASS_LARGE && cs.class_size[c] < nbytes)
+        c++;
+    return c;
+}
+
+INLINE net_buffer_t *comm_server_pop_class_send_buff(uint32_t c, uint32_t tid)
+{
+    return comm_server_chan_pop_send(&cs.send_channels[c][tid]);
+}
+
+INLINE net_buffer_t *comm_server_pop_class_recv_buff(uint32_t c, uint32_t tid)
+{
+    return comm_server_chan_pop_recv(&cs.recv_channels[c][tid]);
+}
+
+/* push back the current buffer of the channel buff comes from */
+INLINE void comm_server_push_buff_send(net_buffer_t * buff)
+{
+    comm_server_chan_push_send((channel_t *) buff->context);
+}
+
+INLINE void comm_server_push_buff_recv(net_buffer_t * buff)
+{
+    comm_server_chan_push_recv((channel_t *) buff->context);
+}
+
+INLINE net_buffer_t *comm_server_pop_send_buff(uint32_t tid)
+{
+    return comm_server_pop_class_send_buff(BUFF_CLASS_LARGE, tid);
+}
+
 INLINE net_buffer_t *comm_server_drain_send_buff(uint32_t tid)
 {
-    channel_t *ch = &(cs.send_channels[tid]);
+    channel_t *ch = &(cs.send_channels[BUFF_CLASS_LARGE][tid]);
     net_buffer_t *nb = NULL;
-    ch_queue_pop(&ch->pool, &nb);
+    uint32_t c;
+    for (c = 0; c < NUM_COMM_SERVERS && nb == NULL; c++)
+        ch_queue_pop(&ch->pools[c], &nb);
     return nb;
 }
 
 INLINE void comm_server_push_send_buff(uint32_t tid)
 {
-    channel_t *ch = &(cs.send_channels[tid]);
-    ch_queue_push(&ch->queue, ch->current_buff);
-    ch->current_buff = NULL;
+    comm_server_chan_push_send(&cs.send_channels[BUFF_CLASS_LARGE][tid]);
 }
 
-INLINE net_buffer_t *comm_server_pop_recv_buff(uint32_t tid)
+INLINE net_buffer_t *comm_server_pop_ctrl_send_buff(uint32_t tid)
 {
-    channel_t *ch = &(cs.recv_channels[tid]);
-    if (ch->current_buff == NULL)
-        ch_queue_pop(&ch->queue, &ch->current_buff);
-    return ch->current_buff;
+    return comm_server_chan_pop_send(&cs.ctrl_send_channels[tid]);
 }
 
-INLINE void comm_server_push_recv_buff(uint32_t tid)
+/* buffer of the control channel being filled, NULL if none */
+INLINE net_buffer_t *comm_server_open_ctrl_send_buff(uint32_t tid)
 {
-    channel_t *ch = &(cs.recv_channels[tid]);
-    ch_queue_push(&ch->pool, ch->current_buff);
-    ch->current_buff = NULL;
+    return cs.ctrl_send_channels[tid].current_buff;
+}
+
+INLINE void comm_server_push_ctrl_send_buff(uint32_t tid)
+{
+    comm_server_chan_push_send(&cs.ctrl_send_channels[tid]);
+}
+
+INLINE net_buffer_t *comm_server_pop_ctrl_recv_buff(uint32_t tid)
+{
+    return comm_server_chan_pop_recv(&cs.ctrl_recv_channels[tid]);
+}
+
+INLINE void comm_server_push_ctrl_recv_buff(uint32_t tid)
+{
+    comm_server_chan_push_recv(&cs.ctrl_recv_channels[tid]);
+}
+
+INLINE void comm_server_rndv_push(rndv_req_t * volatile *head, rndv_req_t * r)
+{
+    rndv_req_t *old;
+    do {
+        old = *head;
+        r->next = old;
+    } while (!__sync_bool_compare_and_swap(head, old, r));
+}
+
+/* take the whole stack at once. Several helpers take from cs.rndv_done,
+   this is still ABA-safe: the exchange never reads a node of the stack, 
+   and the CAS in comm_server_rndv_push() only links a node that the 
+   pusher owns, so a head freed and reused at the same address is fine */
+INLINE rndv_req_t *comm_server_rndv_take(rndv_req_t * volatile *head)
+{
+    if (*head == NULL)
+        return NULL;
+    return __sync_lock_test_and_set(head, NULL);
+}
+
+/* hand a rendezvous send or receive to the comm server of rnid */
+INLINE void comm_server_post_rndv(bool is_send, uint32_t rnid, uint8_t * data,
+                                  uint64_t nbytes, int tag, uint32_t tid)
+{
+    rndv_req_t *r = (rndv_req_t *) _malloc(sizeof(rndv_req_t));
+    r->is_send = is_send;
+    r->rnid = rnid;
+    r->data = data;
+    r->nbytes = nbytes;
+    r->tag = tag;
+    r->tid = tid;
+    comm_server_thread_t *t = &cs.threads[network_comm_of(rnid)];
+    comm_server_rndv_push(&t->rndv_new, r);
+    idle_wake(&t->idle);
 }
 
 #endif
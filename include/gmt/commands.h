@@ -50,7 +50,7 @@
 #define ARGS_SIZE_BITS                          20
 #define TID_BITS                                20
 #define NESTING_BITS                            5
-#define CMD_TYPE_BITS                           5
+#define CMD_TYPE_BITS                           6
 #define VIRT_ADDR_PTR_BITS                      48
 #define ITER_BITS                               48
 
@@ -82,8 +82,22 @@
 #define GMT_CMD_MEM_PUT                         21
 #define GMT_CMD_MEM_GET                         22
 #define GMT_CMD_MEM_STRIDED_PUT                 23
-
-#define GMT_MAX_CMD_NUM                         23
+#define GMT_CMD_PUT_RNDV                        24
+#define GMT_CMD_MEM_PUT_RNDV                    25
+#define GMT_CMD_REPLY_ACK_BATCH                 26
+#define GMT_CMD_ROUTE                           27
+#define GMT_CMD_PUT_VALUE_C                     28
+#define GMT_CMD_ATOMIC_ADD_C                    29
+#define GMT_CMD_GATHER                          30
+#define GMT_CMD_REPLY_GATHER                    31
+#define GMT_CMD_ATOMIC_ADD_RET_C                32
+#define GMT_CMD_SCATTER                         33
+#define GMT_CMD_ATOMIC_OP                       34
+#define GMT_CMD_ATOMIC_OP_NF                    35
+#define GMT_CMD_QUIET                           36
+#define GMT_CMD_REPLY_QUIET                     37
+
+#define GMT_MAX_CMD_NUM                         37
 
 typedef uint8_t cmd_type_t;
 
@@ -117,6 +131,8 @@ typedef struct PACKED_STR {
   alloc_type_t alloc_type;
   uint64_t num_elems;
   uint64_t bytes_per_elem;
+  uint64_t dist_block_elems;
+  uint32_t dist_id;
   uint16_t name_len;
 } cmd_alloc_t;
 
@@ -154,6 +170,25 @@ typedef struct PACKED_STR {
   uint64_t put_bytes;
 } cmd_mem_strided_put_t;
 
+/* rendezvous put descriptors, the payload follows in its own message 
+ * with the given tag */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  gmt_data_t gmt_array;
+  uint64_t offset;
+  uint64_t put_bytes;
+  int32_t tag;
+} cmd_put_rndv_t;
+
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  uint8_t* address;
+  uint64_t put_bytes;
+  int32_t tag;
+} cmd_mem_put_rndv_t;
+
 typedef struct PACKED_STR {
   cmd_type_t type:CMD_TYPE_BITS;
   uint32_t tid:TID_BITS;
@@ -181,6 +216,43 @@ typedef struct PACKED_STR {
   uint64_t value;
 } cmd_atomic_add_t;
 
+/* atomic op (atomic_op_t) on an element, without a ret_value_ptr only an ack
+ * is sent back */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  uint8_t op;
+  gmt_data_t gmt_array;
+  uint64_t offset;
+  uint64_t ret_value_ptr:VIRT_ADDR_PTR_BITS;
+  uint64_t value;
+} cmd_atomic_op_t;
+
+/* non-fetching atomic op, nothing is sent back, the destination only counts
+ * the ops applied for each source node (see GMT_CMD_QUIET) */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint8_t op;
+  gmt_data_t gmt_array;
+  uint64_t offset;
+  uint64_t value;
+} cmd_atomic_op_nf_t;
+
+/* asks the number of GMT_CMD_ATOMIC_OP_NF applied from the source node,
+ * returned by GMT_CMD_REPLY_QUIET */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+} cmd_quiet_t;
+
+/* answer to the quiet queries of a buffer, the command is followed by the
+ * num_tids uint32_t tids that asked, each credited as one ack */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint8_t num_tids;
+  uint64_t applied;
+} cmd_rep_quiet_t;
+
 typedef struct PACKED_STR {
   cmd_type_t type:CMD_TYPE_BITS;
   uint32_t tid:TID_BITS;
@@ -213,6 +285,67 @@ typedef struct PACKED_STR {
   uint64_t get_bytes;
 } cmd_rep_get_t;
 
+/* gets of num elements of gmt_array for the same uthread, the command is
+ * followed by num gather_ent_t. Element i goes to 
+ * ret_data_ptr + idx * nbytes_elem on the requesting node */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  gmt_data_t gmt_array;
+  uint64_t ret_data_ptr:VIRT_ADDR_PTR_BITS;
+  uint16_t num;
+} cmd_gather_t;
+
+typedef struct PACKED_STR {
+  uint64_t offset;              /* in bytes on the remote node */
+  uint32_t idx;
+} gather_ent_t;
+
+/* reply to a GMT_CMD_GATHER, the command is followed by the num idx 
+ * (uint32_t) of the request and then by the num values, packed */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  uint64_t ret_data_ptr:VIRT_ADDR_PTR_BITS;
+  uint32_t nbytes_elem;
+  uint16_t num;
+} cmd_rep_gather_t;
+
+/* puts (SCATTER_OP_PUT) or atomic adds (SCATTER_OP_ADD) to num elements of
+ * gmt_array for the same uthread, the command is followed by num entries
+ * made of the offset in bytes on the remote node (uint64_t) and the value,
+ * nbytes_elem bytes for a put and an int64_t for an add. A single ack 
+ * answers the whole command */
+#define SCATTER_OP_PUT                          0
+#define SCATTER_OP_ADD                          1
+
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t tid:TID_BITS;
+  uint8_t op;
+  gmt_data_t gmt_array;
+  uint16_t num;
+} cmd_scatter_t;
+
+/* max number of elements in a GMT_CMD_REPLY_GATHER, which must fit in a 
+ * command block even when routed */
+#define REPLY_GATHER_MAX(nbytes_elem) \
+  ((CMD_BLOCK_SIZE - sizeof(cmd_route_t) - sizeof(cmd_rep_gather_t)) / \
+   (sizeof(uint32_t) + (nbytes_elem)))
+
+/* bytes acknowledged to one uthread by a GMT_CMD_REPLY_ACK_BATCH */
+typedef struct PACKED_STR {
+  uint32_t tid;
+  uint32_t nbytes;
+} rep_ack_t;
+
+/* acknowledgements coalesced while parsing a buffer, 
+ * the command is followed by num_acks rep_ack_t */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint8_t num_acks;
+} cmd_rep_ack_batch_t;
+
 typedef struct PACKED_STR {
   cmd_type_t type:CMD_TYPE_BITS;
   uint32_t pid:TID_BITS;
@@ -253,6 +386,47 @@ typedef struct PACKED_STR {
   uint8_t nest_lev:NESTING_BITS;
 } cmd_for_compl_t;
 
+/* cmds_bytes of commands without data sent by src to dst through a proxy,
+ * they follow this header */
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint32_t dst;
+  uint32_t src;
+  uint32_t cmds_bytes;
+} cmd_route_t;
+
+/* Compact encoding (config.compact_cmds) of GMT_CMD_PUT_VALUE and 
+ * GMT_CMD_ATOMIC_ADD, used in place of cmd_put_value_t and cmd_atomic_add_t.
+ * Atomic adds that return the old value are GMT_CMD_ATOMIC_ADD_RET_C.
+ * The header byte is followed by varints:
+ *   gmt_array                 if CMD_C_ARRAY, else same as previous command
+ *   tid                       if CMD_C_TID, else same as previous command
+ *   zigzag(offset - previous offset)
+ *   value                     zigzag for atomic add
+ *   ret_value_ptr             GMT_CMD_ATOMIC_ADD_RET_C only
+ * "previous" refers to the last compact command of the same command block,
+ * encoder and decoder start every block from cmd_c_state_reset() */
+#define CMD_C_ARRAY             0x1
+#define CMD_C_TID               0x2
+
+#define VARINT_MAX_BYTES        10
+#define CMD_C_MAX_BYTES         (1 + 5 * VARINT_MAX_BYTES)
+
+typedef struct PACKED_STR {
+  cmd_type_t type:CMD_TYPE_BITS;
+  uint8_t flags:8 - CMD_TYPE_BITS;
+} cmd_c_t;
+
+/* the header flags share the byte with the command type */
+static_assert((CMD_C_ARRAY | CMD_C_TID) < (1 << (8 - CMD_TYPE_BITS)),
+              "compact command flags do not fit in cmd_c_t");
+
+typedef struct cmd_c_state_t {
+  gmt_data_t gmt_array;
+  uint64_t offset;
+  uint32_t tid;
+} cmd_c_state_t;
+
 typedef struct PACKED_STR {
   cmd_type_t type:CMD_TYPE_BITS;
   gmt_handle_t handle;
@@ -296,6 +470,94 @@ typedef struct PACKED_STR {
 // }
 //
 
+INLINE void cmd_c_state_reset(cmd_c_state_t * st)
+{
+  st->gmt_array = 0;
+  st->offset = 0;
+  st->tid = 0;
+}
+
+INLINE uint32_t cmd_put_varint(uint8_t * p, uint64_t v)
+{
+  uint32_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t) (v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t) v;
+  return n;
+}
+
+INLINE uint64_t cmd_get_varint(uint8_t ** p)
+{
+  uint8_t *q = *p;
+  uint64_t v = *q & 0x7f;
+  uint32_t shift = 7;
+  while (*q++ & 0x80) {
+    v |= (uint64_t) (*q & 0x7f) << shift;
+    shift += 7;
+  }
+  *p = q;
+  return v;
+}
+
+INLINE uint64_t cmd_zigzag(int64_t v)
+{
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+INLINE int64_t cmd_unzigzag(uint64_t v)
+{
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/* encode a compact command of type in p, returns its size */
+INLINE uint32_t cmd_c_encode(uint8_t * p, cmd_c_state_t * st, uint8_t type,
+                             uint32_t tid, gmt_data_t gmt_array,
+                             uint64_t offset, uint64_t value,
+                             uint64_t ret_value_ptr)
+{
+  cmd_c_t *c = (cmd_c_t *) p;
+  uint32_t n = sizeof(cmd_c_t);
+  uint8_t flags = 0;
+  if (gmt_array != st->gmt_array) {
+    flags |= CMD_C_ARRAY;
+    n += cmd_put_varint(p + n, (uint64_t) gmt_array);
+    st->gmt_array = gmt_array;
+  }
+  if (tid != st->tid) {
+    flags |= CMD_C_TID;
+    n += cmd_put_varint(p + n, tid);
+    st->tid = tid;
+  }
+  n += cmd_put_varint(p + n, cmd_zigzag((int64_t) (offset - st->offset)));
+  st->offset = offset;
+  n += cmd_put_varint(p + n, value);
+  if (type == GMT_CMD_ATOMIC_ADD_RET_C)
+    n += cmd_put_varint(p + n, ret_value_ptr);
+  c->type = type;
+  c->flags = flags;
+  return n;
+}
+
+/* decode the compact command at *p updating st, *p moves past it */
+INLINE uint8_t cmd_c_decode(uint8_t ** p, cmd_c_state_t * st,
+                            uint64_t * value, uint64_t * ret_value_ptr)
+{
+  cmd_c_t *c = (cmd_c_t *) *p;
+  uint8_t *q = *p + sizeof(cmd_c_t);
+  if (c->flags & CMD_C_ARRAY)
+    st->gmt_array = (gmt_data_t) cmd_get_varint(&q);
+  if (c->flags & CMD_C_TID)
+    st->tid = (uint32_t) cmd_get_varint(&q);
+  st->offset += (uint64_t) cmd_unzigzag(cmd_get_varint(&q));
+  *value = cmd_get_varint(&q);
+  *ret_value_ptr = (c->type == GMT_CMD_ATOMIC_ADD_RET_C) ?
+    cmd_get_varint(&q) : 0;
+  *p = q;
+  return c->type;
+}
+
 INLINE uint64_t commands_max_cmd_size()
 {
 
@@ -308,18 +570,30 @@ INLINE uint64_t commands_max_cmd_size()
     sizeof(cmd_put_t),
     sizeof(cmd_mem_put_t),
     sizeof(cmd_mem_strided_put_t),
+    sizeof(cmd_put_rndv_t),
+    sizeof(cmd_mem_put_rndv_t),
     sizeof(cmd_put_value_t),
     sizeof(cmd_atomic_cas_t),
     sizeof(cmd_atomic_add_t),
+    sizeof(cmd_atomic_op_t),
+    sizeof(cmd_atomic_op_nf_t),
+    sizeof(cmd_quiet_t),
+    sizeof(cmd_rep_quiet_t),
     sizeof(cmd_get_t),
     sizeof(cmd_mem_get_t),
     sizeof(cmd_rep_value_t),
     sizeof(cmd_rep_get_t),
+    sizeof(cmd_rep_ack_batch_t),
+    sizeof(cmd_gather_t),
+    sizeof(cmd_rep_gather_t),
+    sizeof(cmd_scatter_t),
     sizeof(cmd_exec_t),
     sizeof(cmd_exec_compl_t),
     sizeof(cmd_for_t),
     sizeof(cmd_for_compl_t),
-    sizeof(cmd_check_handle_t)};
+    sizeof(cmd_check_handle_t),
+    sizeof(cmd_route_t),
+    CMD_C_MAX_BYTES};
 
   uint64_t i;
   uint64_t max = 0;
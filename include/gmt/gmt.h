@@ -175,7 +175,15 @@ typedef enum alloc_type_t {
     /**< Allocate a replicated array in all nodes. Each replica has the same 
      * size */
     GMT_ALLOC_REPLICATE = 5,
-    GMT_ALLOC_PERNODE = 6, /**< This is not used */
+    /**< Distribute blocks of elements using a distribution registered with
+     * ::gmt_register_dist(). Only valid through ::gmt_alloc_custom(). */
+    GMT_ALLOC_CUSTOM = 6,
+    /**< Deprecated, it was never supported and ::gmt_alloc() rejects it */
+    GMT_ALLOC_PERNODE = GMT_ALLOC_CUSTOM,
+    /**< Distribute blocks of elements round robin among nodes starting 
+     * from node 0 (block size from --gmt_block_cyclic_elems, or 
+     * ::gmt_alloc_block_cyclic()). */
+    GMT_ALLOC_BLOCK_CYCLIC = 7,
     /**< Initialize to all bytes to ZERO  */
     GMT_ALLOC_ZERO = 8,
     /**< Allocate on RAM */
@@ -185,9 +193,43 @@ typedef enum alloc_type_t {
     /**< Allocate on SSD  (always permanent) */
     GMT_ALLOC_SSD = 32,
     /**< Allocate on DISK (always permanent) */
-    GMT_ALLOC_DISK = 48
+    GMT_ALLOC_DISK = 48,
+    /**< Back the local data with huge pages (--gmt_hugepage_kb), falling 
+     * back to transparent huge pages and then to normal pages. SHM arrays
+     * on a state use --gmt_hugetlbfs_path when given. */
+    GMT_ALLOC_HUGEPAGE = 64
 } alloc_type_t;
 
+/**
+ *  Identifier of a custom distribution returned by ::gmt_register_dist()
+ *  
+ *  @ingroup  GMT_module
+ */
+typedef uint32_t gmt_dist_t;
+
+/**
+ *  Mapping functions of a custom distribution.
+ *  
+ *  An array is split in num_blocks blocks of the same number of elements
+ *  (the last one can be shorter). owner() returns the node of a global 
+ *  block and local_block() its index among the blocks of that node. 
+ *  Local indexes of a node must follow the global order of its blocks 
+ *  (global_block() is the increasing inverse of local_block()) and 
+ *  num_local_blocks() returns how many blocks node nid owns.
+ *  All functions must be pure and give the same result on every node.
+ *  
+ *  @ingroup  GMT_module
+ */
+typedef struct gmt_dist_funcs_t {
+    uint32_t (*owner) (uint64_t block, uint64_t num_blocks, uint32_t num_nodes);
+    uint64_t (*local_block) (uint64_t block, uint64_t num_blocks,
+                             uint32_t num_nodes);
+    uint64_t (*global_block) (uint32_t nid, uint64_t lblock,
+                              uint64_t num_blocks, uint32_t num_nodes);
+    uint64_t (*num_local_blocks) (uint32_t nid, uint64_t num_blocks,
+                                  uint32_t num_nodes);
+} gmt_dist_funcs_t;
+
 /**
  *  Spawn policies for GMT tasks.
  *   
@@ -226,6 +268,27 @@ typedef enum preempt_policy_tag {
                               spawn other tasks */
 } preempt_policy_t;
 
+/**
+ *  Operations of the extended atomics.
+ *   
+ *  Operations applied by gmt_atomic_op() and gmt_atomic_op_nb() to an 
+ *  element of 8,4,2 or 1 bytes, the element is treated as a signed integer.
+ *  @ingroup  GMT_module
+ */
+typedef enum atomic_op_tag {
+    GMT_ATOMIC_AND,      /**< element = element & value */
+    GMT_ATOMIC_OR,       /**< element = element | value */
+    GMT_ATOMIC_XOR,      /**< element = element ^ value */
+    GMT_ATOMIC_MIN,      /**< element = MIN(element, value) */
+    GMT_ATOMIC_MAX,      /**< element = MAX(element, value) */
+    GMT_ATOMIC_SWAP,     /**< element = value */
+    GMT_ATOMIC_FADD,     /**< element = element + value on a double (8 bytes)
+                              or float (4 bytes) element, value and result 
+                              hold the bits of a double, use 
+                              gmt_atomic_fadd() */
+    GMT_ATOMIC_ADD       /**< element = element + value */
+} atomic_op_t;
+
 /* @cond INTERNAL */
 
 /** 
@@ -376,6 +439,56 @@ extern "C" {
 
     gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
                          alloc_type_t alloc_type, const char *array_name);
+
+    /** 
+     * Allocates a GMT array distributing blocks of block_elems elements 
+     * round robin among the nodes (as ::GMT_ALLOC_BLOCK_CYCLIC with a 
+     * given block size). The distribution bits of alloc_type are ignored,
+     * the ZERO and media bits are honored.
+     *
+     * @param[in] num_elems to allocate.
+     * @param[in] bytes_per_elem size in bytes of each element to allocate
+     * @param[in] block_elems number of consecutive elements on the same node
+     * @param[in] alloc_type ::alloc_type_t flags (ZERO and media)
+     * @param[in] array_name name of this array
+     *
+     * @ingroup GMT_module
+     */
+    gmt_data_t gmt_alloc_block_cyclic(uint64_t num_elems,
+                         uint64_t bytes_per_elem, uint64_t block_elems,
+                         alloc_type_t alloc_type, const char *array_name);
+
+    /** 
+     * Allocates a GMT array distributing blocks of block_elems elements 
+     * with a custom distribution registered with ::gmt_register_dist().
+     * The distribution bits of alloc_type are ignored, the ZERO and media 
+     * bits are honored.
+     *
+     * @param[in] num_elems to allocate.
+     * @param[in] bytes_per_elem size in bytes of each element to allocate
+     * @param[in] block_elems number of elements of each block
+     * @param[in] dist distribution returned by ::gmt_register_dist()
+     * @param[in] alloc_type ::alloc_type_t flags (ZERO and media)
+     * @param[in] array_name name of this array
+     *
+     * @ingroup GMT_module
+     */
+    gmt_data_t gmt_alloc_custom(uint64_t num_elems, uint64_t bytes_per_elem,
+                         uint64_t block_elems, gmt_dist_t dist,
+                         alloc_type_t alloc_type, const char *array_name);
+
+    /** 
+     * Registers a custom distribution on all the nodes. Arrays restored 
+     * from a GMT state keep their distribution identifier, so 
+     * distributions have to be registered in the same order on every run.
+     *
+     * @param[in] funcs mapping functions of the distribution
+     * @returns the identifier to use with ::gmt_alloc_custom()
+     *
+     * @ingroup GMT_module
+     */
+    gmt_dist_t gmt_register_dist(const gmt_dist_funcs_t * funcs);
+
     /** 
      * Returns true if the array associated with the gmt_array is
      * acctualy allocated.
@@ -504,6 +617,53 @@ extern "C" {
                     void *elem, uint64_t num_elem);
     //@}
 
+    //@{
+    /** 
+     * Copy num_elem elements at arbitrary offsets of a GMT array to
+     * consecutive elements of local memory. Remote elements of the same
+     * node travel together in one request and one packed reply, which makes
+     * this much cheaper than one ::gmt_get_nb() for each element.
+     * Non blocking '_nb' waits completion with ::gmt_wait_data(), 
+     * elem must stay valid until then.
+     *
+     * @param[in]  gmt_array source GMT array
+     * @param[in]  elem_offsets offsets in number of elements in the GMT 
+     *    array, one for each element to copy
+     * @param[in]  num_elem number of elements to copy
+     * @param[out] elem pointer to the local elements, elem[i] receives the
+     *    element at elem_offsets[i]
+     *
+     * @ingroup GMT_module
+     */
+    void gmt_gather(gmt_data_t gmt_array, const uint64_t * elem_offsets,
+                    uint64_t num_elem, void *elem);
+    void gmt_gather_nb(gmt_data_t gmt_array, const uint64_t * elem_offsets,
+                       uint64_t num_elem, void *elem);
+    //@}
+
+    //@{
+    /** 
+     * Copy num_elem consecutive local elements to arbitrary offsets of a GMT
+     * array. Remote elements of the same node travel together in one command
+     * that is applied with a single acknowledgement.
+     * Non blocking '_nb' waits completion with ::gmt_wait_data(), 
+     * elem can be reused as soon as the call returns.
+     *
+     * @param[in] gmt_array destination GMT array
+     * @param[in] elem_offsets offsets in number of elements in the GMT 
+     *    array, one for each element to copy
+     * @param[in] elem pointer to the local elements, elem[i] is copied to
+     *    the element at elem_offsets[i]
+     * @param[in] num_elem number of elements to copy
+     *
+     * @ingroup GMT_module
+     */
+    void gmt_scatter(gmt_data_t gmt_array, const uint64_t * elem_offsets,
+                     const void *elem, uint64_t num_elem);
+    void gmt_scatter_nb(gmt_data_t gmt_array, const uint64_t * elem_offsets,
+                        const void *elem, uint64_t num_elem);
+    //@}
+
     /** 
      * Copy memory from a GMT array to another (element version).
      *
@@ -582,9 +742,11 @@ extern "C" {
     /**
      * Waits for completion of any non blocking put/get/atomic data operation on
      * ::gmt_data_t such as ::gmt_put_nb(), ::gmt_put_value_nb(), 
-     * ::gmt_get_nb(), ::gmt_get_value_nb(), ::gmt_atomic_add_nb(),
-     * ::gmt_atomic_cas_nb() and ::gmt_put_value_nb() 
-     *
+     * ::gmt_get_nb(), ::gmt_gather_nb(), ::gmt_scatter_nb(),
+     * ::gmt_get_value_nb(), ::gmt_atomic_add_nb(), ::gmt_scatter_add_nb(),
+     * ::gmt_atomic_op_nb(), ::gmt_atomic_fadd_nb(), ::gmt_atomic_cas_nb()
+     * and ::gmt_put_value_nb(). If the task issued non-fetching operations
+     * it also waits for them as ::gmt_quiet() does.
      *
      * @ingroup GMT_module
      */
@@ -617,6 +779,110 @@ extern "C" {
      void gmt_atomic_add_nb(gmt_data_t gmt_array, uint64_t elem_offset,
                            int64_t value, int64_t * ret_value_ptr);
     //@}
+
+    //@{
+    /** 
+     * Perform an atomic operation (see ::atomic_op_t) into an element of a
+     * GMT array, a remote element is updated by a single command.
+     * Can only be used on arrays containing elements of 8,4,2 or 1 bytes.
+     * Non blocking '_nb' waits completion with ::gmt_wait_data(), with a
+     * NULL ret_value_ptr the value before the operation is not returned.
+     *
+     * @param[in] gmt_array GMT array
+     * @param[in] elem_offset offset in number of elements in the GMT array
+     * @param[in] op operation to perform
+     * @param[in] value operand of the operation
+     *
+     * @return value of the variable before the operation
+     *
+     * @ingroup GMT_module
+     */
+    int64_t gmt_atomic_op(gmt_data_t gmt_array, uint64_t elem_offset,
+                          atomic_op_t op, int64_t value);
+
+    void gmt_atomic_op_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                          atomic_op_t op, int64_t value,
+                          int64_t * ret_value_ptr);
+    //@}
+
+    //@{
+    /** 
+     * Perform an atomic floating point add into an element of a GMT array
+     * of doubles (8 bytes) or floats (4 bytes).
+     * Non blocking '_nb' waits completion with ::gmt_wait_data(), with a
+     * NULL ret_value_ptr the value before the operation is not returned.
+     *
+     * @param[in] gmt_array GMT array
+     * @param[in] elem_offset offset in number of elements in the GMT array
+     * @param[in] value value to add 
+     *
+     * @return value of the variable before the operation
+     *
+     * @ingroup GMT_module
+     */
+    double gmt_atomic_fadd(gmt_data_t gmt_array, uint64_t elem_offset,
+                           double value);
+
+    void gmt_atomic_fadd_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                            double value, double *ret_value_ptr);
+    //@}
+
+    //@{
+    /** 
+     * Non-fetching ("fire and forget") versions of ::gmt_atomic_op_nb(),
+     * ::gmt_atomic_add_nb() and ::gmt_put_value_nb(). A remote node applies
+     * them without replying to each one, it only counts how many it applied
+     * for every source node. Completion is waited with ::gmt_quiet() or
+     * ::gmt_wait_data(). Can only be used on arrays containing elements of
+     * 8,4,2 or 1 bytes, not allocated with GMT_ALLOC_REPLICATE.
+     *
+     * @param[in] gmt_array GMT array
+     * @param[in] elem_offset offset in number of elements in the GMT array
+     * @param[in] op operation to perform
+     * @param[in] value operand of the operation
+     *
+     * @ingroup GMT_module
+     */
+    void gmt_atomic_op_nofetch_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                                  atomic_op_t op, int64_t value);
+    void gmt_atomic_add_nofetch_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                                   int64_t value);
+    void gmt_put_value_nofetch_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                                  uint64_t value);
+    //@}
+
+    /**
+     * Waits until every node that received non-fetching operations from 
+     * this node has applied all those issued before the call (including the
+     * ones of other tasks). Each such node is asked once for the number of
+     * operations it applied, and again only if some were still in flight.
+     *
+     * @ingroup GMT_module
+     */
+    void gmt_quiet();
+
+    //@{
+    /** 
+     * Atomically add values[i] to the element at elem_offsets[i] of a GMT
+     * array for num_elem elements, as many ::gmt_atomic_add_nb() that do not
+     * return the old value. Remote elements of the same node travel together
+     * in one command. Can only be used on arrays containing elements of
+     * 8,4,2 or 1 bytes.
+     * Non blocking '_nb' waits completion with ::gmt_wait_data()
+     *
+     * @param[in] gmt_array GMT array
+     * @param[in] elem_offsets offsets in number of elements in the GMT array
+     * @param[in] values values to add
+     * @param[in] num_elem number of elements to update
+     *
+     * @ingroup GMT_module
+     */
+    void gmt_scatter_add(gmt_data_t gmt_array, const uint64_t * elem_offsets,
+                         const int64_t * values, uint64_t num_elem);
+    void gmt_scatter_add_nb(gmt_data_t gmt_array,
+                            const uint64_t * elem_offsets,
+                            const int64_t * values, uint64_t num_elem);
+    //@}
     
     //@{
     //
@@ -670,6 +936,10 @@ extern "C" {
      * ::gmt_wait_handle(). A valid handle must be requested with
      * ::gmt_get_handle().  
      *
+     * On arrays allocated with ::GMT_ALLOC_BLOCK_CYCLIC or ::GMT_ALLOC_CUSTOM
+     * each call of the function covers elements of a single block, so a task
+     * can call it more than once.
+     *
      * WARNING: these primitives DO NOT GUARANTEE that the task will always be
      * executed on the node that owns the elements. In high-workload scenarios 
      * nodes might be full and the tasks will be executed locally. In case of 
@@ -44,6 +44,9 @@
 /* define number of helpers */
 //#define NUM_HELPERS   (15)
 
+/* define number of communication servers */
+//#define NUM_COMM_SERVERS   (1)
+
 /* max level of nesting a uthread can self-execute */
 //#define MAX_NESTING 64
 
@@ -67,6 +70,30 @@
 /* size in bytes of each command block */
 //#define CMD_BLOCK_SIZE  (4096)
 
+/* number of size classes of the bulk buffers. The largest class is
+   COMM_BUFFER_SIZE and each class is 1 << BUFF_CLASS_SHIFT times smaller
+   than the next one, aggregation picks the smallest class that fits */
+#define NUM_BUFF_CLASSES  (3)
+#define BUFF_CLASS_SHIFT  (4)
+
+/* segments of a scatter-gather send buffer, payloads that would need more
+   are copied into the buffer */
+#define SG_MAX_SEGMENTS  (64)
+
+/* log2 of the slots of the table used to combine put values and atomic
+   adds in a command block (see agm_comb_find) */
+#define AGG_COMB_SLOTS_BITS  (6)
+
+/* pauses of the longest back-off step of an idle thread before parking */
+#define IDLE_MAX_BACKOFF  (1024)
+
+/* size in bytes of the buffers of the control channel, each one carries 
+   the replies, acks and handle checks a thread has for one node */
+#define CTRL_BUFFER_SIZE  (1024)
+
+/* number of buffers per control channel */
+#define NUM_CTRL_BUFFS_PER_CHANNEL  (32)
+
 /* stack size for both workers helpers */
 #define PTHREAD_STACK_SIZE ( 1 << 22)
 
@@ -85,4 +112,7 @@
 /* maximum number of gmt_alloc a node can do */
 #define GMT_MAX_ALLOC_PER_NODE  (64*1024)
 
+/* maximum number of custom distributions a node can register */
+#define GMT_MAX_DIST_PER_NODE  16
+
 #endif                          /* __GMT_CONFIG_H__ */
@@ -92,14 +92,23 @@ void gmt_init_ctxt(ucontext_t * cntxt, void *stack,
 #define XSTR(x) STR(x)
 #define STR(x) #x
 
+/* the context switches leave the caller-saved registers of the other 
+ * context behind, noipa keeps callers from relying on the registers the
+ * asm seems not to touch */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+#define GMT_CTXT_ATTR __attribute__ ((noinline, noipa))
+#else
+#define GMT_CTXT_ATTR __attribute__ ((noinline))
+#endif
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
-void gmt_setcontext(const ucontext_t * ucp) __attribute__ ((noinline));
-void gmt_getcontext(ucontext_t * ucp) __attribute__ ((noinline));
+void gmt_setcontext(const ucontext_t * ucp) GMT_CTXT_ATTR;
+void gmt_getcontext(ucontext_t * ucp) GMT_CTXT_ATTR;
 void gmt_start_context() __attribute__ ((noinline));
 void gmt_init_ctxt(ucontext_t * cntxt, void *stack, int stack_size, ucontext_t * ret_cntxt);
-void gmt_swapcontext(ucontext_t * oucp, const ucontext_t * ucp) __attribute__ ((noinline));
+void gmt_swapcontext(ucontext_t * oucp, const ucontext_t * ucp) GMT_CTXT_ATTR;
 void gmt_makecontext(ucontext_t * ucp, void (*func) (void), int argc, ...) __attribute__ ((noinline));
 #if defined(__cplusplus)
 }
@@ -52,8 +52,38 @@
 #endif
 
 #if !(ENABLE_SINGLE_NODE_ONLY)
+/* maximum number of uthreads acknowledged by one GMT_CMD_REPLY_ACK_BATCH,
+   limited by what fits in a control buffer */
+#define REPLY_ACK_BATCH_MAX ((CTRL_BUFFER_SIZE - sizeof(block_info_t) - \
+      sizeof(cmd_rep_ack_batch_t)) / sizeof(rep_ack_t))
+
+/* acknowledgements for the same remote node pending in a helper */
+typedef struct ack_batch_tag {
+    uint32_t rnid;
+    uint32_t num_acks;
+    rep_ack_t acks[REPLY_ACK_BATCH_MAX];
+} ack_batch_t;
+
+/* maximum number of uthreads answered by one GMT_CMD_REPLY_QUIET */
+#define REPLY_QUIET_BATCH_MAX ((CTRL_BUFFER_SIZE - sizeof(block_info_t) - \
+      sizeof(cmd_rep_quiet_t)) / sizeof(uint32_t))
+
+/* quiet queries of the same remote node pending in a helper */
+typedef struct quiet_batch_tag {
+    uint32_t rnid;
+    uint32_t num_tids;
+    uint32_t tids[REPLY_QUIET_BATCH_MAX];
+} quiet_batch_t;
+
 typedef struct helper_tag {
     net_buffer_t tmp_buff;
+#if !ENABLE_HELPER_BUFF_COPY
+    /* receive buffer parsed in place, NULL once given back */
+    net_buffer_t *in_place;
+    /* one data array for each size class, swapped with the one of in_place
+     * when it is given back before the end of the parsing */
+    uint8_t *spare_data[NUM_BUFF_CLASSES];
+#endif
     pthread_t pthread;
 
     /* start and end id of the nodes for which this helper 
@@ -61,6 +91,10 @@ typedef struct helper_tag {
     uint32_t part_start_node_id;
     uint32_t part_end_node_id;
     uint32_t aggr_timeout_interval;
+    backoff_t backoff;
+
+    /* non-fetching operations applied by this helper for each node */
+    volatile uint64_t *nf_applied;
     
 #if NO_RESERVE
     std::queue<mtask_t *> *pending;
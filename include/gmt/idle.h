@@ -0,0 +1,143 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2024, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __IDLE_H__
+#define __IDLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "gmt/config.h"
+#include "gmt/debug.h"
+#include "gmt/utils.h"
+#include "gmt/profiling.h"
+
+/* Spin-then-park policy for the comm servers, helpers and workers. 
+ * After config.idle_spins empty iterations in a row a thread starts backing 
+ * off with an exponentially growing number of pauses, once the back-off 
+ * reaches IDLE_MAX_BACKOFF it parks on the futex word of an idle_t (which
+ * can be shared by several threads, each one with its own backoff_t). 
+ * Producers call idle_wake() after pushing work for a thread, it is only a
+ * load when nobody is parked. A wakeup that races with the thread going to 
+ * sleep is caught by the park timeout (config.idle_park_usec), which is the
+ * latency budget of the policy. 
+ * idle_spins == 0 disables the policy (threads spin as before). */
+typedef struct idle_t {
+    volatile uint32_t seq;      /* futex word, bumped by every wakeup */
+    volatile uint32_t parked;   /* threads parked on seq */
+} idle_t;
+
+typedef struct backoff_t {
+    uint32_t misses;            /* empty iterations in a row */
+    uint32_t pauses;            /* pauses of the next back-off step */
+} backoff_t;
+
+INLINE void idle_init(idle_t * id)
+{
+    id->seq = 0;
+    id->parked = 0;
+}
+
+INLINE void backoff_init(backoff_t * bo)
+{
+    bo->misses = 0;
+    bo->pauses = 1;
+}
+
+INLINE void idle_wake(idle_t * id)
+{
+    if (config.idle_spins == 0 || id->parked == 0)
+        return;
+    __sync_fetch_and_add(&id->seq, 1);
+    syscall(SYS_futex, &id->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/* the thread found work to do */
+INLINE void idle_reset(backoff_t * bo)
+{
+    bo->misses = 0;
+    bo->pauses = 1;
+}
+
+INLINE void idle_park(idle_t * id)
+{
+#if ENABLE_PROFILING
+    uint64_t start = rdtsc();
+#endif
+    uint32_t seq = id->seq;
+    __sync_fetch_and_add(&id->parked, 1);
+    struct timespec ts;
+    ts.tv_sec = config.idle_park_usec / 1000000;
+    ts.tv_nsec = (config.idle_park_usec % 1000000) * 1000;
+    syscall(SYS_futex, &id->seq, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+    __sync_fetch_and_sub(&id->parked, 1);
+    INCR_EVENT(IDLE_PARK_CYCLES, rdtsc() - start);
+    COUNT_EVENT(IDLE_PARKS);
+}
+
+/* the next idle_miss() may park the thread, callers evaluate costly 
+ * can_park conditions only when this is true */
+INLINE bool idle_may_park(backoff_t * bo)
+{
+    return config.idle_spins != 0 && bo->misses + 1 >= config.idle_spins &&
+        bo->pauses >= IDLE_MAX_BACKOFF;
+}
+
+/* the thread found nothing to do, can_park is false when the thread has
+ * pending work that only polling can complete */
+INLINE void idle_miss(idle_t * id, backoff_t * bo, bool can_park)
+{
+    if (config.idle_spins == 0 || ++bo->misses < config.idle_spins)
+        return;
+    if (bo->pauses < IDLE_MAX_BACKOFF) {
+#if ENABLE_PROFILING
+        uint64_t start = rdtsc();
+#endif
+        uint32_t i;
+        for (i = 0; i < bo->pauses; i++)
+            __asm__ __volatile__("pause");
+        bo->pauses <<= 1;
+        INCR_EVENT(IDLE_SPIN_CYCLES, rdtsc() - start);
+    } else if (can_park && config.idle_park_usec != 0) {
+        idle_park(id);
+    } else {
+        sched_yield();
+    }
+}
+
+#endif                          /* __IDLE_H__ */
@@ -98,13 +98,55 @@
 #define GD_SNODE_MASK         ((( 1l << GD_SNODE_END_BIT) - 1) - (( 1l << GD_SNODE_START_BIT) - 1))
 #define GD_SET_SNODE(g,i)     ((g) = ((g) & ~GD_SNODE_MASK) | ((((uint64_t) (i)) << GD_SNODE_START_BIT) & GD_SNODE_MASK))
 #define GD_GET_SNODE(g)       (uint32_t) (((g) & GD_SNODE_MASK) >> GD_SNODE_START_BIT)
+
+/* data on huge pages (GMT_ALLOC_HUGEPAGE), kept out of the type bits */
+#define GD_HUGE_BIT           47
+#define GD_SET_HUGE(g,b)      ((g) = ((g) & ~(1l << GD_HUGE_BIT)) | (((uint64_t) ((b) != 0)) << GD_HUGE_BIT))
+#define GD_GET_HUGE(g)        (uint32_t) (((g) >> GD_HUGE_BIT) & 1l)
+
+/* GMT_ALLOC_CUSTOM (6) and GMT_ALLOC_BLOCK_CYCLIC (7) split the array in 
+ * fixed size blocks instead of one contiguous partition per node */
+#define GD_IS_DIST_BLOCKED(g) ((GD_GET_TYPE_DISTR(g) & 6) == 6)
 /*****************************************************************************/
 
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/* kind of pages backing the data of a gentry */
+#define MEM_PAGES_DEFAULT       0
+#define MEM_PAGES_HUGETLB       1
+#define MEM_PAGES_THP           2
+/* huge pages were requested but are not available */
+#define MEM_PAGES_SMALL         3
+#define MEM_PAGES_NUM           4
+
 #define GMT_NO_LOCAL_DATA       INT64_MAX
 #define GMT_FILE_BLOCK_SIZE     (1024*1024)
 
+/* the gentry table is a directory of chunks of GENTRY_CHUNK_SIZE entries,
+ * a chunk is materialized by the first allocation that falls in it */
+#define GENTRY_CHUNK_BITS       8
+#define GENTRY_CHUNK_SIZE       (1u << GENTRY_CHUNK_BITS)
+#define GENTRY_CHUNK_MASK       (GENTRY_CHUNK_SIZE - 1)
+
 DEFINE_QUEUE_MPMC(mem_id_pool, uint64_t, GMT_MAX_ALLOC_PER_NODE);
 
+/* initial number of slots of the index of named arrays (power of 2) */
+#define MEM_NAMES_INIT_SLOTS    1024
+
+#define MEM_NAME_EMPTY          0
+#define MEM_NAME_USED           1
+#define MEM_NAME_DELETED        2
+
+/* slot of the open-addressing index of named arrays, the name itself is 
+ * the one of the gentry at gid */
+typedef struct mem_name_slot_t {
+    uint64_t hash;
+    uint32_t gid;
+    uint32_t state;
+} mem_name_slot_t;
+
 typedef struct gentry_t {
     /* number of bytes total for this gmt_array */
     uint64_t nbytes_tot;
@@ -115,6 +157,11 @@ typedef struct gentry_t {
     uint64_t nbytes_block;
     /* global offset of this gmt_array owned by this node */
     uint64_t goffset_bytes;
+    /* number of bytes of each distribution block for GMT_ALLOC_CUSTOM and
+     * GMT_ALLOC_BLOCK_CYCLIC (0 for the other policies) */
+    uint64_t nbytes_dist_block;
+    /* distribution used by GMT_ALLOC_CUSTOM */
+    uint32_t dist_id;
     /* number of bytes of each element */
     uint64_t nbytes_elem;
     /* pointer to the actual data in this node */
@@ -125,11 +172,38 @@ typedef struct gentry_t {
     char *name;
     /* flag used for allocations that are temporary, used for final cleaning */
     bool is_tmp;
+    /* data is attached to the RMA window */
+    bool rma_attached;
+    /* RMA address of the data on each node, fetched on first use 
+     * (MEM_RMA_UNKNOWN) and 0 if that node did not attach it */
+    uint64_t *rma_raddr;
+    /* bytes mapped for data when it does not come from malloc */
+    uint64_t nbytes_mapped;
+    /* MEM_PAGES_* backing data */
+    uint8_t page_mode;
 } gentry_t;
 
 typedef struct memory_t {
     mem_id_pool_t mem_id_pool;
-    gentry_t *gentry;
+    /* chunks of the gentry table indexed by gid >> GENTRY_CHUNK_BITS 
+     * (NULL until used) */
+    gentry_t *volatile *gentry_dir;
+    uint32_t gentry_dir_size;
+
+    /* index of the named arrays (name -> gid), protected by names_lock */
+    mem_name_slot_t *names;
+    uint32_t names_cap;
+    /* used and deleted slots */
+    uint32_t names_filled;
+    volatile uint32_t names_lock;
+
+    /* bytes allocated on each MEM_PAGES_* kind of page for arrays that 
+     * asked for huge pages */
+    uint64_t nbytes_pages[MEM_PAGES_NUM];
+
+    /* custom distributions registered by all the nodes */
+    gmt_dist_funcs_t *dists;
+    uint32_t num_dists;
 
     long shmem_size_total;
     long shmem_size_used;
@@ -142,6 +216,38 @@ extern memory_t mem;
 
 void mem_init();
 void mem_destroy();
+void mem_name_insert(const char *name, uint32_t gid);
+void mem_name_remove(const char *name, uint32_t gid);
+gentry_t *mem_name_lookup(const char *name);
+
+/* returns the gentry of gid or NULL if its chunk was never used */
+INLINE gentry_t *mem_gentry_lookup(uint32_t gid)
+{
+    _assert(gid < num_nodes * GMT_MAX_ALLOC_PER_NODE);
+    gentry_t *chunk = mem.gentry_dir[gid >> GENTRY_CHUNK_BITS];
+    if (chunk == NULL)
+        return NULL;
+    return &chunk[gid & GENTRY_CHUNK_MASK];
+}
+
+/* returns the gentry of gid allocating its chunk if needed, helpers and 
+ * workers can race on the same chunk so it is published with a CAS */
+INLINE gentry_t *mem_gentry_materialize(uint32_t gid)
+{
+    _assert(gid < num_nodes * GMT_MAX_ALLOC_PER_NODE);
+    gentry_t *volatile *slot = &mem.gentry_dir[gid >> GENTRY_CHUNK_BITS];
+    gentry_t *chunk = *slot;
+    if (chunk == NULL) {
+        gentry_t *n = (gentry_t *) _calloc(GENTRY_CHUNK_SIZE,
+                                           sizeof(gentry_t));
+        chunk = __sync_val_compare_and_swap(slot, NULL, n);
+        if (chunk == NULL)
+            chunk = n;
+        else
+            free(n);
+    }
+    return &chunk[gid & GENTRY_CHUNK_MASK];
+}
 
 INLINE uint32_t mem_get_alloc_id()
 {
@@ -157,11 +263,133 @@ INLINE uint32_t mem_get_alloc_id()
     while (!mem_id_pool_pop(&mem.mem_id_pool, &id));        
 
     int gid = node_id * GMT_MAX_ALLOC_PER_NODE + id;
-    _assert(mem.gentry[gid].nbytes_elem == 0);
+    _assert(mem_gentry_lookup(gid) == NULL ||
+            mem_gentry_lookup(gid)->nbytes_elem == 0);
     _unused(gid);
     return id;
 }
 
+INLINE uint64_t mem_hugepage_bytes()
+{
+    return config.hugepage_kb * 1024;
+}
+
+/* data of ga asks for huge pages, with GMT_ALLOC_HUGEPAGE or with 
+ * --gmt_hugepages for local partitions of at least one huge page */
+INLINE bool mem_wants_hugepages(gentry_t * ga)
+{
+    return GD_GET_HUGE(ga->gmt_array) ||
+        (config.hugepages && ga->nbytes_loc >= mem_hugepage_bytes());
+}
+
+INLINE void mem_count_pages(gentry_t * ga, uint8_t page_mode, uint64_t nbytes)
+{
+    ga->page_mode = page_mode;
+    __sync_add_and_fetch(&mem.nbytes_pages[page_mode], nbytes);
+}
+
+/* maps the local data of ga on huge pages, first reserved ones 
+ * (MAP_HUGETLB) then transparent ones, and on normal pages if neither is 
+ * available. Anonymous mappings are zeroed so GMT_ALLOC_ZERO is free. */
+INLINE void mem_map_hugepages(gentry_t * ga)
+{
+    uint64_t hp = mem_hugepage_bytes();
+    uint64_t nbytes = CEILING(ga->nbytes_loc, hp) * hp;
+    uint8_t *p = (uint8_t *) MAP_FAILED;
+    uint8_t page_mode = MEM_PAGES_HUGETLB;
+#ifdef MAP_HUGETLB
+    p = (uint8_t *) mmap(NULL, nbytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                         (__builtin_ctzl(hp) << MAP_HUGE_SHIFT), -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        /* map one huge page more to align the data to a huge page 
+         * boundary, otherwise transparent huge pages cannot back it */
+        uint8_t *raw = (uint8_t *) mmap(NULL, nbytes + hp,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            ERRORMSG("mmap() error - trying to allocate %ld bytes in RAM\n",
+                     nbytes);
+        p = (uint8_t *) (((uint64_t) raw + hp - 1) & ~(hp - 1));
+        if (p != raw)
+            munmap(raw, p - raw);
+        munmap(p + nbytes, raw + hp - p);
+        page_mode = MEM_PAGES_SMALL;
+#ifdef MADV_HUGEPAGE
+        if (madvise(p, nbytes, MADV_HUGEPAGE) == 0)
+            page_mode = MEM_PAGES_THP;
+#endif
+    }
+    ga->data = p;
+    ga->nbytes_mapped = nbytes;
+    mem_count_pages(ga, page_mode, nbytes);
+}
+
+INLINE void af_hugetlbfs_name(char *filename, gentry_t * ga)
+{
+    int len = snprintf(filename, PATH_MAX, "%s/GMT_STATES/%s/n%d-%s",
+                       config.hugetlbfs_path, config.state_name, node_id,
+                       ga->name);
+    if (len < 0 || len >= PATH_MAX)
+        ERRORMSG("hugetlbfs path too long for array \"%s\"\n", ga->name);
+}
+
+/* creates the SHM state file of ga on hugetlbfs (--gmt_hugetlbfs_path), 
+ * returns false leaving nothing behind if huge pages are not available */
+INLINE bool af_on_hugetlbfs(gentry_t * ga)
+{
+    char filename[PATH_MAX];
+    af_hugetlbfs_name(filename, ga);
+    int fd = open(filename, (O_CREAT | O_EXCL | O_RDWR), (S_IREAD | S_IWRITE));
+    if (fd == -1)
+        return false;
+
+    /* hugetlbfs files are made of whole huge pages */
+    uint64_t hp = mem_hugepage_bytes();
+    uint64_t tbytes = CEILING(ga->nbytes_loc + sizeof(gentry_t), hp) * hp;
+    uint8_t *p = (uint8_t *) MAP_FAILED;
+    if (ftruncate(fd, tbytes) == 0)
+        p = (uint8_t *) mmap(0, tbytes, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        unlink(filename);
+        return false;
+    }
+
+    ga->is_tmp = false;
+    ga->data = p;
+    ga->nbytes_mapped = tbytes;
+    mem_count_pages(ga, MEM_PAGES_HUGETLB, tbytes);
+    memcpy(ga->data, ga, sizeof(gentry_t));
+    ga->data += sizeof(gentry_t);
+    return true;
+}
+
+/* unmaps the huge pages of ga (header included) and deletes its file */
+INLINE void af_free_hugetlbfs(gentry_t * ga)
+{
+    char filename[PATH_MAX];
+    af_hugetlbfs_name(filename, ga);
+    if (munmap(ga->data - sizeof(gentry_t), ga->nbytes_mapped) == -1)
+        ERRORMSG("munmap() error - freeing array on hugetlbfs\n");
+    if (unlink(filename) == -1) {
+        perror("ERROR:");
+        ERRORMSG("Error deleting array on hugetlbfs");
+    }
+}
+
+/* name of the SHM state file of ga, shm_open() only accepts a single path
+ * component so the state directory is flattened into the name */
+INLINE void af_shm_name(char *filename, gentry_t * ga)
+{
+    int len = snprintf(filename, PATH_MAX, "/GMT_STATES.%s.n%d-%s",
+                       config.state_name, node_id, ga->name);
+    if (len < 0 || len >= PATH_MAX)
+        ERRORMSG("SHM name too long for array \"%s\"\n", ga->name);
+}
+
 /* this function either alloc or free a ga entry on a file (shm, ssd, disk)
   if alloc = true is an allocation otherwise a free */
 INLINE void af_on_file(char *path, gentry_t * ga, bool is_alloc)
@@ -176,8 +404,7 @@ INLINE void af_on_file(char *path, gentry_t * ga, bool is_alloc)
         _assert(ga->name != NULL);
         _assert(config.state_name[0] != '\0');
         _assert(config.state_prot == (PROT_READ | PROT_WRITE));
-        sprintf(filename, "GMT_STATES/%s/n%d-%s", config.state_name, node_id,
-                ga->name);
+        af_shm_name(filename, ga);
 
         if (is_alloc) {
             fd = shm_open(filename, (O_CREAT | O_EXCL | O_RDWR),
@@ -275,6 +502,12 @@ INLINE void alloc_data(gentry_t * ga)
         if (ga->nbytes_loc == 0)
             return;
 
+        if (mem_wants_hugepages(ga)) {
+            mem_map_hugepages(ga);
+            ga->is_tmp = true;
+            return;
+        }
+
         if (GD_GET_TYPE_ZERO(ga->gmt_array))
             ga->data = (uint8_t *) calloc(1, ga->nbytes_loc);
         else
@@ -289,6 +522,11 @@ INLINE void alloc_data(gentry_t * ga)
 
     switch (GD_GET_TYPE_MEDIA(ga->gmt_array)) {
     case GMT_ALLOC_SHM:
+        if (mem_wants_hugepages(ga)) {
+            if (config.hugetlbfs_path[0] != '\0' && af_on_hugetlbfs(ga))
+                break;
+            mem_count_pages(ga, MEM_PAGES_SMALL, ga->nbytes_loc);
+        }
         af_on_file(NULL, ga, true);
         break;
     case GMT_ALLOC_DISK:
@@ -300,8 +538,85 @@ INLINE void alloc_data(gentry_t * ga)
     }
 }
 
+INLINE gmt_dist_funcs_t *mem_get_dist(uint32_t dist_id)
+{
+    _assert(dist_id < num_nodes * GMT_MAX_DIST_PER_NODE);
+    gmt_dist_funcs_t *d = &mem.dists[dist_id];
+    if (d->owner == NULL)
+        ERRORMSG("custom distribution %u not registered\n", dist_id);
+    return d;
+}
+
+/* node that owns global block "block" of a blocked distribution */
+INLINE uint32_t mem_dist_owner(gmt_data_t gmt_array, uint32_t dist_id,
+                               uint64_t block, uint64_t num_blocks)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_BLOCK_CYCLIC)
+        return (block + GD_GET_SNODE(gmt_array)) % num_nodes;
+    return mem_get_dist(dist_id)->owner(block, num_blocks, num_nodes);
+}
+
+/* index of global block "block" among the blocks of its owner */
+INLINE uint64_t mem_dist_local_block(gmt_data_t gmt_array, uint32_t dist_id,
+                                     uint64_t block, uint64_t num_blocks)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_BLOCK_CYCLIC)
+        return block / num_nodes;
+    return mem_get_dist(dist_id)->local_block(block, num_blocks, num_nodes);
+}
+
+/* global block of local block "lblock" of node nid */
+INLINE uint64_t mem_dist_global_block(gmt_data_t gmt_array, uint32_t dist_id,
+                                      uint32_t nid, uint64_t lblock,
+                                      uint64_t num_blocks)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_BLOCK_CYCLIC) {
+        uint32_t off = (nid + num_nodes - GD_GET_SNODE(gmt_array)) % num_nodes;
+        return lblock * num_nodes + off;
+    }
+    return mem_get_dist(dist_id)->global_block(nid, lblock, num_blocks,
+                                               num_nodes);
+}
+
+INLINE uint64_t mem_dist_num_local_blocks(gmt_data_t gmt_array,
+                                          uint32_t dist_id, uint32_t nid,
+                                          uint64_t num_blocks)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_BLOCK_CYCLIC) {
+        uint32_t off = (nid + num_nodes - GD_GET_SNODE(gmt_array)) % num_nodes;
+        if (num_blocks <= off)
+            return 0;
+        return CEILING(num_blocks - off, num_nodes);
+    }
+    return mem_get_dist(dist_id)->num_local_blocks(nid, num_blocks,
+                                                   num_nodes);
+}
+
+/* number of local blocks of node nid that come before global block 
+ * "block" (local blocks follow the global order so this is a binary 
+ * search on the inverse mapping) */
+INLINE uint64_t mem_dist_local_blocks_before(gmt_data_t gmt_array,
+                                             uint32_t dist_id, uint32_t nid,
+                                             uint64_t block,
+                                             uint64_t num_blocks)
+{
+    uint64_t lo = 0;
+    uint64_t hi = mem_dist_num_local_blocks(gmt_array, dist_id, nid,
+                                            num_blocks);
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (mem_dist_global_block(gmt_array, dist_id, nid, mid,
+                                  num_blocks) < block)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
 INLINE void block_partition(uint32_t nid, uint64_t num_elems,
                             uint64_t nbytes_elem, gmt_data_t gmt_array,
+                            uint64_t nbytes_dist_block, uint32_t dist_id,
                             uint64_t * nbytes_loc,
                             uint64_t * nbytes_block, uint64_t * goffset_bytes)
 {
@@ -393,7 +708,28 @@ INLINE void block_partition(uint32_t nid, uint64_t num_elems,
         }
         break;
 
-    case GMT_ALLOC_PERNODE:
+    case GMT_ALLOC_CUSTOM:
+    case GMT_ALLOC_BLOCK_CYCLIC:
+        {
+            /* local blocks follow the global order, so only the last one 
+             * can be shorter and data is laid out without holes */
+            uint64_t nbytes_tot = num_elems * nbytes_elem;
+            uint64_t num_blocks = CEILING(nbytes_tot, nbytes_dist_block);
+            uint64_t nl = mem_dist_num_local_blocks(gmt_array, dist_id, nid,
+                                                    num_blocks);
+            *nbytes_block = nbytes_dist_block;
+            *goffset_bytes = GMT_NO_LOCAL_DATA;
+            *nbytes_loc = 0;
+            if (nl > 0) {
+                uint64_t last = mem_dist_global_block(gmt_array, dist_id, nid,
+                                                      nl - 1, num_blocks);
+                _assert(last < num_blocks);
+                *nbytes_loc = (nl - 1) * nbytes_dist_block +
+                    MIN(nbytes_dist_block, nbytes_tot - last * nbytes_dist_block);
+            }
+        }
+        break;
+
     default:
         ERRORMSG("Allocation policy (%d) unknown!\n",
                  (int)GD_GET_TYPE_DISTR(gmt_array));
@@ -403,19 +739,76 @@ INLINE void block_partition(uint32_t nid, uint64_t num_elems,
 //            *nbytes_loc, *nbytes_block, *goffset_bytes);
 }
 
+#define MEM_RMA_UNKNOWN UINT64_MAX
+
+/* attach the local partition to the RMA window when large enough, the
+ * address of the other partitions is looked up lazily */
+INLINE void mem_rma_alloc(gentry_t * ga, uint64_t nbytes_tot)
+{
+    ga->rma_attached = false;
+    ga->rma_raddr = NULL;
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (!net.rma_enabled || nbytes_tot < config.rma_threshold)
+        return;
+    uint32_t i;
+    ga->rma_raddr = (uint64_t *) _malloc(num_nodes * sizeof(uint64_t));
+    for (i = 0; i < num_nodes; i++)
+        ga->rma_raddr[i] = MEM_RMA_UNKNOWN;
+    if (ga->data != NULL && ga->nbytes_loc >= config.rma_threshold)
+        ga->rma_attached = network_rma_attach(GD_GET_GID(ga->gmt_array),
+                                              ga->data, ga->nbytes_loc);
+#endif
+}
+
+INLINE void mem_rma_free(gentry_t * ga)
+{
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (ga->rma_attached)
+        network_rma_detach(GD_GET_GID(ga->gmt_array), ga->data);
+#endif
+    ga->rma_attached = false;
+    free(ga->rma_raddr);
+    ga->rma_raddr = NULL;
+}
+
+/* RMA address of the partition of ga on rnid, 0 if not available */
+INLINE uint64_t mem_rma_raddr(gentry_t * ga, uint32_t rnid)
+{
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (ga->rma_raddr == NULL)
+        return 0;
+    uint64_t addr = ga->rma_raddr[rnid];
+    if (addr == MEM_RMA_UNKNOWN) {
+        addr = network_rma_lookup(rnid, GD_GET_GID(ga->gmt_array));
+        ga->rma_raddr[rnid] = addr;
+    }
+    return addr;
+#else
+    _unused(ga);
+    _unused(rnid);
+    return 0;
+#endif
+}
+
 INLINE void mem_alloc(gmt_data_t gmt_array, uint64_t num_elems,
-                      uint64_t nbytes_elem, const char *array_name,
+                      uint64_t nbytes_elem, uint64_t dist_block_elems,
+                      uint32_t dist_id, const char *array_name,
                       int name_len)
 {
 
     uint32_t gid = GD_GET_GID(gmt_array);
-    _assert(gid < num_nodes * GMT_MAX_ALLOC_PER_NODE);
-    gentry_t *ga = &mem.gentry[gid];
+    gentry_t *ga = mem_gentry_materialize(gid);
 
     _assert(ga->nbytes_tot == 0);
 
     ga->gmt_array = gmt_array;
     ga->nbytes_elem = nbytes_elem;
+    ga->nbytes_dist_block = 0;
+    ga->dist_id = dist_id;
+    if (GD_IS_DIST_BLOCKED(gmt_array)) {
+        _assert(dist_block_elems > 0);
+        ga->nbytes_dist_block = dist_block_elems * nbytes_elem;
+    }
 
     if (array_name != NULL && name_len != 0) {
         /* if we have permission to modify the state check if name already 
@@ -434,14 +827,17 @@ INLINE void mem_alloc(gmt_data_t gmt_array, uint64_t num_elems,
         _assert(ga->name != NULL);
         memcpy(ga->name, array_name, name_len);
         ga->name[name_len] = '\0';
+        mem_name_insert(ga->name, gid);
     } else {
         ga->name = NULL;
     }
 
     block_partition(node_id, num_elems, nbytes_elem, gmt_array,
+                    ga->nbytes_dist_block, ga->dist_id,
                     &ga->nbytes_loc, &ga->nbytes_block, &ga->goffset_bytes);
 
     alloc_data(ga);
+    mem_rma_alloc(ga, num_elems * nbytes_elem);
 
     /* this write will mark the ga entry available to 
      * memory_get_memory_entry */
@@ -454,12 +850,9 @@ INLINE gentry_t *mem_get_gentry(gmt_data_t gmt_array)
         ERRORMSG("Trying to access GMT_DATA_NULL\n");
 
     uint32_t gid = GD_GET_GID(gmt_array);
-    _assert(gid < num_nodes * GMT_MAX_ALLOC_PER_NODE);
+    gentry_t *ga = mem_gentry_lookup(gid);
 
-    gentry_t *ga = &mem.gentry[gid];
-    _assert(ga != NULL);
-
-    if(ga->nbytes_tot == 0) {
+    if (ga == NULL || ga->nbytes_tot == 0) {
       ERRORMSG("Trying to access an array that is not currently allocated.\n");
     }
 
@@ -506,6 +899,18 @@ INLINE bool mem_gmt_data_is_local(gentry_t * ga, gmt_data_t gmt_array,
     }
   }
 
+  if (GD_IS_DIST_BLOCKED(gmt_array)) {
+    uint64_t num_blocks = CEILING(ga->nbytes_tot, ga->nbytes_dist_block);
+    uint64_t block = goffset_bytes / ga->nbytes_dist_block;
+    if (mem_dist_owner(gmt_array, ga->dist_id, block, num_blocks) != node_id)
+      return false;
+    if (loffset_p != NULL)
+      *loffset_p = mem_dist_local_block(gmt_array, ga->dist_id, block,
+          num_blocks) * ga->nbytes_dist_block +
+        goffset_bytes % ga->nbytes_dist_block;
+    return true;
+  }
+
   /* In case of GMT_ALLOC_REMOTE ga->offset_bytes 
      falls outside the allocating node boundaries */
   _assert((int64_t) goffset_bytes >= 0 && (int64_t) ga->goffset_bytes >= 0);
@@ -544,16 +949,24 @@ INLINE void mem_free(gmt_data_t gmt_array)
     if (ga->gmt_array == GMT_DATA_NULL)
         ERRORMSG("gmt_free() already called for this array\n");
 
+    mem_rma_free(ga);
+
     if (GD_GET_TYPE_MEDIA(ga->gmt_array) == GMT_ALLOC_RAM ||
         (GD_GET_TYPE_MEDIA(ga->gmt_array) == GMT_ALLOC_SHM
          && (ga->name == NULL || (config.state_prot != (PROT_READ | PROT_WRITE))
              || config.state_name[0] == '\0'))) {
-        free(ga->data);
+        if (ga->nbytes_mapped != 0)
+            munmap(ga->data, ga->nbytes_mapped);
+        else
+            free(ga->data);
         //_DEBUG("free\n");
     } else {
         switch (GD_GET_TYPE_MEDIA(ga->gmt_array)) {
         case GMT_ALLOC_SHM:
-            af_on_file(NULL, ga, false);
+            if (ga->page_mode == MEM_PAGES_HUGETLB)
+                af_free_hugetlbfs(ga);
+            else
+                af_on_file(NULL, ga, false);
             break;
         case GMT_ALLOC_DISK:
             af_on_file(config.disk_path, ga, false);
@@ -564,13 +977,19 @@ INLINE void mem_free(gmt_data_t gmt_array)
         }
     }
 
-    if (ga->name != NULL)
+    if (ga->name != NULL) {
+        mem_name_remove(ga->name, gid);
         free(ga->name);
+        ga->name = NULL;
+    }
     ga->data = NULL;
     ga->nbytes_tot = 0;
     ga->nbytes_loc = 0;
     ga->nbytes_block = 0;
+    ga->nbytes_dist_block = 0;
     ga->nbytes_elem = 0;
+    ga->nbytes_mapped = 0;
+    ga->page_mode = MEM_PAGES_DEFAULT;
     ga->is_tmp = false;
     ga->gmt_array = GMT_DATA_NULL;
 
@@ -633,7 +1052,18 @@ INLINE void mem_locate_gmt_data_remote(gentry_t * ga,
             _assert(_rnode_id != node_id);
         }
         break;
-    case GMT_ALLOC_PERNODE:
+    case GMT_ALLOC_CUSTOM:
+    case GMT_ALLOC_BLOCK_CYCLIC:
+        {
+            uint64_t num_blocks = CEILING(ga->nbytes_tot, ga->nbytes_dist_block);
+            uint64_t block = goffset_bytes / ga->nbytes_dist_block;
+            _rnode_id = mem_dist_owner(ga->gmt_array, ga->dist_id, block,
+                                       num_blocks);
+            _roffset_bytes = mem_dist_local_block(ga->gmt_array, ga->dist_id,
+                                                  block, num_blocks) *
+                ga->nbytes_dist_block + goffset_bytes % ga->nbytes_dist_block;
+        }
+        break;
     default:
         ERRORMSG("Allocation policy unknown!\n");
         break;
@@ -647,6 +1077,49 @@ INLINE void mem_locate_gmt_data_remote(gentry_t * ga,
         *roffset_bytes = _roffset_bytes;
 }
 
+/* executes a gmt_for_each body on the local elements [lstart, lstart + num)
+ * of node nid of a blocked array, one call for each block they touch */
+INLINE void mem_dist_for_each(gmt_for_each_func_t func, gmt_data_t gmt_array,
+                              uint32_t nid, uint64_t lstart, uint64_t num,
+                              const void *args, gmt_handle_t handle)
+{
+    gentry_t *ga = mem_get_gentry(gmt_array);
+    uint64_t block_elems = ga->nbytes_dist_block / ga->nbytes_elem;
+    uint64_t num_blocks = CEILING(ga->nbytes_tot, ga->nbytes_dist_block);
+    while (num > 0) {
+        uint64_t in_block = lstart % block_elems;
+        uint64_t run = MIN(num, block_elems - in_block);
+        uint64_t block = mem_dist_global_block(gmt_array, ga->dist_id, nid,
+                                               lstart / block_elems,
+                                               num_blocks);
+        func(gmt_array, block * block_elems + in_block, run, args, handle);
+        lstart += run;
+        num -= run;
+    }
+}
+
+/* bytes from goffset_bytes that are contiguous in the local data, 
+ * loffset_bytes is the local offset returned by mem_gmt_data_is_local() */
+INLINE uint64_t mem_local_run_bytes(gentry_t * ga, uint64_t goffset_bytes,
+                                    int64_t loffset_bytes, uint64_t rest_bytes)
+{
+    if (ga->nbytes_dist_block != 0)
+        return MIN(rest_bytes, ga->nbytes_dist_block -
+                   goffset_bytes % ga->nbytes_dist_block);
+    return MIN(rest_bytes, ga->nbytes_loc - loffset_bytes);
+}
+
+/* bytes from goffset_bytes that are contiguous on the remote node, 
+ * roffset_bytes is the offset returned by mem_locate_gmt_data_remote() */
+INLINE uint64_t mem_remote_run_bytes(gentry_t * ga, uint64_t goffset_bytes,
+                                     uint64_t roffset_bytes, uint64_t rest_bytes)
+{
+    if (ga->nbytes_dist_block != 0)
+        return MIN(rest_bytes, ga->nbytes_dist_block -
+                   goffset_bytes % ga->nbytes_dist_block);
+    return MIN(rest_bytes, ga->nbytes_block - roffset_bytes);
+}
+
 INLINE void mem_put(uint8_t * ptr, const void *data, uint64_t num_bytes)
 {
     _assert(ptr != NULL);
@@ -727,4 +1200,130 @@ INLINE int64_t mem_atomic_add(uint8_t * ptr, int64_t value, uint8_t size)
     }
 }
 
+#define MEM_ATOMIC_FETCH(fetch_op)                                           \
+    switch (size) {                                                          \
+    case 1:                                                                  \
+        return (int64_t) fetch_op((int8_t *) ptr, (int8_t) value,            \
+                                  __ATOMIC_SEQ_CST);                         \
+    case 2:                                                                  \
+        return (int64_t) fetch_op((int16_t *) ptr, (int16_t) value,          \
+                                  __ATOMIC_SEQ_CST);                         \
+    case 4:                                                                  \
+        return (int64_t) fetch_op((int32_t *) ptr, (int32_t) value,          \
+                                  __ATOMIC_SEQ_CST);                         \
+    case 8:                                                                  \
+        return (int64_t) fetch_op((int64_t *) ptr, value, __ATOMIC_SEQ_CST); \
+    default:                                                                 \
+        ERRORMSG("memory atomic_op size %d not supported\n", size);          \
+    }
+
+/* float add, value and the returned old value hold the bits of a double */
+INLINE int64_t mem_atomic_fadd(uint8_t * ptr, int64_t value, uint8_t size)
+{
+    double v;
+    memcpy(&v, &value, sizeof(v));
+    double old_d;
+    if (size == sizeof(double)) {
+        uint64_t old_bits = __atomic_load_n((uint64_t *) ptr, __ATOMIC_RELAXED);
+        while (true) {
+            memcpy(&old_d, &old_bits, sizeof(old_d));
+            double new_d = old_d + v;
+            uint64_t new_bits;
+            memcpy(&new_bits, &new_d, sizeof(new_bits));
+            uint64_t cur = __sync_val_compare_and_swap((uint64_t *) ptr,
+                                                       old_bits, new_bits);
+            if (cur == old_bits)
+                break;
+            old_bits = cur;
+        }
+    } else if (size == sizeof(float)) {
+        uint32_t old_bits = __atomic_load_n((uint32_t *) ptr, __ATOMIC_RELAXED);
+        while (true) {
+            float old_f;
+            memcpy(&old_f, &old_bits, sizeof(old_f));
+            float new_f = old_f + (float) v;
+            uint32_t new_bits;
+            memcpy(&new_bits, &new_f, sizeof(new_bits));
+            uint32_t cur = __sync_val_compare_and_swap((uint32_t *) ptr,
+                                                       old_bits, new_bits);
+            if (cur == old_bits) {
+                old_d = old_f;
+                break;
+            }
+            old_bits = cur;
+        }
+    } else
+        ERRORMSG("memory atomic_fadd size %d not supported\n", size);
+    int64_t ret;
+    memcpy(&ret, &old_d, sizeof(ret));
+    return ret;
+}
+
+/* signed integer of size bytes at ptr */
+INLINE int64_t mem_load_signed(const uint8_t * ptr, uint8_t size)
+{
+    switch (size) {
+    case 1:
+        return __atomic_load_n((const int8_t *) ptr, __ATOMIC_RELAXED);
+    case 2:
+        return __atomic_load_n((const int16_t *) ptr, __ATOMIC_RELAXED);
+    case 4:
+        return __atomic_load_n((const int32_t *) ptr, __ATOMIC_RELAXED);
+    case 8:
+        return __atomic_load_n((const int64_t *) ptr, __ATOMIC_RELAXED);
+    default:
+        ERRORMSG("memory load size %d not supported\n", size);
+    }
+    return 0;
+}
+
+/* min and max compare the element as a signed integer of size bytes */
+INLINE int64_t mem_atomic_minmax(uint8_t * ptr, int64_t value, uint8_t size,
+                                 bool is_min)
+{
+    int64_t old = mem_load_signed(ptr, size);
+    /* value truncated to the element size as a store would (little endian) */
+    int64_t v = mem_load_signed((const uint8_t *) &value, size);
+    while (is_min ? v < old : v > old) {
+        int64_t cur = mem_atomic_cas(ptr, old, v, size);
+        if (cur == old)
+            break;
+        old = cur;
+    }
+    return old;
+}
+
+INLINE int64_t mem_atomic_op(uint8_t * ptr, atomic_op_t op, int64_t value,
+                             uint8_t size)
+{
+    _assert(ptr != NULL);
+    switch (op) {
+    case GMT_ATOMIC_AND:
+        MEM_ATOMIC_FETCH(__atomic_fetch_and);
+        break;
+    case GMT_ATOMIC_OR:
+        MEM_ATOMIC_FETCH(__atomic_fetch_or);
+        break;
+    case GMT_ATOMIC_XOR:
+        MEM_ATOMIC_FETCH(__atomic_fetch_xor);
+        break;
+    case GMT_ATOMIC_SWAP:
+        MEM_ATOMIC_FETCH(__atomic_exchange_n);
+        break;
+    case GMT_ATOMIC_MIN:
+    case GMT_ATOMIC_MAX:
+        return mem_atomic_minmax(ptr, value, size, op == GMT_ATOMIC_MIN);
+    case GMT_ATOMIC_FADD:
+        return mem_atomic_fadd(ptr, value, size);
+    case GMT_ATOMIC_ADD:
+        return mem_atomic_add(ptr, value, size);
+    default:
+        ERRORMSG("memory atomic_op %d not supported\n", op);
+        break;
+    }
+    return 0;
+}
+
+#undef MEM_ATOMIC_FETCH
+
 #endif
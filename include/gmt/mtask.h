@@ -46,6 +46,7 @@
 #include "gmt/network.h"
 #include "gmt/profiling.h"
 #include "gmt/commands.h"
+#include "gmt/idle.h"
 
 /**
   A 'task' is the basic unit of execution for a 'uthread'. 'uthreads' are 
@@ -201,6 +202,9 @@ typedef struct mtasks_manager_t {
      * to ((node_id + 1) * MAX_HANDLES). 
      * We need only a pool because the handleid "is around" until not returned */
     handleid_queue_t handleid_pool;
+
+    /** idle state shared by the workers, woken by every mtask push */
+    idle_t idle;
 } mtask_manager_t;
 
 extern mtask_manager_t mtm;
@@ -285,6 +289,7 @@ INLINE void mtm_return_mtask_queue(mtask_t * mt, uint32_t src_id)
 #else
     sched_queue_push(&mtm.mtasks_sched_in_queues[src_id], mt);
 #endif
+    idle_wake(&mtm.idle);
 }
 
 INLINE bool mtm_pop_mtask_queue(uint32_t cnt, mtask_t ** mt, uint32_t dst_id)
@@ -348,6 +353,7 @@ INLINE void mtm_push_mtask(mtask_t * mt, uint32_t src_id)
 #else
     sched_queue_push(&mtm.mtasks_sched_in_queues[src_id], mt);
 #endif
+    idle_wake(&mtm.idle);
     INCR_EVENT(WORKER_ITS_ENQUEUE_LOCAL, mt->end_it - mt->start_it);
 }
 
@@ -61,20 +61,50 @@ extern uint32_t num_nodes;
 #endif
 /* end of workaround */
 
+/* transports available to move a buffer to a remote node */
+typedef enum {
+    NET_TRANSPORT_MPI,          /* MPI point-to-point (any node) */
+    NET_TRANSPORT_SHM           /* shared-memory ring (nodes on the same host) */
+} net_transport_t;
+
+/* MPI tags, buffers of the control channel are matched separately from the
+ * bulk ones, each size class of bulk buffers has a tag of its own so that
+ * a message always lands in a receive buffer of its class. Rendezvous 
+ * messages use NET_RNDV_FIRST_TAG and above */
+#define NET_CTRL_TAG 0
+#define NET_DATA_TAG 1
+#define NET_CLASS_TAG(c) (NET_DATA_TAG + (int) (c))
+
 /************* net_buffer_t ***************************/
 typedef struct net_buffer_t {
     uint32_t id;
     void *context;              /* used to identify the channel */
     uint32_t rnode_id;
     uint32_t num_bytes;
+    uint32_t size;              /* capacity of data */
+    int tag;
     uint8_t * data;
     MPI_Request request;
+    net_transport_t transport;
+    bool shm_done;              /* shm send delivered into the remote ring */
+    uint64_t release_tick;      /* emulated delivery time */
+    void *shm_slot;             /* ring slot loaned to a shm recv buffer */
+    /* scatter-gather send: when sg_cnt != 0 the message is made of sg_cnt
+     * segments, either staged (copied) in data or left in place in user 
+     * memory. sg_hold are the command blocks that must outlive the send */
+    uint32_t sg_cnt;
+    uint32_t sg_refs;           /* segments left in place */
+    uint32_t sg_staged;         /* bytes copied in data */
+    MPI_Aint *sg_addrs;
+    int *sg_lens;
+    uint32_t sg_hold_cnt;
+    void **sg_hold;
 } net_buffer_t;
 
 INLINE void netbuffer_append(net_buffer_t * buff, const void *ptr,
                                       uint32_t size)
 {
-    _assert(buff->num_bytes + size <= COMM_BUFFER_SIZE);
+    _assert(buff->num_bytes + size <= buff->size);
     memcpy((uint8_t *) & (buff->data[buff->num_bytes]), ptr, size);
     buff->num_bytes += size;
 }
@@ -82,37 +112,438 @@ INLINE void netbuffer_append(net_buffer_t * buff, const void *ptr,
 INLINE void netbuffer_skip(net_buffer_t * buff,
                                       uint32_t size)
 {
-    _assert(buff->num_bytes + size <= COMM_BUFFER_SIZE);    
+    _assert(buff->num_bytes + size <= buff->size);
     buff->num_bytes += size;
 }
 
 
-void netbuffer_init(net_buffer_t * buff, uint32_t id, void *context);
+void netbuffer_init(net_buffer_t * buff, uint32_t id, void *context,
+                    uint32_t size, int tag);
+void netbuffer_init_sg(net_buffer_t * buff);
 void netbuffer_destroy(net_buffer_t * buff);
 
+/****************** Scatter-gather ***************/
+
+INLINE bool netbuffer_has_sg(net_buffer_t * buff)
+{
+    return buff->sg_addrs != NULL;
+}
+
+INLINE void netbuffer_sg_reset(net_buffer_t * buff)
+{
+    buff->num_bytes = 0;
+    buff->sg_cnt = 0;
+    buff->sg_refs = 0;
+    buff->sg_staged = 0;
+    buff->sg_hold_cnt = 0;
+}
+
+INLINE void netbuffer_sg_add(net_buffer_t * buff, const void *ptr,
+                             uint32_t size)
+{
+    MPI_Aint addr = (MPI_Aint) (uintptr_t) ptr;
+    uint32_t n = buff->sg_cnt;
+    if (n > 0 && buff->sg_addrs[n - 1] + buff->sg_lens[n - 1] == addr) {
+        buff->sg_lens[n - 1] += size;
+    } else {
+        _assert(n < SG_MAX_SEGMENTS);
+        buff->sg_addrs[n] = addr;
+        buff->sg_lens[n] = size;
+        buff->sg_cnt++;
+    }
+    buff->num_bytes += size;
+}
+
+/* copy size bytes at the end of the staged ones */
+INLINE void netbuffer_sg_copy(net_buffer_t * buff, const void *ptr,
+                              uint32_t size)
+{
+    _assert(buff->num_bytes + size <= buff->size);
+    uint8_t *dst = &buff->data[buff->sg_staged];
+    memcpy(dst, ptr, size);
+    buff->sg_staged += size;
+    netbuffer_sg_add(buff, dst, size);
+}
+
+/* leave size bytes in place if a segment is left for them and for the 
+ * staged bytes that may follow, otherwise copy them. Returns true if the
+ * bytes are in place and must not change until the send completes */
+INLINE bool netbuffer_sg_ref(net_buffer_t * buff, const void *ptr,
+                             uint32_t size)
+{
+    _assert(buff->num_bytes + size <= buff->size);
+    if (buff->sg_cnt + 2 > SG_MAX_SEGMENTS) {
+        netbuffer_sg_copy(buff, ptr, size);
+        return false;
+    }
+    netbuffer_sg_add(buff, ptr, size);
+    buff->sg_refs++;
+    return true;
+}
+
+/* with no segment left in place the message is just the staged bytes */
+INLINE void netbuffer_sg_close(net_buffer_t * buff)
+{
+    if (buff->sg_refs == 0)
+        buff->sg_cnt = 0;
+}
+
+/* MPI counts are int, larger transfers are issued in pieces */
+#define NET_MAX_MSG_BYTES (1UL << 30)
+
+/* slots of the RMA directory of each node and slots an array can land in 
+ * starting from its hash, a lookup reads all of them with one MPI_Get */
+#define NET_RMA_DIR_SLOTS 4096
+#define NET_RMA_DIR_PROBE 8
+
+/* key is the gid + 1 so that zeroed slots are empty */
+typedef struct rma_dir_slot_t {
+    uint64_t key;
+    uint64_t addr;
+} rma_dir_slot_t;
+
+/****************** Shared-memory transport ***************/
+
+/* Every node owns one segment with a ring per node on the same host
+ * (including itself, unused). The sender is the only producer of its ring and
+ * the receiver the only consumer. A slot is taken by the receiver (full is 
+ * cleared) and released later (busy is cleared) when the helper is done with 
+ * it, so the data never needs to be copied out of the segment. */
+typedef struct shm_slot_t {
+    volatile uint32_t full;     /* set by the sender, cleared on take */
+    volatile uint32_t busy;     /* set by the sender, cleared on release */
+    uint32_t num_bytes;
+    uint32_t snode_id;
+} shm_slot_t;
+
+#define SHM_SLOT_HEADER_SIZE 128
+
+typedef struct network_t {
+    MPI_Comm *comms;            /* one communicator per comm server */
+    uint32_t num_comms;
+    MPI_Comm local_comm;        /* nodes on the same host */
+    uint32_t local_rank;
+    uint32_t local_size;
+    int32_t *local_ranks;       /* local rank for each node or -1 */
+    uint32_t *local_nodes;      /* node for each local rank */
+    bool shm_enabled;
+    uint32_t shm_slots;         /* slots per ring */
+    uint64_t shm_slot_bytes;
+    uint64_t shm_seg_bytes;
+    uint8_t **shm_segs;         /* segments indexed by local rank */
+    uint32_t *shm_send_head;    /* next slot to fill, by local rank */
+    uint32_t *shm_recv_head;    /* next slot to take, by local rank */
+    uint32_t *shm_recv_next;    /* next ring to poll, by comm server */
+    bool rma_enabled;
+    MPI_Win rma_win;            /* dynamic window with the attached arrays */
+    MPI_Win rma_dir_win;        /* window exposing rma_dir */
+    rma_dir_slot_t *rma_dir;    /* hashed addresses of the attached arrays */
+    volatile int rma_dir_lock;
+    uint32_t rma_num_attached;
+    int rndv_tag_ub;            /* largest tag usable by rendezvous messages */
+    uint32_t rndv_next_tag;
+} network_t;
+
+extern network_t net;
+
+void network_comms_init(uint32_t num_comms);
+void network_comms_destroy();
+void network_shm_init();
+void network_shm_destroy();
+void network_rma_init();
+void network_rma_destroy();
+
+/* Communicator (and comm server) used between this node and rnid. It is 
+ * symmetric so that both sides agree on it, each comm server then sends to
+ * and receives from a disjoint set of remote nodes */
+INLINE uint32_t network_comm_of(uint32_t rnid)
+{
+    return (node_id + rnid) % net.num_comms;
+}
+
+INLINE bool network_is_shm(uint32_t rnid)
+{
+    return net.shm_enabled && net.local_ranks[rnid] >= 0;
+}
+
+INLINE shm_slot_t *network_shm_slot(uint32_t seg, uint32_t ring,
+                                    uint32_t slot)
+{
+    return (shm_slot_t *) (net.shm_segs[seg] +
+                           ((uint64_t) ring * net.shm_slots + slot) *
+                           net.shm_slot_bytes);
+}
+
+/* copy buffer into the ring of the receiver, false if the ring is full */
+INLINE bool network_shm_send(net_buffer_t * buff)
+{
+    uint32_t lr = net.local_ranks[buff->rnode_id];
+    uint32_t head = net.shm_send_head[lr];
+    shm_slot_t *slot = network_shm_slot(lr, net.local_rank, head);
+    if (slot->busy)
+        return false;
+    slot->busy = 1;
+    slot->num_bytes = buff->num_bytes;
+    slot->snode_id = node_id;
+    if (buff->sg_cnt == 0) {
+        memcpy((uint8_t *) slot + SHM_SLOT_HEADER_SIZE, buff->data,
+               buff->num_bytes);
+    } else {
+        uint8_t *dst = (uint8_t *) slot + SHM_SLOT_HEADER_SIZE;
+        uint32_t i;
+        for (i = 0; i < buff->sg_cnt; i++) {
+            memcpy(dst, (const void *) (uintptr_t) buff->sg_addrs[i],
+                   buff->sg_lens[i]);
+            dst += buff->sg_lens[i];
+        }
+    }
+    __sync_synchronize();
+    slot->full = 1;
+    net.shm_send_head[lr] = (head + 1) % net.shm_slots;
+    return true;
+}
+
+/* take the next full slot from the rings of comm server csid and loan it 
+ * to buff */
+INLINE bool network_shm_test_recv(net_buffer_t * buff, uint32_t csid)
+{
+    uint32_t i;
+    for (i = 0; i < net.local_size; i++) {
+        uint32_t lr = net.shm_recv_next[csid];
+        net.shm_recv_next[csid] = (lr + 1) % net.local_size;
+        if (lr == net.local_rank ||
+            network_comm_of(net.local_nodes[lr]) != csid)
+            continue;
+        uint32_t head = net.shm_recv_head[lr];
+        shm_slot_t *slot = network_shm_slot(net.local_rank, lr, head);
+        if (!slot->full)
+            continue;
+        __sync_synchronize();
+        slot->full = 0;
+        net.shm_recv_head[lr] = (head + 1) % net.shm_slots;
+        buff->transport = NET_TRANSPORT_SHM;
+        buff->shm_slot = slot;
+        buff->data = (uint8_t *) slot + SHM_SLOT_HEADER_SIZE;
+        buff->num_bytes = slot->num_bytes;
+        buff->rnode_id = slot->snode_id;
+        return true;
+    }
+    return false;
+}
+
+/* give back the slot loaned to buff, the sender can then reuse it */
+INLINE void network_shm_release(net_buffer_t * buff)
+{
+    _assert(buff->transport == NET_TRANSPORT_SHM);
+    shm_slot_t *slot = (shm_slot_t *) buff->shm_slot;
+    _assert(slot != NULL && slot->busy);
+    __sync_synchronize();
+    slot->busy = 0;
+    buff->shm_slot = NULL;
+    buff->data = NULL;
+}
+
+/****************** One-sided RMA ***************/
+
+/* Large local partitions are attached to a dynamic window and their address
+ * is published in rma_dir, so that large puts and gets can move data straight
+ * between user buffers without going through aggregation and helpers. Both 
+ * windows are kept in a lock_all epoch for the whole run, operations are 
+ * completed by network_rma_flush(). 
+ * rma_dir is a small hash table with a fixed size on every node: an array 
+ * goes in one of the NET_RMA_DIR_PROBE slots following its hash, when they
+ * are all taken it is not attached and its transfers use messages. */
+
+INLINE uint32_t network_rma_dir_home(uint64_t gid)
+{
+    return (uint32_t) (((gid + 1) * 0x9E3779B97F4A7C15ULL) >> 32) %
+        NET_RMA_DIR_SLOTS;
+}
+
+/* returns false if rma_dir has no room for gid or --gmt_rma_max_attach 
+ * arrays are already attached */
+INLINE bool network_rma_attach(uint64_t gid, void *base, uint64_t nbytes)
+{
+    _assert(net.rma_enabled);
+    rma_dir_slot_t *s = &net.rma_dir[network_rma_dir_home(gid)];
+    uint32_t i = 0;
+    while (!__sync_bool_compare_and_swap(&net.rma_dir_lock, 0, 1)) ;
+    while (i < NET_RMA_DIR_PROBE && s[i].key != 0)
+        i++;
+    if (i == NET_RMA_DIR_PROBE ||
+        net.rma_num_attached == config.rma_max_attach) {
+        __sync_lock_release(&net.rma_dir_lock);
+        return false;
+    }
+    net.rma_num_attached++;
+    MPI_Aint addr;
+    MPI_Win_attach(net.rma_win, base, nbytes);
+    MPI_Get_address(base, &addr);
+    s[i].addr = (uint64_t) addr;
+    __sync_synchronize();
+    s[i].key = gid + 1;
+    __sync_lock_release(&net.rma_dir_lock);
+    return true;
+}
+
+INLINE void network_rma_detach(uint64_t gid, void *base)
+{
+    _assert(net.rma_enabled);
+    rma_dir_slot_t *s = &net.rma_dir[network_rma_dir_home(gid)];
+    uint32_t i = 0;
+    while (!__sync_bool_compare_and_swap(&net.rma_dir_lock, 0, 1)) ;
+    while (i < NET_RMA_DIR_PROBE && s[i].key != gid + 1)
+        i++;
+    _assert(i < NET_RMA_DIR_PROBE);
+    s[i].key = 0;
+    __sync_synchronize();
+    s[i].addr = 0;
+    MPI_Win_detach(net.rma_win, base);
+    net.rma_num_attached--;
+    __sync_lock_release(&net.rma_dir_lock);
+}
+
+/* address of array gid on rnid, 0 if rnid did not attach it */
+INLINE uint64_t network_rma_lookup(uint32_t rnid, uint64_t gid)
+{
+    rma_dir_slot_t s[NET_RMA_DIR_PROBE];
+    MPI_Get(s, sizeof(s), MPI_BYTE, rnid,
+            network_rma_dir_home(gid) * sizeof(rma_dir_slot_t), sizeof(s),
+            MPI_BYTE, net.rma_dir_win);
+    MPI_Win_flush(rnid, net.rma_dir_win);
+    uint32_t i;
+    for (i = 0; i < NET_RMA_DIR_PROBE; i++)
+        if (s[i].key == gid + 1)
+            return s[i].addr;
+    return 0;
+}
+
+INLINE void network_rma_put(uint32_t rnid, uint64_t raddr, const void *data,
+                            uint64_t nbytes)
+{
+    uint64_t off = 0;
+    while (off < nbytes) {
+        int n = (int) ((nbytes - off < NET_MAX_MSG_BYTES) ?
+                        nbytes - off : NET_MAX_MSG_BYTES);
+        int res = MPI_Put((const uint8_t *) data + off, n, MPI_BYTE, rnid,
+                          (MPI_Aint) (raddr + off), n, MPI_BYTE, net.rma_win);
+        _unused(res);
+        _assert(res == MPI_SUCCESS);
+        off += n;
+    }
+}
+
+INLINE void network_rma_get(uint32_t rnid, uint64_t raddr, void *data,
+                            uint64_t nbytes)
+{
+    uint64_t off = 0;
+    while (off < nbytes) {
+        int n = (int) ((nbytes - off < NET_MAX_MSG_BYTES) ?
+                        nbytes - off : NET_MAX_MSG_BYTES);
+        int res = MPI_Get((uint8_t *) data + off, n, MPI_BYTE, rnid,
+                          (MPI_Aint) (raddr + off), n, MPI_BYTE, net.rma_win);
+        _unused(res);
+        _assert(res == MPI_SUCCESS);
+        off += n;
+    }
+}
+
+INLINE void network_rma_flush()
+{
+    MPI_Win_flush_all(net.rma_win);
+}
+
+/****************** Rendezvous ***************/
+
+/* every rendezvous message gets a tag of its own so that it can be matched
+ * with its descriptor command */
+#define NET_RNDV_FIRST_TAG NET_CLASS_TAG(NUM_BUFF_CLASSES)
+
+INLINE int network_rndv_tag()
+{
+    uint32_t n = __sync_fetch_and_add(&net.rndv_next_tag, 1);
+    return NET_RNDV_FIRST_TAG +
+        (int) (n % (uint32_t) (net.rndv_tag_ub - NET_RNDV_FIRST_TAG + 1));
+}
+
+INLINE void network_rndv_send_nb(uint32_t rnid, const void *data,
+                                 uint64_t nbytes, int tag,
+                                 MPI_Request * request)
+{
+    _assert(nbytes <= NET_MAX_MSG_BYTES);
+    int res = MPI_Isend(data, (int) nbytes, MPI_BYTE, rnid, tag,
+                        net.comms[network_comm_of(rnid)], request);
+    _unused(res);
+    _assert(res == MPI_SUCCESS);
+}
+
+INLINE void network_rndv_recv_nb(uint32_t rnid, void *data,
+                                 uint64_t nbytes, int tag,
+                                 MPI_Request * request)
+{
+    _assert(nbytes <= NET_MAX_MSG_BYTES);
+    int res = MPI_Irecv(data, (int) nbytes, MPI_BYTE, rnid, tag,
+                        net.comms[network_comm_of(rnid)], request);
+    _unused(res);
+    _assert(res == MPI_SUCCESS);
+}
+
+INLINE bool network_test(MPI_Request * request)
+{
+    int flag = 0;
+    int res = MPI_Test(request, &flag, MPI_STATUS_IGNORE);
+    _unused(res);
+    _assert(res == MPI_SUCCESS);
+    return flag != 0;
+}
+
 /****************** Network ***************/
 
 void network_init(int *argc, char ***argv);
 void network_finalize();
 void network_barrier();
+/* true if value is true on every node */
+bool network_all_agree(bool value);
 
 INLINE void network_send_nb(net_buffer_t * buff)
 {
     _assert(buff != NULL);
     _assert(buff->rnode_id < num_nodes);
     _assert(buff->num_bytes != 0);
-    int res = MPI_Isend(buff->data, buff->num_bytes, MPI_BYTE, buff->rnode_id,
-                        /*tag */ 1, MPI_COMM_WORLD, &buff->request);
+    if (buff->tag != NET_CTRL_TAG && network_is_shm(buff->rnode_id)) {
+        buff->transport = NET_TRANSPORT_SHM;
+        buff->shm_done = network_shm_send(buff);
+        return;
+    }
+    buff->transport = NET_TRANSPORT_MPI;
+    int res;
+    if (buff->sg_cnt == 0) {
+        res = MPI_Isend(buff->data, buff->num_bytes, MPI_BYTE, buff->rnode_id,
+                        buff->tag, net.comms[network_comm_of(buff->rnode_id)],
+                        &buff->request);
+    } else {
+        /* segments are absolute addresses, the receiver sees plain bytes */
+        MPI_Datatype type;
+        MPI_Type_create_hindexed(buff->sg_cnt, buff->sg_lens, buff->sg_addrs,
+                                 MPI_BYTE, &type);
+        MPI_Type_commit(&type);
+        res = MPI_Isend(MPI_BOTTOM, 1, type, buff->rnode_id, buff->tag,
+                        net.comms[network_comm_of(buff->rnode_id)],
+                        &buff->request);
+        MPI_Type_free(&type);
+    }
     _unused(res);
     _assert(res == MPI_SUCCESS);
 
 }
 
-INLINE void network_recv_nb(net_buffer_t * buff)
+INLINE void network_recv_nb(net_buffer_t * buff, uint32_t csid)
 {
     _assert(buff != NULL);
-    int res = MPI_Irecv(buff->data, COMM_BUFFER_SIZE, MPI_BYTE, MPI_ANY_SOURCE,
-                        /* tag */ 1, MPI_COMM_WORLD, &buff->request);
+    _assert(csid < net.num_comms);
+    buff->transport = NET_TRANSPORT_MPI;
+    int res = MPI_Irecv(buff->data, buff->size, MPI_BYTE, MPI_ANY_SOURCE,
+                        buff->tag, net.comms[csid], &buff->request);
     _unused(res);
     _assert(res == MPI_SUCCESS);
 }
@@ -121,10 +552,20 @@ INLINE void network_recv(net_buffer_t * buff)
 {
     _assert(buff != NULL);
     MPI_Status status;
-    int res = MPI_Recv(buff->data, COMM_BUFFER_SIZE, MPI_BYTE, MPI_ANY_SOURCE,
-                       /* tag */ 1, MPI_COMM_WORLD, &status);
+    int res = MPI_Recv(buff->data, buff->size, MPI_BYTE, MPI_ANY_SOURCE,
+                       buff->tag, MPI_COMM_WORLD, &status);
+    _unused(res);
+    _assert(res == MPI_SUCCESS);
+}
+
+INLINE void network_recv_complete(net_buffer_t * buff, MPI_Status * status)
+{
+    int count;
+    int res = MPI_Get_count(status, MPI_BYTE, &count);
     _unused(res);
     _assert(res == MPI_SUCCESS);
+    buff->num_bytes = count;
+    buff->rnode_id = status->MPI_SOURCE;
 }
 
 INLINE bool network_test_recv(net_buffer_t * buff)
@@ -137,20 +578,32 @@ INLINE bool network_test_recv(net_buffer_t * buff)
     _assert(res == MPI_SUCCESS);
 
     if (flag) {
-        int count;
-        int res = MPI_Get_count(&status, MPI_BYTE, &count);
-        _unused(res);
-        _assert(res == MPI_SUCCESS);
-        buff->num_bytes = count;
-        buff->rnode_id = status.MPI_SOURCE;
+        network_recv_complete(buff, &status);
         return true;
     }
     return false;
 }
 
+/* test a batch of MPI requests at once, completed requests are set to 
+ * MPI_REQUEST_NULL and their position is returned in indices */
+INLINE uint32_t network_testsome(uint32_t count, MPI_Request * requests,
+                                 int *indices, MPI_Status * statuses)
+{
+    int outcount = 0;
+    int res = MPI_Testsome(count, requests, &outcount, indices, statuses);
+    _unused(res);
+    _assert(res == MPI_SUCCESS);
+    return (outcount == MPI_UNDEFINED) ? 0 : outcount;
+}
+
 INLINE bool network_test_send(net_buffer_t * buff)
 {
     _assert(buff != NULL);
+    if (buff->transport == NET_TRANSPORT_SHM) {
+        if (!buff->shm_done)
+            buff->shm_done = network_shm_send(buff);
+        return buff->shm_done;
+    }
     int flag = 0;
     MPI_Status status;
     int res = MPI_Test(&buff->request, &flag, &status);
@@ -42,7 +42,7 @@
 #include "gmt/config.h"
 #include "gmt/debug.h"
 
-#define NUM_ENTITIES (NUM_WORKERS+NUM_HELPERS+1)
+#define NUM_ENTITIES (NUM_WORKERS+NUM_HELPERS+NUM_COMM_SERVERS)
 
 void profile_init();
 void profile_destroy();
@@ -66,6 +66,12 @@ typedef enum event_type_t {
     COMM_RECV_COMPLETED,
     COMM_SEND_BYTES,
     COMM_RECV_BYTES,
+    COMM_SHM_SEND_COMPLETED,
+    COMM_SHM_RECV_COMPLETED,
+    COMM_RNDV_SEND_COMPLETED,
+    COMM_RNDV_RECV_COMPLETED,
+    COMM_POLL_CALLS,
+    COMM_POLL_CYCLES,
 
     WORKER_ITS_STARTED,
     WORKER_ITS_SELF_EXECUTE,
@@ -81,12 +87,14 @@ typedef enum event_type_t {
     WORKER_GMT_ALLOC,
     WORKER_GMT_PUT_LOCAL,
     WORKER_GMT_PUT_REMOTE,
+    WORKER_GMT_PUT_RMA,
     WORKER_GMT_MEM_PUT_REMOTE,
     WORKER_GMT_MEM_STRIDED_PUT_REMOTE,
     WORKER_GMT_PUTVALUE_LOCAL,
     WORKER_GMT_PUTVALUE_REMOTE,
     WORKER_GMT_GET_LOCAL,
     WORKER_GMT_GET_REMOTE,
+    WORKER_GMT_GET_RMA,
     WORKER_GMT_MEM_GET_REMOTE,
     WORKER_GMT_ATOMIC_ADD_LOCAL,
     WORKER_GMT_ATOMIC_ADD_REMOTE,
@@ -102,6 +110,8 @@ typedef enum event_type_t {
     HELPER_CMD_PUT,
     HELPER_CMD_MEM_PUT,
     HELPER_CMD_MEM_STRIDED_PUT,
+    HELPER_CMD_PUT_RNDV,
+    HELPER_CMD_MEM_PUT_RNDV,
     HELPER_CMD_PUT_VALUE,
     HELPER_CMD_GET,
     HELPER_CMD_MEM_GET,
@@ -118,6 +128,22 @@ typedef enum event_type_t {
     HELPER_CMD_REPLY_ACK,
     HELPER_CMD_REPLY_VALUE,
     HELPER_CMD_REPLY_GET,
+    HELPER_CMD_REPLY_ACK_BATCH,
+    HELPER_ACKS_COALESCED,
+    HELPER_CMD_ROUTE,
+    HELPER_RECV_BUFF_RELEASED,
+    WORKER_GMT_GATHER_REMOTE,
+    HELPER_CMD_GATHER,
+    HELPER_CMD_REPLY_GATHER,
+    WORKER_GMT_SCATTER_REMOTE,
+    HELPER_CMD_SCATTER,
+    WORKER_GMT_ATOMIC_OP_LOCAL,
+    WORKER_GMT_ATOMIC_OP_REMOTE,
+    HELPER_CMD_ATOMIC_OP,
+    WORKER_GMT_ATOMIC_NOFETCH_REMOTE,
+    HELPER_CMD_ATOMIC_NOFETCH,
+    WORKER_GMT_QUIET_QUERIES,
+    HELPER_CMD_QUIET,
 
     AGGREGATION_CMD_BYTES,
     AGGREGATION_DATA_BYTES,
@@ -126,6 +152,20 @@ typedef enum event_type_t {
     AGGREGATION_ON_TIMEOUT,
     AGGREGATION_BYTE_WASTE,
     AGGREGATION_ON_FULLBLOCK,
+    AGGREGATION_CTRL_CMD,
+    AGGREGATION_CTRL_BUFF,
+    AGGREGATION_CTRL_WAIT,
+    AGGREGATION_SG_BYTES,
+    AGGREGATION_COMB_CMDS,
+    AGGREGATION_COMB_HITS,
+    AGGREGATION_ROUTE_CMDS,
+    AGGREGATION_ADAPT_UPDATES,
+    AGGREGATION_ADAPT_TICKS,
+    AGGREGATION_ADAPT_LATENCY,
+
+    IDLE_SPIN_CYCLES,
+    IDLE_PARK_CYCLES,
+    IDLE_PARKS,
 
     PROFILE_COUNTERS
 } event_type_t;
@@ -57,8 +57,8 @@ extern cpu_set_t * workers_cpuset;
 extern hwloc_cpuset_t * helpers_cpuset_hwloc;
 extern cpu_set_t * helpers_cpuset;
 
-// cpuset of the communicator
-extern hwloc_cpuset_t communicator_cpuset_hwloc;
+// cpuset of the communication servers
+extern hwloc_cpuset_t * communicator_cpuset_hwloc;
 extern cpu_set_t * communicator_cpuset;
 
 extern uint32_t available_cores; // number of available cores seen by the process binding
@@ -72,7 +72,7 @@ void affinity_masks_init();
 void explore_architecture();
 int singlified_osdev_cpuset(hwloc_obj_osdev_type_t type, hwloc_cpuset_t** array_cpuset, int* len);
 hwloc_cpuset_t near_network(hwloc_cpuset_t input_cpuset);
-void comm_server_set_thread_affinity();
+void comm_server_set_thread_affinity(uint32_t csid);
 uint32_t get_num_cores_hwloc();
 
 #endif
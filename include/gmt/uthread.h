@@ -70,6 +70,12 @@ typedef struct uthread_t {
     uint64_t req_nbytes;
     volatile uint64_t recv_nbytes;
 
+    /* RMA operations issued and not flushed yet */
+    bool rma_pending;
+
+    /* non-fetching operations issued and not quieted yet */
+    bool nofetch_pending;
+
     /* created and terminated  mtasks */
     uint64_t *created_mtasks;
     uint64_t volatile *terminated_mtasks;
@@ -44,6 +44,7 @@
 #include "gmt/debug.h"
 #include "gmt/queue.h"
 #include "gmt/commands.h"
+#include "gmt/memory.h"
 #include "gmt/aggregation.h"
 #include "gmt/gmt_ucontext.h"
 #include "gmt/uthread.h"
@@ -69,6 +70,12 @@ typedef struct worker_t {
   /* timer used to check on the cmd blocks timeout */
   uint64_t tick_cmdb_timeout;
 
+  /* back-off state when the worker has nothing to run */
+  backoff_t backoff;
+
+  /* uthreads blocked waiting for data, mtasks or handles */
+  volatile uint32_t num_waiting;
+
   /* seed for the random number generator provided by GMT */
   uint64_t rand_seed;
 
@@ -85,6 +92,9 @@ typedef struct worker_t {
 
   uint32_t rr_cnt;
 
+  /* non-fetching operations issued by this worker to each node */
+  volatile uint64_t *nf_issued;
+
 #if TRACE_QUEUES
   uint64_t pop_misses = 0, pop_hits = 0;
   uint64_t rpush_misses = 0, rpush_hits = 0;
@@ -97,6 +107,8 @@ typedef struct worker_t {
 
 extern volatile bool workers_stop_flag;
 extern worker_t *workers;
+/* non-fetching operations of this node that each node confirmed applied */
+extern volatile uint64_t *workers_nf_confirmed;
 
 void worker_team_init();
 void worker_team_destroy();
@@ -137,6 +149,8 @@ INLINE void worker_push_task(uint32_t wid, mtask_t * mt, uint64_t start_it)
   _assert(ut->nest_lev == 0);
   ut->req_nbytes = 0;
   ut->recv_nbytes = 0;
+  ut->rma_pending = false;
+  ut->nofetch_pending = false;
   ut->tstatus = TASK_NOT_STARTED;
   uthread_queue_push(&workers[wid].uthread_queue, ut);
 }
@@ -400,7 +414,14 @@ INLINE void worker_wait_data(uint32_t tid, uint32_t wid)
   if (num_nodes > 1) {
     uthread_t *ut = &uthreads[tid];
     _assert(ut->tstatus == TASK_RUNNING);
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (ut->rma_pending) {
+      network_rma_flush();
+      ut->rma_pending = false;
+    }
+#endif
     ut->tstatus = TASK_WAITING_DATA;
+    workers[wid].num_waiting++;
     uint64_t timeout = 0;
     while (!uthread_check_recv_all_data(ut)) {
       timeout++;
@@ -409,6 +430,7 @@ INLINE void worker_wait_data(uint32_t tid, uint32_t wid)
         GMT_DEBUG_PRINTF("waiting for data\n");
 
     }
+    workers[wid].num_waiting--;
     ut->tstatus = TASK_RUNNING;
     COUNT_EVENT(WORKER_WAIT_DATA);
   }
@@ -419,8 +441,10 @@ INLINE void worker_wait_mtasks(uint32_t tid, uint32_t wid)
   uthread_t *ut = &uthreads[tid];
   _assert(ut->tstatus == TASK_RUNNING);
   ut->tstatus = TASK_WAITING_MTASKS;
+  workers[wid].num_waiting++;
   while (!uthread_check_terminated_mtasks(ut))
     worker_schedule(tid, wid);
+  workers[wid].num_waiting--;
   ut->tstatus = TASK_RUNNING;
   COUNT_EVENT(WORKER_WAIT_MTASKS);
 }
@@ -431,6 +455,7 @@ INLINE void worker_wait_handle(uint32_t tid, uint32_t wid, gmt_handle_t handle)
   uthread_t *ut = &uthreads[tid];
   _assert(ut->tstatus == TASK_RUNNING);
   ut->tstatus = TASK_WAITING_HANLDE;
+  workers[wid].num_waiting++;
 
   uint64_t stick = rdtsc();
   while (mtm.handles[handle].status != HANDLE_COMPLETED) {
@@ -449,11 +474,9 @@ INLINE void worker_wait_handle(uint32_t tid, uint32_t wid, gmt_handle_t handle)
         uint32_t snode = (node_id == num_nodes - 1) ? 0 : node_id + 1;
 
         cmd_check_handle_t *cmd =
-          (cmd_check_handle_t *) agm_get_cmd(snode, wid,
+          (cmd_check_handle_t *) agm_get_ctrl_cmd(snode, wid,
               sizeof
-              (cmd_check_handle_t),
-              0,
-              NULL);
+              (cmd_check_handle_t));
 
         cmd->type = GMT_CMD_HANDLE_CHECK_TERM;
         cmd->node_counter = 1;
@@ -461,7 +484,7 @@ INLINE void worker_wait_handle(uint32_t tid, uint32_t wid, gmt_handle_t handle)
         cmd->mtasks_created = 0;
         cmd->handle = handle;
 
-        agm_set_cmd_data(snode, wid, NULL, 0);
+        agm_send_ctrl_cmd(wid);
 
         COUNT_EVENT(WORKER_WAIT_HANDLE);
         stick = tick;
@@ -470,6 +493,7 @@ INLINE void worker_wait_handle(uint32_t tid, uint32_t wid, gmt_handle_t handle)
     worker_schedule(tid, wid);
   }
   COUNT_EVENT(WORKER_WAIT_HANDLE);
+  workers[wid].num_waiting--;
   ut->tstatus = TASK_RUNNING;
   /* return handle */
   uint32_t gtid = uthread_get_gtid(tid, node_id);
@@ -564,14 +588,20 @@ INLINE void worker_mtask_free(uint32_t wid, mtask_t * mt)
 #endif
 }
 
-INLINE void worker_do_for(void *func, uint64_t start_it, uint64_t step_it,
-    const void *args, gmt_data_t gmt_array,
+/* for blocked distributions the iterations of gmt_for_each are the local 
+ * elements of node nid */
+INLINE void worker_do_for(void *func, uint32_t nid, uint64_t start_it,
+    uint64_t step_it, const void *args, gmt_data_t gmt_array,
     gmt_handle_t handle)
 {
 
   if (gmt_array != GMT_DATA_NULL) {
-    ((gmt_for_each_func_t) func) (gmt_array, start_it, step_it, args,
-      handle);
+    if (GD_IS_DIST_BLOCKED(gmt_array))
+      mem_dist_for_each((gmt_for_each_func_t) func, gmt_array, nid,
+        start_it, step_it, args, handle);
+    else
+      ((gmt_for_each_func_t) func) (gmt_array, start_it, step_it, args,
+        handle);
   } else {
     ((gmt_for_loop_func_t) func) (start_it, step_it, args, handle);
   }
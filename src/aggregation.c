@@ -39,16 +39,18 @@
 #if ENABLE_AGGREGATION
 agm_t *agms;
 
-void aggreg_init_node(agm_t * agm)
+/* command blocks, pool and queues of a node */
+static void aggreg_init_node_blocks(agm_t * agm)
 {
-    agm->equiv_bytes = 0;
-    agm->tick = rdtsc();
+    uint32_t i;
+    agm->p_cmdbs = (cmd_block_t**)_malloc(sizeof(cmd_block_t *) * NUM_SEND_CHANNELS);
+    for (i = 0; i < NUM_SEND_CHANNELS; i++)
+        agm->p_cmdbs[i] = NULL;
 
     cmdb_queue_init(&agm->queue_cmdb);
     cmdb_queue_init(&agm->pool_cmdb);
     agm->cmdbs = (cmd_block_t*)_malloc(NUM_CMD_BLOCKS * sizeof(cmd_block_t));
 
-    uint32_t i;
     for (i = 0; i < NUM_CMD_BLOCKS; i++) {
         memset(&agm->cmdbs[i], 0, sizeof(cmd_block_t));
         agm->cmdbs[i].cmds = (uint8_t*)_calloc(CMD_BLOCK_SIZE, 1);
@@ -56,14 +58,47 @@ void aggreg_init_node(agm_t * agm)
            its size must be larger than the number of cmds */
         uint32_t size = CEILING(CMD_BLOCK_SIZE,sizeof(cmd_gen_t));
         agm->cmdbs[i].data_array = (ag_data_t*)_calloc( size * sizeof(ag_data_t), 1);
+        if (config.agg_combine)
+            agm->cmdbs[i].comb_slots = 
+                (uint64_t*)_calloc(sizeof(uint64_t) << AGG_COMB_SLOTS_BITS, 1);
 
         /* fill pool */
         cmdb_queue_push(&agm->pool_cmdb, &agm->cmdbs[i]);
     }
+}
 
-    agm->p_cmdbs = (cmd_block_t**)_malloc(sizeof(cmd_block_t *) * NUM_SEND_CHANNELS);
-    for (i = 0; i < NUM_SEND_CHANNELS; i++)
-        agm->p_cmdbs[i] = NULL;
+void aggreg_init_node(agm_t * agm)
+{
+    agm->equiv_bytes = 0;
+    agm->pushed_bytes = 0;
+    agm->tick = rdtsc();
+    agm->deadline = MIN(MAX(config.cmdb_check_interv, config.agg_min_deadline),
+                        config.node_agg_check_interv);
+    agm->ctl_pushed = 0;
+    agm->ctl_tick = agm->tick;
+
+    agm->p_cmdbs = NULL;
+
+    /* with routing most nodes are only reached through a proxy, their
+     * blocks are allocated the first time a command goes to them directly */
+    agm->init_lock = 0;
+    agm->ready = false;
+    if (config.route_group_size == 0) {
+        aggreg_init_node_blocks(agm);
+        agm->ready = true;
+    }
+}
+
+void agm_init_blocks(uint32_t rnid)
+{
+    agm_t *agm = &agms[rnid];
+    if (__sync_bool_compare_and_swap(&agm->init_lock, 0, 1)) {
+        aggreg_init_node_blocks(agm);
+        __sync_synchronize();
+        agm->ready = true;
+    }
+    while (!agm->ready)
+        __sync_synchronize();
 }
 
 void aggreg_init()
@@ -71,6 +106,9 @@ void aggreg_init()
     agms = (agm_t*)_malloc(sizeof(agm_t) * num_nodes);
     uint32_t i;
 
+    /* all the nodes have to agree on using the compact encoding */
+    config.compact_cmds = network_all_agree(config.compact_cmds);
+
     /* Initialize node aggregation structures */
     for (i = 0; i < num_nodes; i++)
         if (i != node_id)
@@ -87,15 +125,18 @@ void aggreg_destroy()
 #if ENABLE_AGGREGATION
     uint32_t i, j;
     for (i = 0; i < num_nodes; i++) {
-        if (i != node_id) {
+        if (i == node_id)
+            continue;
+        if (agms[i].ready) {
             for (j = 0; j < NUM_CMD_BLOCKS; j++) {                
                 free(agms[i].cmdbs[j].cmds);
                 free(agms[i].cmdbs[j].data_array);
+                free(agms[i].cmdbs[j].comb_slots);
             }
             cmdb_queue_destroy(&agms[i].queue_cmdb);
             cmdb_queue_destroy(&agms[i].pool_cmdb);
-            free(agms[i].p_cmdbs);
             free(agms[i].cmdbs);
+            free(agms[i].p_cmdbs);
         }
     }
     free(agms);
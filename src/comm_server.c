@@ -42,154 +42,555 @@
 #if !(ENABLE_SINGLE_NODE_ONLY)
 comm_server_t cs;
 
-void comm_server_init_channel(channel_t * ch)
+void comm_server_init_channel(channel_t * ch, uint32_t num_buffs,
+                              uint32_t buff_size, int tag, bool use_shm)
 {
-    ch_queue_init(&ch->queue, NUM_BUFFS_PER_CHANNEL);
-    ch_queue_init(&ch->pool, NUM_BUFFS_PER_CHANNEL);
+    /* shm buffers go through the same queues and pools of the channel */
+    uint32_t queue_size = use_shm ? 2 * num_buffs : num_buffs;
+    uint32_t c;
+    ch->queues = (ch_queue_t *)_malloc(NUM_COMM_SERVERS * sizeof(ch_queue_t));
+    ch->pools = (ch_queue_t *)_malloc(NUM_COMM_SERVERS * sizeof(ch_queue_t));
+    for (c = 0; c < NUM_COMM_SERVERS; c++) {
+        ch_queue_init(&ch->queues[c], queue_size);
+        ch_queue_init(&ch->pools[c], queue_size);
+    }
     ch->current_buff = NULL;
-    ch->buffers = (net_buffer_t*)_malloc(sizeof(net_buffer_t) * NUM_BUFFS_PER_CHANNEL);
+    ch->current_cs = 0;
+    ch->next_cs = 0;
+    ch->num_buffs = num_buffs;
+    ch->idle = NULL;
+    ch->buffers = (net_buffer_t*)_malloc(sizeof(net_buffer_t) * num_buffs);
     uint32_t i;
-    for (i = 0; i < NUM_BUFFS_PER_CHANNEL; i++) {
+    for (i = 0; i < num_buffs; i++) {
         /* Init the buffer with a pointer to its channel */
-        netbuffer_init(&ch->buffers[i], i, (void *)ch);
-        ch_queue_push(&ch->pool, &ch->buffers[i]);
+        netbuffer_init(&ch->buffers[i], i, (void *)ch, buff_size, tag);
+        ch_queue_push(&ch->pools[i % NUM_COMM_SERVERS], &ch->buffers[i]);
+    }
+
+    ch->shm_pools = NULL;
+    ch->shm_buffers = NULL;
+    if (use_shm) {
+        ch->shm_pools = (ch_queue_t *)_malloc(NUM_COMM_SERVERS *
+                                              sizeof(ch_queue_t));
+        for (c = 0; c < NUM_COMM_SERVERS; c++)
+            ch_queue_init(&ch->shm_pools[c], num_buffs);
+        ch->shm_buffers = (net_buffer_t*)_calloc(num_buffs,
+                                                 sizeof(net_buffer_t));
+        for (i = 0; i < num_buffs; i++) {
+            ch->shm_buffers[i].id = num_buffs + i;
+            ch->shm_buffers[i].tag = tag;
+            ch->shm_buffers[i].context = (void *)ch;
+            ch->shm_buffers[i].transport = NET_TRANSPORT_SHM;
+            ch_queue_push(&ch->shm_pools[i % NUM_COMM_SERVERS],
+                          &ch->shm_buffers[i]);
+        }
     }
 }
 
 void comm_server_destroy_channel(channel_t * ch)
 {
-    ch_queue_destroy(&ch->queue);
-    ch_queue_destroy(&ch->pool);
+    uint32_t c;
+    for (c = 0; c < NUM_COMM_SERVERS; c++) {
+        ch_queue_destroy(&ch->queues[c]);
+        ch_queue_destroy(&ch->pools[c]);
+    }
+    free(ch->queues);
+    free(ch->pools);
     uint32_t i;
-    for (i = 0; i < NUM_BUFFS_PER_CHANNEL; i++)
+    for (i = 0; i < ch->num_buffs; i++)
         netbuffer_destroy(&ch->buffers[i]);
     free(ch->buffers);
+    if (ch->shm_buffers != NULL) {
+        for (c = 0; c < NUM_COMM_SERVERS; c++)
+            ch_queue_destroy(&ch->shm_pools[c]);
+        free(ch->shm_pools);
+        free(ch->shm_buffers);
+    }
 }
 
-void comm_server_init()
+void comm_server_init_pend_array(pend_array_t * pa, uint32_t size)
 {
+    pa->count = 0;
+    pa->size = size;
+    pa->buffs = (net_buffer_t **) _malloc(size * sizeof(net_buffer_t *));
+    pa->requests = (MPI_Request *) _malloc(size * sizeof(MPI_Request));
+    pa->indices = (int *)_malloc(size * sizeof(int));
+    pa->statuses = (MPI_Status *) _malloc(size * sizeof(MPI_Status));
+}
+
+void comm_server_init_emu_link(emu_link_t * l)
+{
+    pend_queue_init(&l->pending);
+    l->next = NULL;
+    l->free_tick = 0;
+}
+
+void comm_server_destroy_pend_array(pend_array_t * pa)
+{
+    free(pa->buffs);
+    free(pa->requests);
+    free(pa->indices);
+    free(pa->statuses);
+}
+
+/* a helper parsing a buffer in place keeps it out of its recv channel */
+#if ENABLE_HELPER_BUFF_COPY
+#define NUM_HELD_RECV_BUFFS 0
+#else
+#define NUM_HELD_RECV_BUFFS 1
+#endif
+
+/* number of buffers per channel of class c, the sizes of the smaller 
+ * classes must be set. The classes share the memory of 
+ * NUM_BUFFS_PER_CHANNEL large buffers: each smaller class has 
+ * NUM_BUFFS_PER_CHANNEL buffers and the large class gets what is left
+ * (at least half of them), unless --gmt_num_large_buffs_per_channel 
+ * sets it */
+INLINE uint32_t comm_server_class_buffs(uint32_t c)
+{
+    if (c != BUFF_CLASS_LARGE)
+        return NUM_BUFFS_PER_CHANNEL;
+    if (config.num_large_buffs_per_channel != 0)
+        return config.num_large_buffs_per_channel;
+    uint64_t budget = (uint64_t) NUM_BUFFS_PER_CHANNEL * COMM_BUFFER_SIZE;
+    uint64_t small = 0;
     uint32_t i;
-    cs.send_channels = (channel_t*)_malloc(NUM_SEND_CHANNELS * sizeof(channel_t));
-    for (i = 0; i < NUM_SEND_CHANNELS; i++)
-        comm_server_init_channel(&cs.send_channels[i]);
+    for (i = 0; i < BUFF_CLASS_LARGE; i++)
+        small += (uint64_t) NUM_BUFFS_PER_CHANNEL * cs.class_size[i];
+    uint64_t num = (small < budget) ? (budget - small) / COMM_BUFFER_SIZE : 0;
+    return (uint32_t) MAX(num, MAX(NUM_BUFFS_PER_CHANNEL / 2, 1));
+}
 
-    cs.recv_channels = (channel_t*)_malloc(NUM_RECV_CHANNELS * sizeof(channel_t));
+void comm_server_init()
+{
+    uint32_t i, c;
+    network_comms_init(NUM_COMM_SERVERS);
+    network_shm_init();
+
+    cs.recv_idle = (idle_t *) _malloc(NUM_RECV_CHANNELS * sizeof(idle_t));
     for (i = 0; i < NUM_RECV_CHANNELS; i++)
-        comm_server_init_channel(&cs.recv_channels[i]);
+        idle_init(&cs.recv_idle[i]);
+
+    uint32_t num_send_buffs = 0, num_recv_buffs = 0;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++) {
+        uint32_t shift = BUFF_CLASS_SHIFT * (BUFF_CLASS_LARGE - c);
+        cs.class_size[c] = MAX(COMM_BUFFER_SIZE >> shift,
+                               MIN(CTRL_BUFFER_SIZE, COMM_BUFFER_SIZE));
+        uint32_t num_buffs = comm_server_class_buffs(c);
+
+        cs.send_channels[c] =
+            (channel_t *) _malloc(NUM_SEND_CHANNELS * sizeof(channel_t));
+        for (i = 0; i < NUM_SEND_CHANNELS; i++) {
+            channel_t *ch = &cs.send_channels[c][i];
+            comm_server_init_channel(ch, num_buffs, cs.class_size[c],
+                                     NET_CLASS_TAG(c), false);
+            uint32_t b;
+            for (b = 0; config.sg_min_bytes != 0 && b < num_buffs; b++)
+                netbuffer_init_sg(&ch->buffers[b]);
+        }
+
+        /* shm messages of any class are loaned to the largest class */
+        cs.recv_channels[c] =
+            (channel_t *) _malloc(NUM_RECV_CHANNELS * sizeof(channel_t));
+        for (i = 0; i < NUM_RECV_CHANNELS; i++) {
+            comm_server_init_channel(&cs.recv_channels[c][i],
+                                     num_buffs + NUM_HELD_RECV_BUFFS,
+                                     cs.class_size[c], NET_CLASS_TAG(c),
+                                     net.shm_enabled &&
+                                     c == BUFF_CLASS_LARGE);
+            cs.recv_channels[c][i].idle = &cs.recv_idle[i];
+        }
+        num_send_buffs += num_buffs * NUM_SEND_CHANNELS;
+        num_recv_buffs += (num_buffs + NUM_HELD_RECV_BUFFS) *
+            NUM_RECV_CHANNELS;
+    }
+
+    cs.ctrl_send_channels = (channel_t*)_malloc(NUM_SEND_CHANNELS *
+                                                sizeof(channel_t));
+    for (i = 0; i < NUM_SEND_CHANNELS; i++)
+        comm_server_init_channel(&cs.ctrl_send_channels[i],
+                                 NUM_CTRL_BUFFS_PER_CHANNEL, CTRL_BUFFER_SIZE,
+                                 NET_CTRL_TAG, false);
+
+    cs.ctrl_recv_channels = (channel_t*)_malloc(NUM_RECV_CHANNELS *
+                                                sizeof(channel_t));
+    for (i = 0; i < NUM_RECV_CHANNELS; i++) {
+        comm_server_init_channel(&cs.ctrl_recv_channels[i],
+                                 NUM_CTRL_BUFFS_PER_CHANNEL, CTRL_BUFFER_SIZE,
+                                 NET_CTRL_TAG, false);
+        cs.ctrl_recv_channels[i].idle = &cs.recv_idle[i];
+    }
 
-    pend_queue_init(&cs.pending_send);
-    pend_queue_init(&cs.pending_recv);
+    cs.threads = (comm_server_thread_t *)
+        _malloc(NUM_COMM_SERVERS * sizeof(comm_server_thread_t));
+    for (i = 0; i < NUM_COMM_SERVERS; i++) {
+        comm_server_thread_t *t = &cs.threads[i];
+        t->id = i;
+        comm_server_init_pend_array(&t->pending_send, num_send_buffs +
+                                    NUM_CTRL_BUFFS_PER_CHANNEL *
+                                    NUM_SEND_CHANNELS);
+        comm_server_init_pend_array(&t->pending_recv, num_recv_buffs +
+                                    NUM_CTRL_BUFFS_PER_CHANNEL *
+                                    NUM_RECV_CHANNELS);
+        pend_queue_init(&t->pending_shm);
+        comm_server_init_emu_link(&t->emu_ctrl);
+        comm_server_init_emu_link(&t->emu_bulk);
+        idle_init(&t->idle);
+        backoff_init(&t->backoff);
+        t->rndv_new = NULL;
+        t->rndv_pending = NULL;
+    }
+    cs.rndv_done = NULL;
     cs.init_done = true;
 }
 
 void comm_server_destroy()
 {
-    uint32_t i;
+    uint32_t i, c;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++) {
+        for (i = 0; i < NUM_SEND_CHANNELS; i++)
+            comm_server_destroy_channel(&cs.send_channels[c][i]);
+        for (i = 0; i < NUM_RECV_CHANNELS; i++)
+            comm_server_destroy_channel(&cs.recv_channels[c][i]);
+        free(cs.send_channels[c]);
+        free(cs.recv_channels[c]);
+    }
     for (i = 0; i < NUM_SEND_CHANNELS; i++)
-        comm_server_destroy_channel(&cs.send_channels[i]);
+        comm_server_destroy_channel(&cs.ctrl_send_channels[i]);
     for (i = 0; i < NUM_RECV_CHANNELS; i++)
-        comm_server_destroy_channel(&cs.recv_channels[i]);
-    free(cs.send_channels);
-    free(cs.recv_channels);
-    pend_queue_destroy(&cs.pending_send);
-    pend_queue_destroy(&cs.pending_recv);
+        comm_server_destroy_channel(&cs.ctrl_recv_channels[i]);
+    free(cs.ctrl_send_channels);
+    free(cs.ctrl_recv_channels);
+    for (i = 0; i < NUM_COMM_SERVERS; i++) {
+        comm_server_thread_t *t = &cs.threads[i];
+        comm_server_destroy_pend_array(&t->pending_send);
+        comm_server_destroy_pend_array(&t->pending_recv);
+        pend_queue_destroy(&t->pending_shm);
+        pend_queue_destroy(&t->emu_ctrl.pending);
+        pend_queue_destroy(&t->emu_bulk.pending);
+        _assert(t->rndv_new == NULL && t->rndv_pending == NULL);
+    }
+    _assert(cs.rndv_done == NULL);
+    free(cs.threads);
+    free(cs.recv_idle);
+    network_shm_destroy();
+    network_comms_destroy();
+}
+
+INLINE void comm_server_pend_push(pend_array_t * pa, net_buffer_t * buff)
+{
+    _assert(pa->count < pa->size);
+    pa->buffs[pa->count] = buff;
+    pa->requests[pa->count] = buff->request;
+    pa->count++;
 }
 
-INLINE bool comm_server_do_send()
+/* test all the requests in flight, returns the number of completed ones
+ * whose buffers are in pa->buffs[pa->indices[0..n-1]] */
+INLINE uint32_t comm_server_pend_testsome(pend_array_t * pa)
+{
+    if (pa->count == 0)
+        return 0;
+#if ENABLE_PROFILING
+    uint64_t start = rdtsc();
+#endif
+    uint32_t n = network_testsome(pa->count, pa->requests, pa->indices,
+                                  pa->statuses);
+    INCR_EVENT(COMM_POLL_CYCLES, rdtsc() - start);
+    COUNT_EVENT(COMM_POLL_CALLS);
+    return n;
+}
+
+/* remove completed requests (set to MPI_REQUEST_NULL) from the array */
+INLINE void comm_server_pend_compact(pend_array_t * pa)
+{
+    uint32_t i = 0;
+    while (i < pa->count) {
+        if (pa->requests[i] == MPI_REQUEST_NULL) {
+            pa->count--;
+            pa->buffs[i] = pa->buffs[pa->count];
+            pa->requests[i] = pa->requests[pa->count];
+        } else
+            i++;
+    }
+}
+
+INLINE void comm_server_send_completed(comm_server_thread_t * t,
+                                       net_buffer_t * buff)
+{
+    channel_t *send_channel = (channel_t *) buff->context;
+    DEBUG0(printf("n %d comm server %u sent %u bytes on buffer id %u "
+                  "channel %p\n", node_id, t->id, buff->num_bytes,
+                  buff->id, send_channel););
+
+    INCR_EVENT(COMM_SEND_BYTES, buff->num_bytes);
+    if (buff->sg_cnt != 0)
+        agm_sg_release(buff);
+    ch_queue_push(&send_channel->pools[t->id], buff);
+    COUNT_EVENT(buff->transport == NET_TRANSPORT_SHM ?
+                COMM_SHM_SEND_COMPLETED : COMM_SEND_COMPLETED);
+}
+
+INLINE void comm_server_send_buff(comm_server_thread_t * t,
+                                  net_buffer_t * buff)
+{
+    network_send_nb(buff);
+    if (buff->transport == NET_TRANSPORT_MPI)
+        comm_server_pend_push(&t->pending_send, buff);
+    else if (buff->shm_done)
+        comm_server_send_completed(t, buff);
+    else
+        pend_queue_push(&t->pending_shm, buff);
+}
+
+INLINE bool comm_server_emulation()
+{
+    return config.emu_latency != 0 || config.emu_ticks_per_kb != 0;
+}
+
+/* Network emulation: a link of the comm server transmits one buffer at a
+ * time at emu_ticks_per_kb, then the buffer takes emu_latency to arrive.
+ * Release ticks are non decreasing so buffers are held in a fifo. Control
+ * buffers have their own link, like the priority channel they go ahead of
+ * queued bulk data, but the time they take the wire delays the bulk link */
+INLINE void comm_server_delay_buff(comm_server_thread_t * t, emu_link_t * l,
+                                   net_buffer_t * buff)
+{
+    uint64_t tick = rdtsc();
+    uint64_t xmit = (buff->num_bytes * config.emu_ticks_per_kb) / 1024;
+    if (l->free_tick < tick)
+        l->free_tick = tick;
+    l->free_tick += xmit;
+    buff->release_tick = l->free_tick + config.emu_latency;
+    pend_queue_push(&l->pending, buff);
+    if (l == &t->emu_ctrl && t->emu_bulk.free_tick > tick)
+        t->emu_bulk.free_tick += xmit;
+}
+
+/* send the buffers held by l whose release tick has passed, returns true 
+ * while some buffer is still held */
+INLINE bool comm_server_do_delayed(comm_server_thread_t * t, emu_link_t * l)
+{
+    if (l->next == NULL && !pend_queue_pop(&l->pending, &l->next))
+        return false;
+    uint64_t tick = rdtsc();
+    while (l->next != NULL && l->next->release_tick <= tick) {
+        comm_server_send_buff(t, l->next);
+        if (!pend_queue_pop(&l->pending, &l->next))
+            l->next = NULL;
+    }
+    return l->next != NULL;
+}
+
+INLINE bool comm_server_do_send_channels(comm_server_thread_t * t,
+                                        channel_t * channels, emu_link_t * l)
 {
     /* send buffers in queue */
     uint32_t i;
     bool sent = false;
     for (i = 0; i < NUM_SEND_CHANNELS; i++) {
         net_buffer_t *buff;
-        channel_t *send_channel = &cs.send_channels[i];
-        if (ch_queue_pop(&send_channel->queue, &buff)) {
+        channel_t *send_channel = &channels[i];
+        if (ch_queue_pop(&send_channel->queues[t->id], &buff)) {
             _assert(buff->num_bytes != 0);
-            DEBUG0(printf("n %d comm_server sending buffer id %u size %u on "
-                          "channel %p\n", node_id, buff->id, buff->num_bytes,
-                          send_channel););
-            network_send_nb(buff);
-            pend_queue_push(&cs.pending_send, buff);
+            _assert(network_comm_of(buff->rnode_id) == t->id);
+            DEBUG0(printf("n %d comm_server %u sending buffer id %u size %u "
+                          "on channel %p\n", node_id, t->id, buff->id,
+                          buff->num_bytes, send_channel););
+            if (comm_server_emulation())
+                comm_server_delay_buff(t, l, buff);
+            else
+                comm_server_send_buff(t, buff);
             sent = true;
         }
     }
     return sent;
 }
 
-INLINE void comm_server_test_send()
+INLINE bool comm_server_do_send(comm_server_thread_t * t)
 {
-    /* push completed buffers in pool */
+    /* control buffers go first, then bulk ones from the smallest class */
+    bool sent = comm_server_do_send_channels(t, cs.ctrl_send_channels,
+                                             &t->emu_ctrl);
+    uint32_t c;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++)
+        sent |= comm_server_do_send_channels(t, cs.send_channels[c],
+                                             &t->emu_bulk);
+    return sent;
+}
+
+INLINE bool comm_server_test_send(comm_server_thread_t * t)
+{
+    /* push completed buffers in pool as soon as they are done */
+    uint32_t i, n = comm_server_pend_testsome(&t->pending_send);
+    for (i = 0; i < n; i++)
+        comm_server_send_completed(t, t->pending_send.buffs
+                                   [t->pending_send.indices[i]]);
+    if (n > 0)
+        comm_server_pend_compact(&t->pending_send);
+
+    /* retry shm sends that found the remote ring full */
     net_buffer_t *buff;
-    if (pend_queue_pop(&cs.pending_send, &buff)) {
-        if (network_test_send(buff)) {
-            channel_t *send_channel = (channel_t *) buff->context;
-            DEBUG0(printf("n %d comm server sent %u bytes on buffer id %u "
-                          "channel %p\n", node_id, buff->num_bytes,
-                          buff->id, send_channel););
-
-            INCR_EVENT(COMM_SEND_BYTES, buff->num_bytes);
-            ch_queue_push(&send_channel->pool, buff);
-            COUNT_EVENT(COMM_SEND_COMPLETED);
-        } else {                /* push back in queue */
-            pend_queue_push(&cs.pending_send, buff);
-        }
+    uint32_t num_shm = pend_queue_size(&t->pending_shm);
+    for (i = 0; i < num_shm; i++) {
+        if (!pend_queue_pop(&t->pending_shm, &buff))
+            break;
+        if (network_test_send(buff))
+            comm_server_send_completed(t, buff);
+        else
+            pend_queue_push(&t->pending_shm, buff);
     }
-
+    return n > 0;
 }
 
-INLINE bool comm_server_do_recv()
+INLINE bool comm_server_do_recv_channels(comm_server_thread_t * t,
+                                        channel_t * channels)
 {
     /* post receive buffers in pool */
     uint32_t i;
     bool received = false;
     for (i = 0; i < NUM_RECV_CHANNELS; i++) {
         net_buffer_t *buff;
-        channel_t *recv_channel = &cs.recv_channels[i];
-        if (ch_queue_pop(&recv_channel->pool, &buff)) {
+        channel_t *recv_channel = &channels[i];
+        if (ch_queue_pop(&recv_channel->pools[t->id], &buff)) {
             _assert(buff != NULL);
-            DEBUG0(printf("n %d comm_server post receive buffer id %u "
-                          "on channel %p\n", node_id, buff->id, recv_channel););
-            network_recv_nb(buff);
-            pend_queue_push(&cs.pending_recv, buff);
+            if (buff->transport == NET_TRANSPORT_SHM) {
+                /* helper is done with the slot, give it back to the sender */
+                network_shm_release(buff);
+                ch_queue_push(&recv_channel->shm_pools[t->id], buff);
+                continue;
+            }
+            DEBUG0(printf("n %d comm_server %u post receive buffer id %u "
+                          "on channel %p\n", node_id, t->id, buff->id,
+                          recv_channel););
+            network_recv_nb(buff, t->id);
+            comm_server_pend_push(&t->pending_recv, buff);
             received = true;
         }
     }
     return received;
 }
 
-INLINE void comm_server_test_recv()
+INLINE bool comm_server_do_recv(comm_server_thread_t * t)
 {
-    net_buffer_t *buff;
-    if (pend_queue_pop(&cs.pending_recv, &buff)) {
-        if (network_test_recv(buff)) {
+    bool received = comm_server_do_recv_channels(t, cs.ctrl_recv_channels);
+    uint32_t c;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++)
+        received |= comm_server_do_recv_channels(t, cs.recv_channels[c]);
+    return received;
+}
+
+INLINE bool comm_server_test_recv(comm_server_thread_t * t)
+{
+    uint32_t i, n = comm_server_pend_testsome(&t->pending_recv);
+    for (i = 0; i < n; i++) {
+        net_buffer_t *buff = t->pending_recv.buffs[t->pending_recv.indices[i]];
+        network_recv_complete(buff, &t->pending_recv.statuses[i]);
+        _assert(buff->num_bytes > 0);
+        channel_t *recv_channel = (channel_t *) buff->context;
+        DEBUG0(printf("n %d comm server %u received %u bytes buffer id %u "
+                      " on channel %p\n", node_id, t->id, buff->num_bytes,
+                      buff->id, recv_channel););
+        INCR_EVENT(COMM_RECV_BYTES, buff->num_bytes);
+        ch_queue_push(&recv_channel->queues[t->id], buff);
+        idle_wake(recv_channel->idle);
+        COUNT_EVENT(COMM_RECV_COMPLETED);
+    }
+    if (n > 0)
+        comm_server_pend_compact(&t->pending_recv);
+    return n > 0;
+}
+
+INLINE bool comm_server_test_shm_recv(comm_server_thread_t * t)
+{
+    /* loan full ring slots to the recv channels */
+    uint32_t i;
+    bool received = false;
+    for (i = 0; i < NUM_RECV_CHANNELS; i++) {
+        net_buffer_t *buff;
+        channel_t *recv_channel = &cs.recv_channels[BUFF_CLASS_LARGE][i];
+        if (!ch_queue_pop(&recv_channel->shm_pools[t->id], &buff))
+            continue;
+        if (network_shm_test_recv(buff, t->id)) {
             _assert(buff->num_bytes > 0);
-            channel_t *recv_channel = (channel_t *) buff->context;
-            DEBUG0(printf("n %d comm server received %u bytes buffer id %u "
-                          " on channel %p\n", node_id, buff->num_bytes,
-                          buff->id, recv_channel););
+            DEBUG0(printf("n %d comm server %u received %u bytes from shm "
+                          "buffer id %u on channel %p\n", node_id, t->id,
+                          buff->num_bytes, buff->id, recv_channel););
             INCR_EVENT(COMM_RECV_BYTES, buff->num_bytes);
-            ch_queue_push(&recv_channel->queue, buff);
-            COUNT_EVENT(COMM_RECV_COMPLETED);
+            ch_queue_push(&recv_channel->queues[t->id], buff);
+            idle_wake(recv_channel->idle);
+            COUNT_EVENT(COMM_SHM_RECV_COMPLETED);
+            received = true;
+        } else {
+            ch_queue_push(&recv_channel->shm_pools[t->id], buff);
+            break;
+        }
+    }
+    return received;
+}
+
+INLINE bool comm_server_do_rndv(comm_server_thread_t * t)
+{
+    rndv_req_t *r = comm_server_rndv_take(&t->rndv_new);
+    bool posted = (r != NULL);
+    while (r != NULL) {
+        rndv_req_t *next = r->next;
+        if (r->is_send)
+            network_rndv_send_nb(r->rnid, r->data, r->nbytes, r->tag,
+                                 &r->request);
+        else
+            network_rndv_recv_nb(r->rnid, r->data, r->nbytes, r->tag,
+                                 &r->request);
+        r->next = t->rndv_pending;
+        t->rndv_pending = r;
+        r = next;
+    }
+    return posted;
+}
+
+INLINE bool comm_server_test_rndv(comm_server_thread_t * t)
+{
+    bool completed = false;
+    rndv_req_t **prev = &t->rndv_pending;
+    while (*prev != NULL) {
+        rndv_req_t *r = *prev;
+        if (!network_test(&r->request)) {
+            prev = &r->next;
+            continue;
+        }
+        *prev = r->next;
+        completed = true;
+        if (r->is_send) {
+            INCR_EVENT(COMM_SEND_BYTES, r->nbytes);
+            COUNT_EVENT(COMM_RNDV_SEND_COMPLETED);
+            free(r);
         } else {
-            pend_queue_push(&cs.pending_recv, buff);
+            INCR_EVENT(COMM_RECV_BYTES, r->nbytes);
+            COUNT_EVENT(COMM_RNDV_RECV_COMPLETED);
+            comm_server_rndv_push(&cs.rndv_done, r);
+            uint32_t i;
+            for (i = 0; i < NUM_RECV_CHANNELS; i++)
+                idle_wake(&cs.recv_idle[i]);
         }
     }
+    return completed;
 }
 
 void *comm_server_loop(void *arg)
 {
-    _unused(arg);
+    comm_server_thread_t *t = (comm_server_thread_t *) arg;
     if (config.thread_pinning) {
         if(config.affinity_policy_id == LEGACY_PIN_POLICY){
-            pin_thread(config.num_cores - 1);
+            pin_thread(config.num_cores - 1 - t->id);
             if (node_id == 0) {
-                DEBUG0(printf("pining CPU %u with pthread_id %u\n", config.num_cores - 1, get_thread_id()););
+                DEBUG0(printf("pining CPU %u with pthread_id %u\n", config.num_cores - 1 - t->id, get_thread_id()););
             }
         }else{
-            comm_server_set_thread_affinity();
+            comm_server_set_thread_affinity(t->id);
         }
     }
-    network_barrier();
+    if (t->id == 0)
+        network_barrier();
     while (!cs.init_done) ;
 
     bool sent = false;
@@ -199,15 +600,33 @@ void *comm_server_loop(void *arg)
     while (!cs.stop_flag || sent || received) {
         DEBUG0(if (loops++ % DEBUG_PRINT_INTERVAL == 0)
                printf
-               ("n %d comm server alive stop_flag:%u sent:%u received:%u\n",
-                node_id, cs.stop_flag, sent, received);) ;
+               ("n %d comm server %u alive stop_flag:%u sent:%u received:%u\n",
+                node_id, t->id, cs.stop_flag, sent, received);) ;
 
-        comm_server_test_send();
-        comm_server_test_recv();
-        sent = comm_server_do_send();
-        received = comm_server_do_recv();
+        bool completed = comm_server_test_send(t);
+        completed |= comm_server_test_recv(t);
+        completed |= comm_server_test_rndv(t);
+        sent = comm_server_do_send(t);
+        if (comm_server_emulation()) {
+            sent |= comm_server_do_delayed(t, &t->emu_ctrl);
+            sent |= comm_server_do_delayed(t, &t->emu_bulk);
+        }
+        sent |= comm_server_do_rndv(t);
+        received = comm_server_do_recv(t);
+        if (net.shm_enabled)
+            received |= comm_server_test_shm_recv(t);
+
+        if (completed || sent || received || cs.stop_flag)
+            idle_reset(&t->backoff);
+        else
+            /* MPI arrivals can only be seen by polling, they are noticed
+             * within the park timeout */
+            idle_miss(&t->idle, &t->backoff, t->pending_send.count == 0 &&
+                      pend_queue_size(&t->pending_shm) == 0 &&
+                      t->rndv_pending == NULL);
     }
-    DEBUG0(printf("n %d communication server loop completed\n", node_id););    
+    DEBUG0(printf("n %d communication server %u loop completed\n", node_id,
+                  t->id););
     pthread_exit(NULL);
 }
 
@@ -215,20 +634,23 @@ void comm_server_run()
 {
     cs.stop_flag = false;
 
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    /* set stack address for this worker */
-    void *stack_addr = (void *)((uint64_t)pt_stacks + (NUM_WORKERS + NUM_HELPERS) * PTHREAD_STACK_SIZE);
-
-    int ret = pthread_attr_setstack(&attr, stack_addr, PTHREAD_STACK_SIZE);
-    if (ret)
-        perror("FAILED TO SET STACK PROPERTIES"), exit(EXIT_FAILURE);
+    uint32_t i;
+    for (i = 0; i < NUM_COMM_SERVERS; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        /* set stack address for this comm server */
+        void *stack_addr = (void *)((uint64_t)pt_stacks + 
+            (NUM_WORKERS + NUM_HELPERS + i) * PTHREAD_STACK_SIZE);
 
-    ret = pthread_create(&cs.pthread, &attr, &comm_server_loop, NULL);
+        int ret = pthread_attr_setstack(&attr, stack_addr, PTHREAD_STACK_SIZE);
+        if (ret)
+            perror("FAILED TO SET STACK PROPERTIES"), exit(EXIT_FAILURE);
 
-    
-    if (ret)
-        perror("FAILED TO CREATE COMM SERVER"), exit(EXIT_FAILURE);
+        ret = pthread_create(&cs.threads[i].pthread, &attr, &comm_server_loop,
+                             &cs.threads[i]);
+        if (ret)
+            perror("FAILED TO CREATE COMM SERVER"), exit(EXIT_FAILURE);
+    }
 }
 
 void comm_server_stop()
@@ -237,7 +659,11 @@ void comm_server_stop()
     while (cs.stop_flag) ;
 
     cs.stop_flag = true;
-    pthread_join(cs.pthread, NULL);
+    uint32_t i;
+    for (i = 0; i < NUM_COMM_SERVERS; i++)
+        idle_wake(&cs.threads[i].idle);
+    for (i = 0; i < NUM_COMM_SERVERS; i++)
+        pthread_join(cs.threads[i].pthread, NULL);
 
     network_barrier();
 }
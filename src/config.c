@@ -59,6 +59,7 @@ void config_init()
     config.num_cmd_blocks = 128;
     config.cmd_block_size = 4096;
     config.num_buffs_per_channel = 64;
+    config.num_large_buffs_per_channel = 0;
 
     config.num_cores = get_num_cores_hwloc();
 
@@ -74,6 +75,7 @@ void config_init()
     config.num_helpers = 1;
 #endif
 
+    config.num_comm_servers = 1;
     config.num_uthreads_per_worker = 1024;
     config.max_nesting = 2;
     config.mtasks_per_queue = 1 << 20;
@@ -95,6 +97,23 @@ void config_init()
     config.print_sched_interv = 0;
     config.cmdb_check_interv = 100000;
     config.node_agg_check_interv = 2000000;
+    config.agg_min_deadline = 0;
+    config.agg_combine = false;
+    config.route_group_size = 0;
+    config.compact_cmds = false;
+    config.shm_transport = true;
+    config.shm_ring_slots = 8;
+    config.rma_threshold = 0;
+    config.rma_max_attach = 64;
+    config.rndv_transfers = true;
+    config.emu_latency = 0;
+    config.emu_ticks_per_kb = 0;
+    config.sg_min_bytes = 0;
+    config.idle_spins = 0;
+    config.idle_park_usec = 100;
+    config.block_cyclic_elems = 64;
+    config.hugepages = false;
+    config.hugepage_kb = 2048;
 
 #if DTA
 	config.dta_chunk_size = 1024;
@@ -108,6 +127,7 @@ void config_init()
     config.state_prot = PROT_READ;
     config.disk_path[0] = '\0';
     config.ssd_path[0] = '\0';
+    config.hugetlbfs_path[0] = '\0';
     config.max_handles_per_node = 256 * 1024;
     config.handle_check_interv = 1024;
     config.mtask_check_interv = 100000;
@@ -149,6 +169,11 @@ options_t options[] = {
     {"--gmt_num_helpers", OPT_UINT32, true, &config.num_helpers,
      {NULL}, NUM_HELPERS_DYN, "Number of helper threads"},
 
+    {"--gmt_num_comm_servers", OPT_UINT32, true, &config.num_comm_servers,
+     {NULL}, NUM_COMM_SERVERS_DYN,
+     "Number of communication server threads, each one serves a disjoint set "
+     "of remote nodes"},
+
     {"--gmt_num_uthreads_per_worker", OPT_UINT32, true,
      &config.num_uthreads_per_worker,
      {NULL}, NUM_UTHREADS_PER_WORKER_DYN, "Number of uthreads per worker"},
@@ -168,6 +193,14 @@ options_t options[] = {
      "recv. A worker has 1 send channel while a helper has both a send and recv "
      "channel"},
 
+    {"--gmt_num_large_buffs_per_channel", OPT_UINT32, true,
+     &config.num_large_buffs_per_channel,
+     {NULL}, true,
+     "Number of buffers of the largest size class (comm_buffer_size) per "
+     "channel, the smaller classes have num_buffs_per_channel buffers "
+     "(0 to use the memory of num_buffs_per_channel large buffers left by "
+     "the smaller classes)"},
+
     {"--gmt_num_cmd_blocks", OPT_UINT32, true, &config.num_cmd_blocks, {NULL},
      NUM_CMD_BLOCKS_DYN,
      "Number of command blocks per node that can be used to send message to a "
@@ -226,6 +259,81 @@ options_t options[] = {
      "Ticks a helper will wait before aggregating all the commands in a node "
      " in case a communication buffer is never full"},
 
+    {"--gmt_agg_min_deadline", OPT_UINT32, true, &config.agg_min_deadline,
+     {NULL}, true,
+     "Adapt the flush deadline of each remote node to its traffic, between "
+     "this many ticks and node_agg_check_interv (0 uses the fixed check "
+     "intervals)"},
+
+    {"--gmt_agg_combine", OPT_BOOL, false, &config.agg_combine,
+     {.bvalue = true}, true,
+     "Merge non-fetching atomic adds and collapse put values to the same "
+     "element issued by a task while they wait in the same command block"},
+
+    {"--gmt_route_group_size", OPT_UINT32, true, &config.route_group_size,
+     {NULL}, true,
+     "Split the nodes in groups of this many and send commands without "
+     "payload for another group through a proxy node of that group, "
+     "e.g. sqrt(num_nodes) (0 sends every command directly)"},
+
+    {"--gmt_compact_cmds", OPT_BOOL, false, &config.compact_cmds,
+     {.bvalue = true}, true,
+     "Encode put values and atomic adds with variable-length fields "
+     "relative to the previous command of the block (used only if every "
+     "node enables it)"},
+
+    {"--gmt_no_shm_transport", OPT_BOOL, false, &config.shm_transport,
+     {.bvalue = false}, true,
+     "Send buffers to nodes on the same host through MPI instead of "
+     "shared-memory rings"},
+
+    {"--gmt_shm_ring_slots", OPT_UINT32, true, &config.shm_ring_slots,
+     {NULL}, true,
+     "Number of communication buffers in each shared-memory ring between "
+     "two nodes on the same host"},
+
+    {"--gmt_rma_threshold", OPT_UINT64, true, &config.rma_threshold,
+     {NULL}, true,
+     "Remote puts and gets of at least this many bytes on arrays at least "
+     "this large are done with one-sided MPI RMA instead of commands "
+     "(0 disables it, requires MPI_THREAD_MULTIPLE)"},
+
+    {"--gmt_rma_max_attach", OPT_UINT32, true, &config.rma_max_attach,
+     {NULL}, true,
+     "Maximum number of arrays attached at once to the RMA window of each "
+     "node, must not exceed the MPI limit (osc_rdma_max_attach in Open MPI)"},
+
+    {"--gmt_no_rendezvous", OPT_BOOL, false, &config.rndv_transfers,
+     {.bvalue = false}, true,
+     "Split remote puts larger than a communication buffer into commands "
+     "instead of sending their payload with a single rendezvous message"},
+
+    {"--gmt_emu_latency", OPT_UINT64, true, &config.emu_latency,
+     {NULL}, true,
+     "Network emulation: ticks every outgoing buffer is held before being "
+     "sent, to model a multi-node network with nodes on the same host"},
+
+    {"--gmt_emu_ticks_per_kb", OPT_UINT64, true, &config.emu_ticks_per_kb,
+     {NULL}, true,
+     "Network emulation: ticks needed by a comm server link to transmit "
+     "1KB (bandwidth limit), 0 for unlimited bandwidth"},
+
+    {"--gmt_sg_min_bytes", OPT_UINT32, true, &config.sg_min_bytes,
+     {NULL}, true,
+     "Aggregation sends command payloads of at least this many bytes "
+     "straight from their memory with a scatter-gather message instead of "
+     "copying them into the buffer (0 always copies)"},
+
+    {"--gmt_idle_spins", OPT_UINT32, true, &config.idle_spins,
+     {NULL}, true,
+     "Empty iterations after which an idle comm server, helper or worker "
+     "starts backing off and then parks (0 always spins)"},
+
+    {"--gmt_idle_park_usec", OPT_UINT64, true, &config.idle_park_usec,
+     {NULL}, true,
+     "Latency budget of a parked thread: it polls again at least every "
+     "this many microseconds even if nobody wakes it (0 never parks)"},
+
 #if DTA
 	{"--gmt_dta_chunk_size", OPT_UINT32, true,
 	 &config.dta_chunk_size,
@@ -243,6 +351,11 @@ options_t options[] = {
 	 "Number of pre-allocated chunks for the helper-local allocator"},
 #endif
 
+    {"--gmt_block_cyclic_elems", OPT_UINT64, true, &config.block_cyclic_elems,
+     {NULL}, true,
+     "Number of consecutive elements on the same node for arrays "
+     "allocated with GMT_ALLOC_BLOCK_CYCLIC"},
+
     {"--gmt_state_name", OPT_STRING, true, &config.state_name, {NULL}, true,
      "State name to restore (or create if it does not exist)"},
 
@@ -260,6 +373,18 @@ options_t options[] = {
     {"--gmt_disk_path", OPT_STRING, true, &config.disk_path, {NULL}, true,
      "Disk path to use"},
 
+    {"--gmt_hugepages", OPT_BOOL, false, &config.hugepages,
+     {.bvalue = true}, true,
+     "Back with huge pages every RAM array whose local partition spans "
+     "at least one huge page (see also GMT_ALLOC_HUGEPAGE)"},
+
+    {"--gmt_hugepage_kb", OPT_UINT64, true, &config.hugepage_kb, {NULL}, true,
+     "Huge page size in KB (2048 or 1048576)"},
+
+    {"--gmt_hugetlbfs_path", OPT_STRING, true, &config.hugetlbfs_path,
+     {NULL}, true,
+     "hugetlbfs mount point where SHM states of huge page arrays are kept"},
+
     {"--gmt_limit_parallelism", OPT_BOOL, false, &config.limit_parallelism,
      {.bvalue = true}, true,
      "Limits the parallelism that a single task can create to "
@@ -559,6 +684,18 @@ void config_check()
     _check(config.max_handles_per_node * num_nodes < UINT32_MAX);
     _check(CMD_BLOCK_SIZE <= (1 << ARGS_SIZE_BITS));
     _check(NUM_WORKERS * NUM_UTHREADS_PER_WORKER <= (1 << TID_BITS));
+    _check(!config.shm_transport || config.shm_ring_slots >= 1);
+    _check(NUM_COMM_SERVERS >= 1);
+    _check(NUM_BUFFS_PER_CHANNEL >= NUM_COMM_SERVERS);
+    _check(config.num_large_buffs_per_channel == 0 ||
+           config.num_large_buffs_per_channel >= NUM_COMM_SERVERS);
+    _check(NUM_BUFF_CLASSES >= 1);
+    _check(NUM_CTRL_BUFFS_PER_CHANNEL >= NUM_COMM_SERVERS);
+    _check(config.sg_min_bytes == 0 || SG_MAX_SEGMENTS >= 2);
+    _check(config.agg_min_deadline <= config.node_agg_check_interv);
+    _check(config.route_group_size == 0 || ENABLE_AGGREGATION);
+    _check(config.block_cyclic_elems >= 1);
+    _check(config.hugepage_kb == 2048 || config.hugepage_kb == 1048576);
 #if DTA
 #if !NO_RESERVE
     _check(NUM_HELPERS == 1);
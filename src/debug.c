@@ -79,8 +79,11 @@ void _debug(const char *func, const char *file, int line, char *fmt, ...)
              && get_thread_id() < NUM_HELPERS + NUM_WORKERS)
         printf("[n%3d-h%3d] <%s:%d> %s(): %s", node_id,
                get_thread_id() - NUM_WORKERS, file, line, func, string);
-    else if (get_thread_id() == NUM_HELPERS + NUM_WORKERS)
-        printf("[n%3d-CS] <%s:%d> %s(): %s", node_id, file, line, func, string);
+    else if (get_thread_id() >= NUM_HELPERS + NUM_WORKERS
+             && get_thread_id() < NUM_HELPERS + NUM_WORKERS + NUM_COMM_SERVERS)
+        printf("[n%3d-CS%u] <%s:%d> %s(): %s", node_id,
+               get_thread_id() - NUM_HELPERS - NUM_WORKERS, file, line, func,
+               string);
     else
         printf("[n%3d] <%s:%d> %s(): %s", node_id, file, line, func, string);
 }
@@ -123,8 +126,10 @@ void sig_func(int sig)
                 if ( i + NUM_WORKERS != get_thread_id())
                     pthread_kill(helpers[i].pthread, SIGUSR1);                
             }
-            if ( get_thread_id() != NUM_WORKERS + NUM_HELPERS)
-                pthread_kill(cs.pthread, SIGUSR1);
+            for (i = 0; i < NUM_COMM_SERVERS; i++) {
+                if ( i + NUM_WORKERS + NUM_HELPERS != get_thread_id())
+                    pthread_kill(cs.threads[i].pthread, SIGUSR1);
+            }
         }
     } else {
          btrace();
@@ -132,7 +137,7 @@ void sig_func(int sig)
 
     if (num_nodes != 1) {
         if (__sync_fetch_and_add(&sig_cnt_exit, 1) ==
-            NUM_WORKERS + NUM_HELPERS + 1) {
+            NUM_WORKERS + NUM_HELPERS + NUM_COMM_SERVERS) {
             sig_cnt_exit = 0;
             sig_cnt_enter = 0;
         }
@@ -87,7 +87,7 @@ static inline void for_at(uint32_t tid, uint32_t wid, uint32_t rnid,
         ((mt = worker_mtask_alloc(wid)) == NULL)) {
       uint64_t its = MIN(it_per_task, it_end - it_start);
       //TODO:increase decrease nesting level before and after??               
-      worker_do_for(func, it_start, its, args, gmt_array, handle);
+      worker_do_for(func, rnid, it_start, its, args, gmt_array, handle);
       it_start += its;
       INCR_EVENT(WORKER_ITS_SELF_EXECUTE, its);
     }
@@ -112,7 +112,7 @@ static inline void for_at(uint32_t tid, uint32_t wid, uint32_t rnid,
     while (it_start < it_end && !worker_reserve_mtasks(tid, wid, rnid)) {
       uint64_t its = MIN(it_per_task, it_end - it_start);
       //TODO:increase decrease nesting level before and after??          
-      worker_do_for(func, it_start, its, args, gmt_array, handle);
+      worker_do_for(func, rnid, it_start, its, args, gmt_array, handle);
       it_start += its;
       INCR_EVENT(WORKER_ITS_SELF_EXECUTE, its);
     }
@@ -149,6 +149,22 @@ static inline void for_at(uint32_t tid, uint32_t wid, uint32_t rnid,
   }
 }
 
+/* number of local elements of node nid before global element elem of a 
+ * blocked array */
+static inline uint64_t dist_local_elems_before(gentry_t * ga, uint32_t nid,
+    uint64_t elem)
+{
+  uint64_t block_elems = ga->nbytes_dist_block / ga->nbytes_elem;
+  uint64_t num_blocks = CEILING(ga->nbytes_tot, ga->nbytes_dist_block);
+  uint64_t block = elem / block_elems;
+  uint64_t lelems = mem_dist_local_blocks_before(ga->gmt_array, ga->dist_id,
+      nid, block, num_blocks) * block_elems;
+  if (block < num_blocks &&
+      mem_dist_owner(ga->gmt_array, ga->dist_id, block, num_blocks) == nid)
+    lelems += elem - block * block_elems;
+  return lelems;
+}
+
 GMT_INLINE void gmt_for_each_with_handle(gmt_data_t gmt_array,
     uint64_t el_per_task, uint64_t elems_offset, uint64_t num_elems,
     gmt_for_each_func_t func, const void *args,
@@ -179,11 +195,25 @@ GMT_INLINE void gmt_for_each_with_handle(gmt_data_t gmt_array,
     ERRORMSG("Cannot be args == NULL && args_bytes > 0\n");
 
   uint32_t i;
+  if (GD_IS_DIST_BLOCKED(gmt_array)) {
+    /* local blocks follow the global order, so the elements of node "i" 
+     * in the range are a contiguous range of its local elements */
+    for (i = 0; i < num_nodes; i++) {
+      uint64_t it_start = dist_local_elems_before(ga, i, elems_offset);
+      uint64_t it_end = dist_local_elems_before(ga, i,
+          elems_offset + num_elems);
+      if (it_start < it_end)
+        for_at(tid, wid, i, gmt_array, it_start, it_end, el_per_task,
+            (void *)func, args, args_bytes, handle);
+    }
+    return;
+  }
+
   for (i = 0; i < num_nodes; i++) {
     uint64_t nbytes_loc, nbytes_block, goffset_bytes;
     /* understand how many bytes node "i" has */
     block_partition(i, ga->nbytes_tot/ga->nbytes_elem,
-        ga->nbytes_elem, gmt_array,
+        ga->nbytes_elem, gmt_array, ga->nbytes_dist_block, ga->dist_id,
         &nbytes_loc, &nbytes_block, &goffset_bytes);
 
     if (nbytes_loc == 0)
@@ -68,8 +68,9 @@ GMT_INLINE gmt_data_t gmt_alloc(uint64_t num_elems, uint64_t bytes_per_elem,
   return gmt_array;
 }
 
-GMT_INLINE gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
-                     alloc_type_t alloc_type, const char *array_name)
+static inline gmt_data_t alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
+                     alloc_type_t alloc_type, uint64_t dist_block_elems,
+                     gmt_dist_t dist, const char *array_name)
 {
 
     if (num_elems == 0 || bytes_per_elem == 0) {
@@ -81,7 +82,10 @@ GMT_INLINE gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
     gmt_data_t gmt_array = GMT_DATA_NULL;
     GD_SET_ID(gmt_array, id);
     GD_SET_NODE(gmt_array, node_id);
-    GD_SET_TYPE(gmt_array, alloc_type);
+    /* the huge page flag has a bit of its own, the type bits keep the
+     * layout of the states saved so far */
+    GD_SET_TYPE(gmt_array, alloc_type & ~GMT_ALLOC_HUGEPAGE);
+    GD_SET_HUGE(gmt_array, alloc_type & GMT_ALLOC_HUGEPAGE);
     uint32_t name_len = 0;
     if (array_name != NULL)
         name_len = strlen(array_name);
@@ -97,6 +101,9 @@ GMT_INLINE gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
       case GMT_ALLOC_PARTITION_FROM_HERE:
         GD_SET_SNODE(gmt_array, node_id);
         break;
+      case GMT_ALLOC_BLOCK_CYCLIC:
+        GD_SET_SNODE(gmt_array, 0);
+        break;
       case GMT_ALLOC_PARTITION_FROM_RANDOM:
         GD_SET_SNODE(gmt_array, gmt_rand() % num_nodes);
         break;
@@ -121,17 +128,99 @@ GMT_INLINE gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
         cmd->gmt_array = gmt_array;
         cmd->num_elems = num_elems;
         cmd->bytes_per_elem = bytes_per_elem;
+        cmd->dist_block_elems = dist_block_elems;
+        cmd->dist_id = dist;
         cmd->name_len = name_len;
         memcpy(cmd + 1, array_name, name_len);
         uthread_incr_req_nbytes(tid, sizeof(uint64_t));
         agm_set_cmd_data(i, wid, NULL, 0);
       }
     }
-    mem_alloc(gmt_array, num_elems, bytes_per_elem, array_name, name_len);
+    mem_alloc(gmt_array, num_elems, bytes_per_elem, dist_block_elems, dist,
+              array_name, name_len);
     COUNT_EVENT(WORKER_GMT_ALLOC);
     return gmt_array;
 }
 
+GMT_INLINE gmt_data_t gmt_alloc_nb(uint64_t num_elems, uint64_t bytes_per_elem,
+                     alloc_type_t alloc_type, const char *array_name)
+{
+    if ((alloc_type & GMT_ALLOC_BLOCK_CYCLIC) == GMT_ALLOC_CUSTOM)
+        ERRORMSG("GMT_ALLOC_CUSTOM arrays are allocated with "
+                 "gmt_alloc_custom() (GMT_ALLOC_PERNODE is not supported)\n");
+    return alloc_nb(num_elems, bytes_per_elem, alloc_type,
+                    config.block_cyclic_elems, 0, array_name);
+}
+
+GMT_INLINE gmt_data_t gmt_alloc_block_cyclic(uint64_t num_elems,
+                     uint64_t bytes_per_elem, uint64_t block_elems,
+                     alloc_type_t alloc_type, const char *array_name)
+{
+    if (block_elems == 0)
+        ERRORMSG("gmt_alloc_block_cyclic() with block_elems 0\n");
+    alloc_type = (alloc_type_t) ((alloc_type & ~GMT_ALLOC_BLOCK_CYCLIC) |
+                                 GMT_ALLOC_BLOCK_CYCLIC);
+    gmt_data_t gmt_array = alloc_nb(num_elems, bytes_per_elem, alloc_type,
+                                    block_elems, 0, array_name);
+    gmt_wait_data();
+    return gmt_array;
+}
+
+GMT_INLINE gmt_data_t gmt_alloc_custom(uint64_t num_elems,
+                     uint64_t bytes_per_elem, uint64_t block_elems,
+                     gmt_dist_t dist, alloc_type_t alloc_type,
+                     const char *array_name)
+{
+    if (block_elems == 0)
+        ERRORMSG("gmt_alloc_custom() with block_elems 0\n");
+    mem_get_dist(dist);
+    alloc_type = (alloc_type_t) ((alloc_type & ~GMT_ALLOC_BLOCK_CYCLIC) |
+                                 GMT_ALLOC_CUSTOM);
+    gmt_data_t gmt_array = alloc_nb(num_elems, bytes_per_elem, alloc_type,
+                                    block_elems, dist, array_name);
+    gmt_wait_data();
+    return gmt_array;
+}
+
+typedef struct register_dist_args_t {
+    gmt_dist_t dist;
+    gmt_dist_funcs_t funcs;
+} register_dist_args_t;
+
+/* function used with GMT execute to install a custom distribution */
+void _register_dist_func(const void *args, uint32_t args_size,
+                         void *ret_buf, uint32_t *ret_size,
+                         gmt_handle_t handle)
+{
+    _unused(args_size);
+    _unused(ret_buf);
+    _unused(ret_size);
+    _unused(handle);
+    const register_dist_args_t *ra = (const register_dist_args_t *) args;
+    _assert(ra->dist < num_nodes * GMT_MAX_DIST_PER_NODE);
+    mem.dists[ra->dist] = ra->funcs;
+}
+
+GMT_INLINE gmt_dist_t gmt_register_dist(const gmt_dist_funcs_t * funcs)
+{
+    if (funcs == NULL || funcs->owner == NULL || funcs->local_block == NULL ||
+        funcs->global_block == NULL || funcs->num_local_blocks == NULL)
+        ERRORMSG("gmt_register_dist() requires all the mapping functions\n");
+
+    uint32_t id = __sync_fetch_and_add(&mem.num_dists, 1);
+    if (id >= GMT_MAX_DIST_PER_NODE)
+        ERRORMSG("maximum number of custom distributions supported "
+                 "reached - GMT_MAX_DIST_PER_NODE %d\n",
+                 GMT_MAX_DIST_PER_NODE);
+
+    register_dist_args_t args;
+    args.dist = node_id * GMT_MAX_DIST_PER_NODE + id;
+    args.funcs = *funcs;
+    gmt_execute_on_all(_register_dist_func, &args, sizeof(args),
+                       GMT_PREEMPTABLE);
+    return args.dist;
+}
+
 GMT_INLINE void gmt_free(gmt_data_t gmt_array)
 {
   if (gmt_array == GMT_DATA_NULL)
@@ -163,13 +252,10 @@ gmt_data_t gmt_attach(const char *name)
 {
     if (name == NULL)
         return GMT_DATA_NULL;
-    uint32_t i;
-    for (i = 0; i < GMT_MAX_ALLOC_PER_NODE; i++) {
-        gentry_t *ga = &mem.gentry[i];
-        if (ga->name != NULL && (strcmp(ga->name, name) == 0))
-            return ga->gmt_array;
-    }
-    return GMT_DATA_NULL;
+    gentry_t *ga = mem_name_lookup(name);
+    if (ga == NULL)
+        return GMT_DATA_NULL;
+    return ga->gmt_array;
 }
 
 GMT_INLINE uint64_t gmt_get_elem_bytes(gmt_data_t gmt_array)
@@ -223,10 +309,13 @@ GMT_INLINE void gmt_memcpy(gmt_data_t g_src, uint64_t g_src_offset,
     mem_check_last_byte(ga_src, g_src_offset + nbytes);
     mem_check_last_byte(ga_dst, g_dst_offset + nbytes);
 
-    /* prepare space for argument of possible remote execution */
+    /* prepare space for argument of possible remote execution, blocked
+     * distributions can have several runs on the same node */
+    uint64_t max_exec = num_nodes - 1;
+    if (ga_src->nbytes_dist_block != 0)
+        max_exec = CEILING(nbytes, ga_src->nbytes_dist_block) + 1;
     memcpy_func_args_t *args =
-        (memcpy_func_args_t *) _malloc((num_nodes - 1) *
-                                       sizeof(memcpy_func_args_t));
+        (memcpy_func_args_t *) _malloc(max_exec * sizeof(memcpy_func_args_t));
 
     //counter of remote executions
     uint32_t cnt = 0;
@@ -242,8 +331,8 @@ GMT_INLINE void gmt_memcpy(gmt_data_t g_src, uint64_t g_src_offset,
         if (mem_gmt_data_is_local
             (ga_src, g_src, g_src_offset_cur, &l_src_offset)) {
 
-            avail_bytes =
-                MIN(nbytes_remaining, ga_src->nbytes_loc - l_src_offset);
+            avail_bytes = mem_local_run_bytes(ga_src, g_src_offset_cur,
+                                              l_src_offset, nbytes_remaining);
             gmt_put_nb(g_dst, g_dst_offset_cur, &ga_src->data[l_src_offset],
                        avail_bytes);
 
@@ -251,8 +340,8 @@ GMT_INLINE void gmt_memcpy(gmt_data_t g_src, uint64_t g_src_offset,
         } else
             if (mem_gmt_data_is_local
                 (ga_dst, g_dst, g_dst_offset_cur, &l_src_offset)) {
-            avail_bytes =
-                MIN(nbytes_remaining, ga_dst->nbytes_loc - l_src_offset);
+            avail_bytes = mem_local_run_bytes(ga_dst, g_dst_offset_cur,
+                                              l_src_offset, nbytes_remaining);
             gmt_get_nb(g_src, g_src_offset_cur, &ga_dst->data[l_src_offset],
                        avail_bytes);
 
@@ -264,12 +353,13 @@ GMT_INLINE void gmt_memcpy(gmt_data_t g_src, uint64_t g_src_offset,
             mem_locate_gmt_data_remote(ga_src, g_src_offset_cur,
                                        &rnode_id, &roffset_bytes);
             if (ga_src != NULL)
-                avail_bytes =
-                    MIN(nbytes_remaining, ga_src->nbytes_block - roffset_bytes);
+                avail_bytes = mem_remote_run_bytes(ga_src, g_src_offset_cur,
+                                                   roffset_bytes,
+                                                   nbytes_remaining);
             else
                 avail_bytes = nbytes_remaining;
 
-            _assert(cnt < num_nodes - 1);
+            _assert(cnt < max_exec);
             args[cnt].g_src = g_src;
             args[cnt].g_dst = g_dst;
             args[cnt].g_src_offset = g_src_offset_cur;
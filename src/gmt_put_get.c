@@ -55,28 +55,110 @@
     gmt_put_nb    
     gmt_put_value_nb
     gmt_get_nb
+    gmt_gather_nb
     
     gmt_put     
     gmt_put_value 
     gmt_get 
+    gmt_gather
     
     gmt_get_local_ptr
     
     gmt_atomic_add_nb
     gmt_atomic_cas_nb
+    gmt_atomic_op_nb
+    gmt_atomic_fadd_nb
     gmt_atomic_add
     gmt_atomic_cas
+    gmt_atomic_op
+    gmt_atomic_fadd
+
+    gmt_atomic_op_nofetch_nb
+    gmt_atomic_add_nofetch_nb
+    gmt_put_value_nofetch_nb
+    gmt_quiet
+
+    gmt_scatter_nb
+    gmt_scatter_add_nb
+    gmt_scatter
+    gmt_scatter_add
     
     gmt_wait_data
     
 
  ************************************************************************/
 
+#if !ENABLE_SINGLE_NODE_ONLY
+/* payloads larger than a communication buffer are not fragmented into 
+ * commands, a single descriptor is sent and the payload follows in its own
+ * message that the remote comm server receives in place */
+static inline bool use_rndv(uint64_t nbytes)
+{
+    return config.rndv_transfers && nbytes > COMM_BUFFER_SIZE;
+}
+
+static inline void cmd_put_rndv(uint32_t tid, uint32_t wid,
+                                uint32_t rnid, gmt_data_t gmt_array,
+                                uint64_t goffset_bytes, const void *data,
+                                uint64_t nbytes)
+{
+    uint64_t offset = 0;
+    while (offset < nbytes) {
+        uint64_t put_bytes = MIN(nbytes - offset, NET_MAX_MSG_BYTES);
+        int tag = network_rndv_tag();
+        comm_server_post_rndv(true, rnid, ((uint8_t *) data) + offset,
+                              put_bytes, tag, tid);
+        cmd_put_rndv_t *cmd = (cmd_put_rndv_t *) agm_get_cmd(rnid, wid,
+                                                   sizeof(cmd_put_rndv_t),
+                                                   0, NULL);
+        cmd->type = GMT_CMD_PUT_RNDV;
+        cmd->gmt_array = gmt_array;
+        cmd->offset = goffset_bytes + offset;
+        cmd->tid = tid;
+        cmd->put_bytes = put_bytes;
+        cmd->tag = tag;
+        uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+        agm_set_cmd_data(rnid, wid, NULL, 0);
+        offset += put_bytes;
+    }
+}
+
+static inline void cmd_mem_put_rndv(uint32_t tid, uint32_t wid,
+                                    uint32_t rnid, uint8_t* address,
+                                    const uint8_t *data,
+                                    uint64_t nbytes)
+{
+    uint64_t offset = 0;
+    while (offset < nbytes) {
+        uint64_t put_bytes = MIN(nbytes - offset, NET_MAX_MSG_BYTES);
+        int tag = network_rndv_tag();
+        comm_server_post_rndv(true, rnid, (uint8_t *) data + offset,
+                              put_bytes, tag, tid);
+        cmd_mem_put_rndv_t *cmd = (cmd_mem_put_rndv_t *) 
+            agm_get_cmd(rnid, wid, sizeof(cmd_mem_put_rndv_t), 0, NULL);
+        cmd->type = GMT_CMD_MEM_PUT_RNDV;
+        cmd->address = address + offset;
+        cmd->tid = tid;
+        cmd->put_bytes = put_bytes;
+        cmd->tag = tag;
+        uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+        agm_set_cmd_data(rnid, wid, NULL, 0);
+        offset += put_bytes;
+    }
+}
+#endif
+
 static inline void cmd_put_data(uint32_t tid, uint32_t wid,
                                 uint32_t rnid, gmt_data_t gmt_array,
                                 uint64_t goffset_bytes, const void *data,
                                 uint64_t nbytes)
 {
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (use_rndv(nbytes)) {
+        cmd_put_rndv(tid, wid, rnid, gmt_array, goffset_bytes, data, nbytes);
+        return;
+    }
+#endif
     uint64_t offset = 0;
     while (offset < nbytes) {
         uint32_t granted_nbytes = 0;
@@ -105,6 +187,12 @@ static inline void cmd_mem_put_data(uint32_t tid, uint32_t wid,
                                     const uint8_t *data,
                                     uint64_t nbytes)
 {
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (use_rndv(nbytes)) {
+        cmd_mem_put_rndv(tid, wid, rnid, address, data, nbytes);
+        return;
+    }
+#endif
     uint64_t offset = 0;
     while (offset < nbytes) {
         uint32_t granted_nbytes = 0;
@@ -168,13 +256,80 @@ static inline void cmd_mem_strided_put_data(uint32_t tid, uint32_t wid,
     }
 }
 
+/* large transfers to partitions attached to the RMA window are done with
+ * one-sided operations that bypass aggregation and helpers, completed by
+ * gmt_wait_data() */
+static inline bool rma_put_data(uint32_t tid, gentry_t * ga, uint32_t rnid,
+                                uint64_t roffset_bytes, const void *data,
+                                uint64_t nbytes)
+{
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (!net.rma_enabled || nbytes < config.rma_threshold)
+        return false;
+    uint64_t raddr = mem_rma_raddr(ga, rnid);
+    if (raddr == 0)
+        return false;
+    network_rma_put(rnid, raddr + roffset_bytes, data, nbytes);
+    uthreads[tid].rma_pending = true;
+    COUNT_EVENT(WORKER_GMT_PUT_RMA);
+    return true;
+#else
+    _unused(tid); _unused(ga); _unused(rnid);
+    _unused(roffset_bytes); _unused(data); _unused(nbytes);
+    return false;
+#endif
+}
+
+static inline bool rma_get_data(uint32_t tid, gentry_t * ga, uint32_t rnid,
+                                uint64_t roffset_bytes, void *data,
+                                uint64_t nbytes)
+{
+#if !ENABLE_SINGLE_NODE_ONLY
+    if (!net.rma_enabled || nbytes < config.rma_threshold)
+        return false;
+    uint64_t raddr = mem_rma_raddr(ga, rnid);
+    if (raddr == 0)
+        return false;
+    network_rma_get(rnid, raddr + roffset_bytes, data, nbytes);
+    uthreads[tid].rma_pending = true;
+    COUNT_EVENT(WORKER_GMT_GET_RMA);
+    return true;
+#else
+    _unused(tid); _unused(ga); _unused(rnid);
+    _unused(roffset_bytes); _unused(data); _unused(nbytes);
+    return false;
+#endif
+}
+
 static inline void cmd_put_value(uint32_t tid, uint32_t wid,
                                  uint32_t rnid, gmt_data_t gmt_array,
                                  uint64_t roffset_bytes, uint64_t value)
 {
     cmd_put_value_t *cmd;
-    cmd = (cmd_put_value_t *) agm_get_cmd(rnid, wid,
-                                          sizeof(cmd_put_value_t), 0, NULL);
+    if (config.agg_combine) {
+        /* a put value still waiting in the block for the same element 
+         * just takes the new value, the task already waits for its ack */
+        COUNT_EVENT(AGGREGATION_COMB_CMDS);
+        cmd = (cmd_put_value_t *) agm_comb_find(rnid, wid,
+                                                gmt_array, roffset_bytes);
+        if (cmd != NULL && cmd->type == GMT_CMD_PUT_VALUE && cmd->tid == tid
+            && cmd->gmt_array == gmt_array && cmd->offset == roffset_bytes) {
+            cmd->value = value;
+            COUNT_EVENT(AGGREGATION_COMB_HITS);
+            return;
+        }
+        cmd = (cmd_put_value_t *) agm_get_comb_cmd(rnid, wid,
+                                                   sizeof(cmd_put_value_t),
+                                                   gmt_array, roffset_bytes);
+    } else if (agm_use_compact(rnid)) {
+        agm_set_c_cmd(rnid, wid, GMT_CMD_PUT_VALUE_C, tid, gmt_array,
+                      roffset_bytes, value, 0);
+        uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+        return;
+    } else
+        cmd = (cmd_put_value_t *) agm_get_cmd(rnid, wid,
+                                              sizeof(cmd_put_value_t), 0,
+                                              NULL);
     cmd->gmt_array = gmt_array;
     cmd->offset = roffset_bytes;
     cmd->tid = tid;
@@ -229,7 +384,8 @@ GMT_INLINE void gmt_put_nb(gmt_data_t gmt_array, uint64_t elem_offset,
         if (mem_gmt_data_is_local(ga, gmt_array, goffset_cur, &loffset)) {
             _assert(ga != NULL);
             //_DEBUG("local %ld - %ld\n", goffset_cur, goffset_end);
-            avail_bytes = MIN(rest_bytes, ga->nbytes_loc - loffset);
+            avail_bytes = mem_local_run_bytes(ga, goffset_cur, loffset,
+                                              rest_bytes);
             _assert(avail_bytes > 0 && ga->data != NULL);
             mem_put(&ga->data[loffset], data_cur, avail_bytes);
             COUNT_EVENT(WORKER_GMT_PUT_LOCAL);
@@ -244,7 +400,8 @@ GMT_INLINE void gmt_put_nb(gmt_data_t gmt_array, uint64_t elem_offset,
             mem_locate_gmt_data_remote(ga, goffset_cur, &rnid,
                                        &roffset);
             if (ga != NULL)
-                avail_bytes = MIN(rest_bytes, ga->nbytes_block - roffset);
+                avail_bytes = mem_remote_run_bytes(ga, goffset_cur, roffset,
+                                                   rest_bytes);
             else
                 avail_bytes = rest_bytes;
             _assert(avail_bytes > 0);
@@ -259,7 +416,8 @@ GMT_INLINE void gmt_put_nb(gmt_data_t gmt_array, uint64_t elem_offset,
                 cmd_put_value(tid, wid, rnid, gmt_array, roffset,
                               *(uint64_t *) (data_cur));
 
-            else
+            else if (!rma_put_data(tid, ga, rnid, roffset, data_cur,
+                                   avail_bytes))
                 cmd_put_data(tid, wid, rnid, gmt_array, roffset,
                              data_cur, avail_bytes);
 
@@ -379,7 +537,8 @@ GMT_INLINE void gmt_get_nb(gmt_data_t gmt_array, uint64_t elem_offset,
 
         int64_t loffset;
         if (mem_gmt_data_is_local(ga, gmt_array, goffset_cur, &loffset)) {
-            avail_bytes = MIN(rest_bytes, ga->nbytes_loc - loffset);
+            avail_bytes = mem_local_run_bytes(ga, goffset_cur, loffset,
+                                              rest_bytes);
             uint8_t *ptr = mem_get_loc_ptr(ga, loffset, avail_bytes);
             //_DEBUG("ptr %p - avail_bytes %ld\n", ptr, avail_bytes);
             memcpy(data_cur, ptr, avail_bytes);
@@ -395,10 +554,17 @@ GMT_INLINE void gmt_get_nb(gmt_data_t gmt_array, uint64_t elem_offset,
             mem_locate_gmt_data_remote(ga, goffset_cur, &rnid,
                                        &roffset_bytes);
             if (ga != NULL)
-                avail_bytes = MIN(rest_bytes, ga->nbytes_block - roffset_bytes);
+                avail_bytes = mem_remote_run_bytes(ga, goffset_cur,
+                                                   roffset_bytes, rest_bytes);
             else
                 avail_bytes = rest_bytes;
             _assert(avail_bytes > 0);
+            if (rma_get_data(tid, ga, rnid, roffset_bytes, data_cur,
+                             avail_bytes)) {
+                goffset_cur += avail_bytes;
+                data_cur += avail_bytes;
+                continue;
+            }
             cmd_get_t *cmd = (cmd_get_t *) agm_get_cmd(rnid, wid,
                                                        sizeof(cmd_get_t),
                                                        0, NULL);
@@ -418,6 +584,47 @@ GMT_INLINE void gmt_get_nb(gmt_data_t gmt_array, uint64_t elem_offset,
     }
 }
 
+GMT_INLINE void gmt_gather_nb(gmt_data_t gmt_array,
+                              const uint64_t * elem_offsets,
+                              uint64_t num_elem, void *data)
+{
+    _assert(data != NULL || num_elem == 0);
+
+    gentry_t *const ga = mem_get_gentry(gmt_array);
+    uint64_t nbytes_elem = ga->nbytes_elem;
+    /* elements too large for a reply are fetched with plain gets */
+    bool gather = REPLY_GATHER_MAX(nbytes_elem) > 0;
+    uint8_t *data_cur = (uint8_t *) data;
+    uint32_t wid = GMT_TO_INITIALIZE, tid = GMT_TO_INITIALIZE;
+    uint64_t i;
+    for (i = 0; i < num_elem; i++, data_cur += nbytes_elem) {
+        uint64_t goffset_bytes = elem_offsets[i] * nbytes_elem;
+        mem_check_last_byte(ga, goffset_bytes + nbytes_elem);
+
+        int64_t loffset;
+        if (mem_gmt_data_is_local(ga, gmt_array, goffset_bytes, &loffset)) {
+            uint8_t *ptr = mem_get_loc_ptr(ga, loffset, nbytes_elem);
+            memcpy(data_cur, ptr, nbytes_elem);
+            COUNT_EVENT(WORKER_GMT_GET_LOCAL);
+        } else if (!gather) {
+            gmt_get_nb(gmt_array, elem_offsets[i], data_cur, 1);
+        } else {
+            if (wid == GMT_TO_INITIALIZE) {
+                tid = uthread_get_tid();
+                wid = uthread_get_wid(tid);
+            }
+            uint32_t rnid = 0;
+            uint64_t roffset_bytes = 0;
+            mem_locate_gmt_data_remote(ga, goffset_bytes, &rnid,
+                                       &roffset_bytes);
+            agm_set_gather_ent(rnid, wid, tid, gmt_array, roffset_bytes,
+                               data_cur, nbytes_elem);
+            uthread_incr_req_nbytes(tid, nbytes_elem);
+            COUNT_EVENT(WORKER_GMT_GATHER_REMOTE);
+        }
+    }
+}
+
 GMT_INLINE void gmt_mem_get_nb(uint32_t rnid, uint8_t* data,
                                const uint8_t* raddress, uint64_t nbytes)
 {
@@ -448,8 +655,33 @@ INLINE void _atomic_add_remote(uint32_t tid, uint32_t wid,
                                int64_t * ret_value_ptr)
 {
     cmd_atomic_add_t *cmd;
-    cmd = (cmd_atomic_add_t *) agm_get_cmd(rnid, wid,
-                                           sizeof(cmd_atomic_add_t), 0, NULL);
+    if (config.agg_combine && ret_value_ptr == NULL) {
+        /* non-fetching adds to the same element are summed */
+        COUNT_EVENT(AGGREGATION_COMB_CMDS);
+        cmd = (cmd_atomic_add_t *) agm_comb_find(rnid, wid,
+                                                 gmt_array, roffset_bytes);
+        if (cmd != NULL && cmd->type == GMT_CMD_ATOMIC_ADD && cmd->tid == tid
+            && cmd->ret_value_ptr == 0 && cmd->gmt_array == gmt_array
+            && cmd->offset == roffset_bytes) {
+            cmd->value += value;
+            COUNT_EVENT(AGGREGATION_COMB_HITS);
+            return;
+        }
+        cmd = (cmd_atomic_add_t *) agm_get_comb_cmd(rnid, wid,
+                                                    sizeof(cmd_atomic_add_t),
+                                                    gmt_array, roffset_bytes);
+    } else if (agm_use_compact(rnid)) {
+        _assert( (uint64_t) ret_value_ptr >> VIRT_ADDR_PTR_BITS == 0);
+        agm_set_c_cmd(rnid, wid, ret_value_ptr == NULL ?
+                      GMT_CMD_ATOMIC_ADD_C : GMT_CMD_ATOMIC_ADD_RET_C,
+                      tid, gmt_array, roffset_bytes, cmd_zigzag(value),
+                      (uint64_t) ret_value_ptr);
+        uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+        return;
+    } else
+        cmd = (cmd_atomic_add_t *) agm_get_cmd(rnid, wid,
+                                               sizeof(cmd_atomic_add_t), 0,
+                                               NULL);
 
     cmd->gmt_array = gmt_array;
     cmd->offset = roffset_bytes;
@@ -494,6 +726,283 @@ GMT_INLINE void gmt_atomic_add_nb(gmt_data_t gmt_array, uint64_t elem_offset,
     }
 }
 
+INLINE void _atomic_op_remote(uint32_t tid, uint32_t wid,
+                              uint32_t rnid, gmt_data_t gmt_array,
+                              uint64_t roffset_bytes, atomic_op_t op,
+                              int64_t value, int64_t * ret_value_ptr)
+{
+    cmd_atomic_op_t *cmd;
+    cmd = (cmd_atomic_op_t *) agm_get_cmd(rnid, wid,
+                                          sizeof(cmd_atomic_op_t), 0, NULL);
+
+    cmd->gmt_array = gmt_array;
+    cmd->offset = roffset_bytes;
+    _assert((uint64_t) ret_value_ptr >> VIRT_ADDR_PTR_BITS == 0);
+    cmd->ret_value_ptr = (uint64_t) ret_value_ptr;
+    cmd->tid = tid;
+    cmd->type = GMT_CMD_ATOMIC_OP;
+    cmd->op = (uint8_t) op;
+    cmd->value = value;
+
+    uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+    agm_set_cmd_data(rnid, wid, NULL, 0);
+}
+
+GMT_INLINE void gmt_atomic_op_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                                 atomic_op_t op, int64_t value,
+                                 int64_t * ret_value_ptr)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_REPLICATE)
+        ERRORMSG("DATA ALLOCATED WITH GMT_ALLOC_REPLICATE OPERATION NOT VALID");
+
+    int64_t loffset;
+    gentry_t *const ga = mem_get_gentry(gmt_array);
+    mem_check_word_elem_size(ga);
+    uint64_t size = ga->nbytes_elem;
+    if (op == GMT_ATOMIC_FADD && size != sizeof(double) &&
+        size != sizeof(float))
+        ERRORMSG("GMT_ATOMIC_FADD NEEDS ELEMENTS OF 8 OR 4 BYTES");
+    uint64_t goffset_bytes = elem_offset * size;
+    mem_check_last_byte(ga, goffset_bytes + size);
+    if (mem_gmt_data_is_local(ga, gmt_array, goffset_bytes, &loffset)) {
+        COUNT_EVENT(WORKER_GMT_ATOMIC_OP_LOCAL);
+        uint8_t *ptr = mem_get_loc_ptr(ga, loffset, size);
+        int64_t ret = mem_atomic_op(ptr, op, value, size);
+        if (ret_value_ptr != NULL)
+            *ret_value_ptr = ret;
+    } else {
+        uint32_t rnid = 0;
+        uint64_t roffset_bytes = 0;
+        uint32_t tid = uthread_get_tid();
+        uint32_t wid = uthread_get_wid(tid);
+        mem_locate_gmt_data_remote(ga, goffset_bytes, &rnid,
+                                   &roffset_bytes);
+        _atomic_op_remote(tid, wid, rnid, gmt_array, roffset_bytes, op,
+                          value, ret_value_ptr);
+        COUNT_EVENT(WORKER_GMT_ATOMIC_OP_REMOTE);
+    }
+}
+
+/* the old value comes back as the bits of a double, which ret_value_ptr 
+ * receives untouched */
+GMT_INLINE void gmt_atomic_fadd_nb(gmt_data_t gmt_array, uint64_t elem_offset,
+                                   double value, double *ret_value_ptr)
+{
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    gmt_atomic_op_nb(gmt_array, elem_offset, GMT_ATOMIC_FADD, bits,
+                     (int64_t *) ret_value_ptr);
+}
+
+/* non-fetching adds and puts to the same element are merged while the
+ * command is in the open block, a merged op is not counted again */
+INLINE void _atomic_op_nf_remote(uint32_t tid, uint32_t wid,
+                                 uint32_t rnid, gmt_data_t gmt_array,
+                                 uint64_t roffset_bytes, atomic_op_t op,
+                                 int64_t value)
+{
+    cmd_atomic_op_nf_t *cmd;
+    if (config.agg_combine && (op == GMT_ATOMIC_ADD ||
+                               op == GMT_ATOMIC_SWAP)) {
+        COUNT_EVENT(AGGREGATION_COMB_CMDS);
+        cmd = (cmd_atomic_op_nf_t *) agm_comb_find(rnid, wid,
+                                                   gmt_array, roffset_bytes);
+        if (cmd != NULL && cmd->type == GMT_CMD_ATOMIC_OP_NF &&
+            cmd->op == op && cmd->gmt_array == gmt_array &&
+            cmd->offset == roffset_bytes) {
+            cmd->value = (op == GMT_ATOMIC_ADD) ? cmd->value + value : value;
+            COUNT_EVENT(AGGREGATION_COMB_HITS);
+            return;
+        }
+        cmd = (cmd_atomic_op_nf_t *) agm_get_comb_cmd(rnid, wid,
+                                                      sizeof(*cmd),
+                                                      gmt_array,
+                                                      roffset_bytes);
+    } else
+        cmd = (cmd_atomic_op_nf_t *) agm_get_cmd(rnid, wid, sizeof(*cmd),
+                                                 0, NULL);
+
+    cmd->gmt_array = gmt_array;
+    cmd->offset = roffset_bytes;
+    cmd->type = GMT_CMD_ATOMIC_OP_NF;
+    cmd->op = (uint8_t) op;
+    cmd->value = value;
+
+    workers[wid].nf_issued[rnid]++;
+    uthreads[tid].nofetch_pending = true;
+    agm_set_cmd_data(rnid, wid, NULL, 0);
+}
+
+GMT_INLINE void gmt_atomic_op_nofetch_nb(gmt_data_t gmt_array,
+                                         uint64_t elem_offset,
+                                         atomic_op_t op, int64_t value)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_REPLICATE)
+        ERRORMSG("DATA ALLOCATED WITH GMT_ALLOC_REPLICATE OPERATION NOT VALID");
+
+    int64_t loffset;
+    gentry_t *const ga = mem_get_gentry(gmt_array);
+    mem_check_word_elem_size(ga);
+    uint64_t size = ga->nbytes_elem;
+    if (op == GMT_ATOMIC_FADD && size != sizeof(double) &&
+        size != sizeof(float))
+        ERRORMSG("GMT_ATOMIC_FADD NEEDS ELEMENTS OF 8 OR 4 BYTES");
+    uint64_t goffset_bytes = elem_offset * size;
+    mem_check_last_byte(ga, goffset_bytes + size);
+    if (mem_gmt_data_is_local(ga, gmt_array, goffset_bytes, &loffset)) {
+        COUNT_EVENT(WORKER_GMT_ATOMIC_OP_LOCAL);
+        mem_atomic_op(mem_get_loc_ptr(ga, loffset, size), op, value, size);
+    } else {
+        uint32_t rnid = 0;
+        uint64_t roffset_bytes = 0;
+        uint32_t tid = uthread_get_tid();
+        uint32_t wid = uthread_get_wid(tid);
+        mem_locate_gmt_data_remote(ga, goffset_bytes, &rnid,
+                                   &roffset_bytes);
+        _atomic_op_nf_remote(tid, wid, rnid, gmt_array, roffset_bytes, op,
+                             value);
+        COUNT_EVENT(WORKER_GMT_ATOMIC_NOFETCH_REMOTE);
+    }
+}
+
+GMT_INLINE void gmt_atomic_add_nofetch_nb(gmt_data_t gmt_array,
+                                          uint64_t elem_offset, int64_t value)
+{
+    gmt_atomic_op_nofetch_nb(gmt_array, elem_offset, GMT_ATOMIC_ADD, value);
+}
+
+GMT_INLINE void gmt_put_value_nofetch_nb(gmt_data_t gmt_array,
+                                         uint64_t elem_offset, uint64_t value)
+{
+    gmt_atomic_op_nofetch_nb(gmt_array, elem_offset, GMT_ATOMIC_SWAP,
+                             (int64_t) value);
+}
+
+/* nodes queried together by _quiet(), each against its own count of issued
+ * operations taken at the start */
+#define QUIET_WINDOW 64
+
+/* waits for the non-fetching operations issued by this node, every node not
+ * confirmed up to the count issued to it is queried, and queried again only
+ * if some of them were still in flight when the query was served */
+INLINE void _quiet(uint32_t tid, uint32_t wid)
+{
+    uthreads[tid].nofetch_pending = false;
+    uint64_t issued[QUIET_WINDOW];
+    uint32_t start;
+    for (start = 0; start < num_nodes; start += QUIET_WINDOW) {
+        uint32_t end = MIN(start + QUIET_WINDOW, num_nodes);
+        uint32_t n, w;
+        for (n = start; n < end; n++) {
+            issued[n - start] = 0;
+            for (w = 0; w < NUM_WORKERS; w++)
+                issued[n - start] += workers[w].nf_issued[n];
+        }
+        bool done = false;
+        while (!done) {
+            done = true;
+            for (n = start; n < end; n++) {
+                if (workers_nf_confirmed[n] >= issued[n - start])
+                    continue;
+                done = false;
+                cmd_quiet_t *cmd;
+                cmd = (cmd_quiet_t *) agm_get_cmd(n, wid, sizeof(cmd_quiet_t),
+                                                  0, NULL);
+                cmd->type = GMT_CMD_QUIET;
+                cmd->tid = tid;
+                uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+                agm_set_cmd_data(n, wid, NULL, 0);
+                COUNT_EVENT(WORKER_GMT_QUIET_QUERIES);
+            }
+            if (!done)
+                worker_wait_data(tid, wid);
+        }
+    }
+}
+
+/* puts (SCATTER_OP_PUT) or atomic adds (SCATTER_OP_ADD) values[i] to the
+ * elements elem_offsets[i] of gmt_array, remote elements of the same node are
+ * packed into GMT_CMD_SCATTER commands. The value of a put is nbytes_elem
+ * bytes long, the one of an add is an int64_t */
+INLINE void _scatter(gmt_data_t gmt_array, uint8_t op,
+                     const uint64_t * elem_offsets, const uint8_t * values,
+                     uint64_t num_elem)
+{
+    _assert(values != NULL || num_elem == 0);
+
+    gentry_t *const ga = mem_get_gentry(gmt_array);
+    uint64_t nbytes_elem = ga->nbytes_elem;
+    uint32_t val_bytes = (op == SCATTER_OP_ADD) ? sizeof(int64_t)
+        : nbytes_elem;
+    if (op == SCATTER_OP_ADD)
+        mem_check_word_elem_size(ga);
+
+    /* replicas and entries too large for a block use the single element
+     * operations */
+    bool scatter = GD_GET_TYPE_DISTR(gmt_array) != GMT_ALLOC_REPLICATE &&
+        sizeof(cmd_route_t) + sizeof(cmd_scatter_t) + sizeof(uint64_t) +
+        val_bytes <= CMD_BLOCK_SIZE;
+    const uint8_t *val_cur = values;
+    uint32_t wid = GMT_TO_INITIALIZE, tid = GMT_TO_INITIALIZE;
+    uint64_t i;
+    for (i = 0; i < num_elem; i++, val_cur += val_bytes) {
+        if (!scatter) {
+            if (op == SCATTER_OP_ADD)
+                gmt_atomic_add_nb(gmt_array, elem_offsets[i],
+                                  *(const int64_t *) val_cur, NULL);
+            else
+                gmt_put_nb(gmt_array, elem_offsets[i], val_cur, 1);
+            continue;
+        }
+
+        uint64_t goffset_bytes = elem_offsets[i] * nbytes_elem;
+        mem_check_last_byte(ga, goffset_bytes + nbytes_elem);
+
+        int64_t loffset;
+        if (mem_gmt_data_is_local(ga, gmt_array, goffset_bytes, &loffset)) {
+            uint8_t *ptr = mem_get_loc_ptr(ga, loffset, nbytes_elem);
+            if (op == SCATTER_OP_ADD) {
+                mem_atomic_add(ptr, *(const int64_t *) val_cur, nbytes_elem);
+                COUNT_EVENT(WORKER_GMT_ATOMIC_ADD_LOCAL);
+            } else {
+                memcpy(ptr, val_cur, nbytes_elem);
+                COUNT_EVENT(WORKER_GMT_PUT_LOCAL);
+            }
+        } else {
+            if (wid == GMT_TO_INITIALIZE) {
+                tid = uthread_get_tid();
+                wid = uthread_get_wid(tid);
+            }
+            uint32_t rnid = 0;
+            uint64_t roffset_bytes = 0;
+            mem_locate_gmt_data_remote(ga, goffset_bytes, &rnid,
+                                       &roffset_bytes);
+            agm_set_scatter_ent(rnid, wid, tid, gmt_array, op, roffset_bytes,
+                                val_cur, val_bytes);
+            uthread_incr_req_nbytes(tid, sizeof(uint64_t));
+            COUNT_EVENT(WORKER_GMT_SCATTER_REMOTE);
+        }
+    }
+}
+
+GMT_INLINE void gmt_scatter_nb(gmt_data_t gmt_array,
+                               const uint64_t * elem_offsets,
+                               const void *values, uint64_t num_elem)
+{
+    _scatter(gmt_array, SCATTER_OP_PUT, elem_offsets,
+             (const uint8_t *) values, num_elem);
+}
+
+GMT_INLINE void gmt_scatter_add_nb(gmt_data_t gmt_array,
+                                   const uint64_t * elem_offsets,
+                                   const int64_t * values, uint64_t num_elem)
+{
+    if (GD_GET_TYPE_DISTR(gmt_array) == GMT_ALLOC_REPLICATE)
+        ERRORMSG("DATA ALLOCATED WITH GMT_ALLOC_REPLICATE OPERATION NOT VALID");
+    _scatter(gmt_array, SCATTER_OP_ADD, elem_offsets,
+             (const uint8_t *) values, num_elem);
+}
+
 INLINE void _atomic_cas_remote(uint32_t tid, uint32_t wid,
                                uint32_t rnid, gmt_data_t gmt_array,
                                uint64_t roffset_bytes,
@@ -562,9 +1071,18 @@ GMT_INLINE void gmt_wait_data()
 {
     uint32_t tid = uthread_get_tid();
     uint32_t wid = uthread_get_wid(tid);
+    if (uthreads[tid].nofetch_pending)
+        _quiet(tid, wid);
     worker_wait_data(tid, wid);
 }
 
+GMT_INLINE void gmt_quiet()
+{
+    uint32_t tid = uthread_get_tid();
+    uint32_t wid = uthread_get_wid(tid);
+    _quiet(tid, wid);
+}
+
 GMT_INLINE void gmt_get(gmt_data_t gmt_array, uint64_t goffset_bytes,
              void *data, uint64_t num_bytes)
 {
@@ -572,6 +1090,30 @@ GMT_INLINE void gmt_get(gmt_data_t gmt_array, uint64_t goffset_bytes,
     gmt_wait_data();
 }
 
+GMT_INLINE void gmt_gather(gmt_data_t gmt_array,
+                           const uint64_t * elem_offsets,
+                           uint64_t num_elem, void *data)
+{
+    gmt_gather_nb(gmt_array, elem_offsets, num_elem, data);
+    gmt_wait_data();
+}
+
+GMT_INLINE void gmt_scatter(gmt_data_t gmt_array,
+                            const uint64_t * elem_offsets,
+                            const void *values, uint64_t num_elem)
+{
+    gmt_scatter_nb(gmt_array, elem_offsets, values, num_elem);
+    gmt_wait_data();
+}
+
+GMT_INLINE void gmt_scatter_add(gmt_data_t gmt_array,
+                                const uint64_t * elem_offsets,
+                                const int64_t * values, uint64_t num_elem)
+{
+    gmt_scatter_add_nb(gmt_array, elem_offsets, values, num_elem);
+    gmt_wait_data();
+}
+
 GMT_INLINE void gmt_put_value(gmt_data_t gmt_array, uint64_t goffset_bytes,
                    uint64_t value)
 {
@@ -629,11 +1171,29 @@ GMT_INLINE int64_t gmt_atomic_add(gmt_data_t gmt_array, uint64_t elem_offset,
     return ret_value;
 }
 
+GMT_INLINE int64_t gmt_atomic_op(gmt_data_t gmt_array, uint64_t elem_offset,
+                                 atomic_op_t op, int64_t value)
+{
+    int64_t ret_value;
+    gmt_atomic_op_nb(gmt_array, elem_offset, op, value, &ret_value);
+    gmt_wait_data();
+    return ret_value;
+}
+
+GMT_INLINE double gmt_atomic_fadd(gmt_data_t gmt_array, uint64_t elem_offset,
+                                  double value)
+{
+    double ret_value;
+    gmt_atomic_fadd_nb(gmt_array, elem_offset, value, &ret_value);
+    gmt_wait_data();
+    return ret_value;
+}
+
 GMT_INLINE uint64_t gmt_count_local_elements(gmt_data_t gmt_array) {
   gentry_t *const ga = mem_get_gentry(gmt_array);
   uint64_t nbytes_loc, nbytes_block, goffset_bytes;
   block_partition(node_id, ga->nbytes_tot/ga->nbytes_elem,
-        ga->nbytes_elem, gmt_array,
+        ga->nbytes_elem, gmt_array, ga->nbytes_dist_block, ga->dist_id,
         &nbytes_loc, &nbytes_block, &goffset_bytes);
   return nbytes_loc/ga->nbytes_elem;
 }
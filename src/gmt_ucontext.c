@@ -102,7 +102,8 @@ void gmt_getcontext(ucontext_t *ucp) {
         "xorl    %%eax, %%eax\n"
         :
         : "r"(ucp)
-        : "rcx");
+        /* callers may keep values in rax across the call (-fipa-ra) */
+        : "rcx", "rax", "memory");
 }
 
 void gmt_swapcontext(ucontext_t *oucp, const ucontext_t *ucp) {
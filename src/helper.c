@@ -52,6 +52,8 @@ void helper_team_stop()
   while (helper_stop_flag) ;
   helper_stop_flag = true;
   uint32_t h;
+  for (h = 0; h < NUM_HELPERS; h++)
+    idle_wake(&cs.recv_idle[h]);
   for (h = 0; h < NUM_HELPERS; h++)
     pthread_join(helpers[h].pthread, NULL);
 
@@ -61,9 +63,46 @@ void helper_team_stop()
 #endif
 }
 
+/* adaptive version of the timeouts, each node of the partition has its own
+ * deadline driven by its traffic and by the uthreads waiting for replies */
+INLINE uint64_t helper_check_adaptive_timeout(uint32_t hid, uint64_t old_tick)
+{
+#if ENABLE_AGGREGATION
+  uint64_t tick = rdtsc();
+  if (tick - old_tick > config.agg_min_deadline) {
+    uint32_t live = 0, waiting = 0;
+    uint32_t i;
+    for (i = 0; i < NUM_WORKERS; i++) {
+      live += uthread_queue_size(&workers[i].uthread_queue);
+      waiting += workers[i].num_waiting;
+    }
+
+    for (i = helpers[hid].part_start_node_id;
+        i < helpers[hid].part_end_node_id; i++) {
+      if (i == node_id)
+        continue;
+      agm_adapt_deadline(i, tick, live, waiting);
+      if (tick - agms[i].tick > agms[i].deadline) {
+        agm_aggregate_and_send(i, hid + NUM_WORKERS, true);
+        agms[i].tick = tick;
+      }
+    }
+    old_tick = tick;
+  }
+  return old_tick;
+#else
+  _unused(hid);
+  _unused(old_tick);
+  return 0;
+#endif
+}
+
 INLINE uint64_t helper_check_aggreg_timeout(uint32_t hid, uint64_t old_tick)
 {
 #if ENABLE_AGGREGATION
+  if (config.agg_min_deadline != 0)
+    return helper_check_adaptive_timeout(hid, old_tick);
+
   uint32_t i;
   uint64_t tick = rdtsc();
   if (tick - old_tick > helpers[hid].aggr_timeout_interval) {
@@ -103,7 +142,17 @@ void helper_team_init()
   uint32_t i;
   for (i = 0; i < NUM_HELPERS; i++) {
     helpers[i].aggr_timeout_interval = config.node_agg_check_interv;
-    netbuffer_init(&helpers[i].tmp_buff, 0, NULL);
+    backoff_init(&helpers[i].backoff);
+    helpers[i].nf_applied =
+      (volatile uint64_t *)_calloc(num_nodes, sizeof(uint64_t));
+    netbuffer_init(&helpers[i].tmp_buff, 0, NULL, COMM_BUFFER_SIZE,
+                   NET_DATA_TAG);
+#if !ENABLE_HELPER_BUFF_COPY
+    helpers[i].in_place = NULL;
+    uint32_t c;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++)
+      helpers[i].spare_data[c] = (uint8_t *)_malloc(cs.class_size[c]);
+#endif
 #if NO_RESERVE
     helpers[i].pending = new std::queue<mtask_t *>();
 #endif
@@ -127,6 +176,12 @@ void helper_team_destroy()
     delete helpers[i].pending;
 #endif
     netbuffer_destroy(&helpers[i].tmp_buff);
+    free((void *)helpers[i].nf_applied);
+#if !ENABLE_HELPER_BUFF_COPY
+    uint32_t c;
+    for (c = 0; c < NUM_BUFF_CLASSES; c++)
+      free(helpers[i].spare_data[c]);
+#endif
   }
 
 #if TRACE_QUEUES
@@ -247,6 +302,9 @@ INLINE void helper_enqueue_mtask(cmd_gen_t * gcmd, mtask_type_t type,
 #else
 	while(pending || !(mt = dta_mtask_alloc(&dtam.h_alloc[hid]))) {
 #endif
+#if !NO_RESERVE && !ENABLE_HELPER_BUFF_COPY
+    helper_release_recv_buff(hid);
+#endif
 #if NO_RESERVE
 		mt = helper_alloc_pending();
 		pending = true;
@@ -311,11 +369,60 @@ INLINE uint32_t helper_mtasks_reserve(uint32_t n, uint32_t hid) {
 INLINE void helper_send_rep_ack(uint32_t rnid, uint32_t hid, uint32_t tid)
 {
   cmd32_t *c;
-  c = (cmd32_t *) agm_get_cmd(rnid, hid + NUM_WORKERS,
-      sizeof(cmd32_t), 0, NULL);
+  c = (cmd32_t *) agm_get_ctrl_cmd(rnid, hid + NUM_WORKERS, sizeof(cmd32_t));
   c->type = GMT_CMD_REPLY_ACK;
   c->value = tid;
-  agm_set_cmd_data(rnid, hid + NUM_WORKERS, NULL, 0);
+}
+
+/* send the acknowledgements pending in ab, a single plain ack goes out as
+   GMT_CMD_REPLY_ACK which is smaller than a batch of one */
+INLINE void helper_flush_rep_acks(ack_batch_t * ab, uint32_t hid)
+{
+  if (ab->num_acks == 0)
+    return;
+  if (ab->num_acks == 1 && ab->acks[0].nbytes == sizeof(uint64_t)) {
+    helper_send_rep_ack(ab->rnid, hid, ab->acks[0].tid);
+  } else {
+    uint32_t acks_bytes = ab->num_acks * sizeof(rep_ack_t);
+    cmd_rep_ack_batch_t *c;
+    c = (cmd_rep_ack_batch_t *) agm_get_ctrl_cmd(ab->rnid, hid + NUM_WORKERS,
+        sizeof(cmd_rep_ack_batch_t) + acks_bytes);
+    c->type = GMT_CMD_REPLY_ACK_BATCH;
+    c->num_acks = ab->num_acks;
+    memcpy(c + 1, ab->acks, acks_bytes);
+  }
+  ab->num_acks = 0;
+}
+
+/* credit nbytes of acknowledgements to tid on node rnid, acks for the same
+   uthread are merged in a single entry */
+INLINE void helper_add_rep_ack_bytes(ack_batch_t * ab, uint32_t rnid,
+    uint32_t hid, uint32_t tid, uint32_t nbytes)
+{
+  if (ab->rnid != rnid) {
+    helper_flush_rep_acks(ab, hid);
+    ab->rnid = rnid;
+  }
+  uint32_t i;
+  for (i = 0; i < ab->num_acks; i++) {
+    if (ab->acks[i].tid == tid) {
+      ab->acks[i].nbytes += nbytes;
+      COUNT_EVENT(HELPER_ACKS_COALESCED);
+      return;
+    }
+  }
+  if (ab->num_acks == REPLY_ACK_BATCH_MAX)
+    helper_flush_rep_acks(ab, hid);
+  ab->acks[ab->num_acks].tid = tid;
+  ab->acks[ab->num_acks].nbytes = nbytes;
+  ab->num_acks++;
+}
+
+/* credit one acknowledgement to tid on node rnid */
+INLINE void helper_add_rep_ack(ack_batch_t * ab, uint32_t rnid,
+    uint32_t hid, uint32_t tid)
+{
+  helper_add_rep_ack_bytes(ab, rnid, hid, tid, sizeof(uint64_t));
 }
 
 INLINE void helper_send_rep_value(uint32_t rnid,
@@ -324,48 +431,110 @@ INLINE void helper_send_rep_value(uint32_t rnid,
     uint64_t ret_value_ptr, uint64_t value)
 {
   cmd_rep_value_t *c;
-  c = (cmd_rep_value_t *) agm_get_cmd(rnid,
+  c = (cmd_rep_value_t *) agm_get_ctrl_cmd(rnid,
       hid + NUM_WORKERS,
-      sizeof(cmd_rep_value_t), 0, NULL);
+      sizeof(cmd_rep_value_t));
   c->type = GMT_CMD_REPLY_VALUE;
   c->tid = tid;
   c->ret_value_ptr = ret_value_ptr;
   c->value = value;
-  agm_set_cmd_data(rnid, hid + NUM_WORKERS, NULL, 0);
 }
 
-INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
+/* answers the pending quiet queries with the number of non-fetching ops
+   applied so far from their node, counted by all the helpers */
+INLINE void helper_flush_rep_quiet(quiet_batch_t * qb, uint32_t hid)
 {
-  net_buffer_t *recv_buff = comm_server_pop_recv_buff(hid);
-  if (recv_buff == NULL) {
-#if TRACE_QUEUES
-	helpers[hid].rpop_misses++;
-#endif
-    sched_yield();
+  if (qb->num_tids == 0)
     return;
+  uint64_t applied = 0;
+  uint32_t h;
+  for (h = 0; h < NUM_HELPERS; h++)
+    applied += helpers[h].nf_applied[qb->rnid];
+  uint32_t tids_bytes = qb->num_tids * sizeof(uint32_t);
+  cmd_rep_quiet_t *c;
+  c = (cmd_rep_quiet_t *) agm_get_ctrl_cmd(qb->rnid, hid + NUM_WORKERS,
+      sizeof(cmd_rep_quiet_t) + tids_bytes);
+  c->type = GMT_CMD_REPLY_QUIET;
+  c->num_tids = qb->num_tids;
+  c->applied = applied;
+  memcpy(c + 1, qb->tids, tids_bytes);
+  qb->num_tids = 0;
+}
+
+INLINE void helper_add_rep_quiet(quiet_batch_t * qb, uint32_t rnid,
+    uint32_t hid, uint32_t tid)
+{
+  if (qb->rnid != rnid || qb->num_tids == REPLY_QUIET_BATCH_MAX) {
+    helper_flush_rep_quiet(qb, hid);
+    qb->rnid = rnid;
   }
-#if TRACE_QUEUES
-  helpers[hid].rpop_hits++;
-#endif
+  qb->tids[qb->num_tids++] = tid;
+}
 
-#if ENABLE_HELPER_BUFF_COPY
-  net_buffer_t *buff = &helpers[hid].tmp_buff;
-  buff->num_bytes = recv_buff->num_bytes;
-  buff->rnode_id = recv_buff->rnode_id;
-  memcpy(buff->data, recv_buff->data, recv_buff->num_bytes);
-  comm_server_push_recv_buff(hid);
-#else
-  net_buffer_t *buff = recv_buff;
-#endif
+/* Decode loop for a run of compact commands, returns the end of the run.
+   The commands of a run mostly hit the same array, so its gentry is looked
+   up only when the array changes */
+INLINE uint8_t *helper_process_compact(uint8_t * cmds_ptr,
+    uint8_t * cmds_ptr_end, cmd_c_state_t * st, uint32_t rnid, uint32_t hid,
+    ack_batch_t * ab)
+{
+  gentry_t *g = NULL;
+  gmt_data_t gmt_array = st->gmt_array;
+  while (cmds_ptr < cmds_ptr_end) {
+    uint8_t type = ((cmd_c_t *) cmds_ptr)->type;
+    if (type != GMT_CMD_PUT_VALUE_C && type != GMT_CMD_ATOMIC_ADD_C &&
+        type != GMT_CMD_ATOMIC_ADD_RET_C)
+      break;
+    uint64_t value, ret_value_ptr;
+    cmd_c_decode(&cmds_ptr, st, &value, &ret_value_ptr);
+    if (g == NULL || st->gmt_array != gmt_array) {
+      gmt_array = st->gmt_array;
+      g = mem_get_gentry(gmt_array);
+    }
+    uint8_t *p = mem_get_loc_ptr(g, st->offset, g->nbytes_elem);
+    if (type == GMT_CMD_PUT_VALUE_C) {
+      mem_put_value(p, value, g->nbytes_elem);
+      helper_add_rep_ack(ab, rnid, hid, st->tid);
+      COUNT_EVENT(HELPER_CMD_PUT_VALUE);
+    } else {
+      int64_t ret = mem_atomic_add(p, cmd_unzigzag(value), g->nbytes_elem);
+      /* with no value to return a plain ack credits the same bytes */
+      if (ret_value_ptr == 0)
+        helper_add_rep_ack(ab, rnid, hid, st->tid);
+      else
+        helper_send_rep_value(rnid, hid, st->tid, ret_value_ptr, ret);
+      COUNT_EVENT(HELPER_CMD_ATOMIC_ADD);
+    }
+  }
+  return cmds_ptr;
+}
+
+INLINE void helper_process_buffer(net_buffer_t * buff, bool postpone,
+    uint32_t hid)
+{
   DEBUG0(printf
       ("n %d h %d received buffer of size %d from node %d\n", node_id, hid,
        buff->num_bytes, buff->rnode_id););
-  uint8_t *cmds_ptr = buff->data;     /* pointer for commands */
-  uint8_t *cmds_ptr_end = buff->data; /* end of commands for this block */
-  uint8_t *data_ptr = buff->data;     /* pointer to data */
-  uint32_t rnid = buff->rnode_id;
+  /* buff may be handed back to the comm server while it is parsed (see
+     helper_release_recv_buff), only its data stays valid */
+  uint8_t *const buff_data = buff->data;
+  uint8_t *const buff_end = buff->data + buff->num_bytes;
+  const uint32_t buff_rnid = buff->rnode_id;
+  uint8_t *cmds_ptr = buff_data;      /* pointer for commands */
+  uint8_t *cmds_ptr_end = buff_data;  /* end of commands for this block */
+  uint8_t *data_ptr = buff_data;      /* pointer to data */
+  uint32_t rnid = buff_rnid;
+  uint8_t *route_end = NULL;  /* end of the commands routed from rnid */
+  /* acks are sent once the whole buffer has been parsed */
+  ack_batch_t ab;
+  ab.rnid = rnid;
+  ab.num_acks = 0;
+  quiet_batch_t qb;
+  qb.rnid = rnid;
+  qb.num_tids = 0;
+  cmd_c_state_t c_state;      /* decoder state of compact commands */
   /* reading buffer */
-  while (data_ptr < buff->data + buff->num_bytes) {
+  while (data_ptr < buff_end) {
     _assert(cmds_ptr == cmds_ptr_end);
     /* parsing block_info */
     block_info_t *bi = (block_info_t *) data_ptr;
@@ -374,7 +543,7 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
          " cmds_ptr %lu data_ptr %lu buff->data %lu\n",
          node_id, hid, bi->cmds_bytes,
          bi->data_bytes, (uint64_t) cmds_ptr,
-         (uint64_t) data_ptr, (uint64_t) buff->data););
+         (uint64_t) data_ptr, (uint64_t) buff_data););
     /* check that the info are correct */
     if (!(bi->cmds_bytes > 0))
       ERRORMSG
@@ -383,16 +552,19 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
     _assert(bi->cmds_bytes > 0);
     _assert(data_ptr +
         (sizeof(block_info_t) + bi->cmds_bytes + bi->data_bytes)
-        <= buff->data + buff->num_bytes);
+        <= buff_end);
     /* setting cmds and data pointers */
     cmds_ptr = data_ptr + sizeof(block_info_t);
     cmds_ptr_end = cmds_ptr + bi->cmds_bytes;
     data_ptr = cmds_ptr_end;
+    cmd_c_state_reset(&c_state);
     /* reading a block */
     while (cmds_ptr < cmds_ptr_end) {
 
       _assert(cmds_ptr < data_ptr);
       _assert(data_ptr <= cmds_ptr_end + bi->data_bytes);
+      if (cmds_ptr >= route_end)
+        rnid = buff_rnid;
       /* getting generic command */
       cmd_gen_t *gcmd = (cmd_gen_t *) cmds_ptr;
       switch (gcmd->type) {
@@ -407,9 +579,10 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
         case GMT_CMD_ALLOC:
           {
             cmd_alloc_t *c = (cmd_alloc_t *) gcmd;
-            mem_alloc(c->gmt_array, c->num_elems,
-                c->bytes_per_elem, (char *)(c + 1), c->name_len);
-            helper_send_rep_ack(rnid, hid, c->tid);
+            mem_alloc(c->gmt_array, c->num_elems, c->bytes_per_elem,
+                c->dist_block_elems, c->dist_id, (char *)(c + 1),
+                c->name_len);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c) + c->name_len;
             COUNT_EVENT(HELPER_CMD_ALLOC);
           }
@@ -418,7 +591,7 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
           {
             cmd_free_t *c = (cmd_free_t *) gcmd;
             mem_free(c->gmt_array);
-            helper_send_rep_ack(rnid, hid, c->tid);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c);
             COUNT_EVENT(HELPER_CMD_FREE);
           }
@@ -429,12 +602,52 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             gentry_t *g = mem_get_gentry(c->gmt_array);
             uint8_t *p = mem_get_loc_ptr(g, c->offset, g->nbytes_elem);
             int64_t ret = mem_atomic_add(p, c->value, g->nbytes_elem);
-            helper_send_rep_value(rnid, hid, c->tid,
-                c->ret_value_ptr, ret);
+            /* with no value to return a plain ack credits the same bytes */
+            if (c->ret_value_ptr == 0)
+              helper_add_rep_ack(&ab, rnid, hid, c->tid);
+            else
+              helper_send_rep_value(rnid, hid, c->tid,
+                  c->ret_value_ptr, ret);
             cmds_ptr += sizeof(*c);
             COUNT_EVENT(HELPER_CMD_ATOMIC_ADD);
           }
           break;
+        case GMT_CMD_ATOMIC_OP:
+          {
+            cmd_atomic_op_t *c = (cmd_atomic_op_t *) gcmd;
+            gentry_t *g = mem_get_gentry(c->gmt_array);
+            uint8_t *p = mem_get_loc_ptr(g, c->offset, g->nbytes_elem);
+            int64_t ret = mem_atomic_op(p, (atomic_op_t) c->op, c->value,
+                g->nbytes_elem);
+            if (c->ret_value_ptr == 0)
+              helper_add_rep_ack(&ab, rnid, hid, c->tid);
+            else
+              helper_send_rep_value(rnid, hid, c->tid,
+                  c->ret_value_ptr, ret);
+            cmds_ptr += sizeof(*c);
+            COUNT_EVENT(HELPER_CMD_ATOMIC_OP);
+          }
+          break;
+        case GMT_CMD_ATOMIC_OP_NF:
+          {
+            cmd_atomic_op_nf_t *c = (cmd_atomic_op_nf_t *) gcmd;
+            gentry_t *g = mem_get_gentry(c->gmt_array);
+            uint8_t *p = mem_get_loc_ptr(g, c->offset, g->nbytes_elem);
+            mem_atomic_op(p, (atomic_op_t) c->op, c->value, g->nbytes_elem);
+            /* counted after the update, read back by GMT_CMD_QUIET */
+            helpers[hid].nf_applied[rnid]++;
+            cmds_ptr += sizeof(*c);
+            COUNT_EVENT(HELPER_CMD_ATOMIC_NOFETCH);
+          }
+          break;
+        case GMT_CMD_QUIET:
+          {
+            cmd_quiet_t *c = (cmd_quiet_t *) gcmd;
+            helper_add_rep_quiet(&qb, rnid, hid, c->tid);
+            cmds_ptr += sizeof(*c);
+            COUNT_EVENT(HELPER_CMD_QUIET);
+          }
+          break;
         case GMT_CMD_ATOMIC_CAS:
           {
             cmd_atomic_cas_t *c = (cmd_atomic_cas_t *) gcmd;
@@ -455,7 +668,7 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             gentry_t *g = mem_get_gentry(c->gmt_array);
             uint8_t *p = mem_get_loc_ptr(g, c->offset, c->put_bytes);
             mem_put(p, data_ptr, c->put_bytes);
-            helper_send_rep_ack(rnid, hid, c->tid);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c);
             data_ptr += c->put_bytes;
             COUNT_EVENT(HELPER_CMD_PUT);
@@ -466,7 +679,7 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             cmd_mem_put_t *c = (cmd_mem_put_t *) gcmd;
             _assert(c->put_bytes > 0);
             mem_put(c->address, data_ptr, c->put_bytes);
-            helper_send_rep_ack(rnid, hid, c->tid);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c);
             data_ptr += c->put_bytes;
             COUNT_EVENT(HELPER_CMD_MEM_PUT);
@@ -499,23 +712,51 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
               address += c->chunk_offset;
               put_bytes -= c->chunk_size;
             }
-            helper_send_rep_ack(rnid, hid, c->tid);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c);
             data_ptr += c->put_bytes;
             COUNT_EVENT(HELPER_CMD_MEM_STRIDED_PUT);
           }
           break;
+        case GMT_CMD_PUT_RNDV:
+          {
+            cmd_put_rndv_t *c = (cmd_put_rndv_t *) gcmd;
+            _assert(c->put_bytes > 0);
+            gentry_t *g = mem_get_gentry(c->gmt_array);
+            uint8_t *p = mem_get_loc_ptr(g, c->offset, c->put_bytes);
+            comm_server_post_rndv(false, rnid, p, c->put_bytes, c->tag,
+                c->tid);
+            cmds_ptr += sizeof(*c);
+            COUNT_EVENT(HELPER_CMD_PUT_RNDV);
+          }
+          break;
+        case GMT_CMD_MEM_PUT_RNDV:
+          {
+            cmd_mem_put_rndv_t *c = (cmd_mem_put_rndv_t *) gcmd;
+            _assert(c->put_bytes > 0);
+            comm_server_post_rndv(false, rnid, c->address, c->put_bytes,
+                c->tag, c->tid);
+            cmds_ptr += sizeof(*c);
+            COUNT_EVENT(HELPER_CMD_MEM_PUT_RNDV);
+          }
+          break;
         case GMT_CMD_PUT_VALUE:
           {
             cmd_put_value_t *c = (cmd_put_value_t *) gcmd;
             gentry_t *g = mem_get_gentry(c->gmt_array);
             uint8_t *p = mem_get_loc_ptr(g, c->offset, g->nbytes_elem);
             mem_put_value(p, c->value, g->nbytes_elem);
-            helper_send_rep_ack(rnid, hid, c->tid);
+            helper_add_rep_ack(&ab, rnid, hid, c->tid);
             cmds_ptr += sizeof(*c);
             COUNT_EVENT(HELPER_CMD_PUT_VALUE);
           }
           break;
+        case GMT_CMD_PUT_VALUE_C:
+        case GMT_CMD_ATOMIC_ADD_C:
+        case GMT_CMD_ATOMIC_ADD_RET_C:
+          cmds_ptr = helper_process_compact(cmds_ptr, cmds_ptr_end, &c_state,
+              rnid, hid, &ab);
+          break;
         case GMT_CMD_GET:
           {
             cmd_get_t *c = (cmd_get_t *) gcmd;
@@ -546,6 +787,63 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             COUNT_EVENT(HELPER_CMD_GET);
           }
           break;
+        case GMT_CMD_GATHER:
+          {
+            cmd_gather_t *c = (cmd_gather_t *) gcmd;
+            gentry_t *g = mem_get_gentry(c->gmt_array);
+            uint32_t nbytes_elem = g->nbytes_elem;
+            gather_ent_t *e = (gather_ent_t *) (c + 1);
+            uint32_t i = 0;
+            while (i < c->num) {
+              uint32_t num = MIN(c->num - i, REPLY_GATHER_MAX(nbytes_elem));
+              cmd_rep_gather_t *cr;
+              cr = (cmd_rep_gather_t *) agm_get_cmd(rnid,
+                  hid + NUM_WORKERS,
+                  sizeof(cmd_rep_gather_t) +
+                  num * (sizeof(uint32_t) + nbytes_elem), 0, NULL);
+              cr->type = GMT_CMD_REPLY_GATHER;
+              cr->tid = c->tid;
+              cr->ret_data_ptr = c->ret_data_ptr;
+              cr->nbytes_elem = nbytes_elem;
+              cr->num = num;
+              uint32_t *idx = (uint32_t *) (cr + 1);
+              uint8_t *vals = (uint8_t *) (idx + num);
+              uint32_t j;
+              for (j = 0; j < num; j++, i++) {
+                idx[j] = e[i].idx;
+                memcpy(vals + j * nbytes_elem,
+                    mem_get_loc_ptr(g, e[i].offset, nbytes_elem),
+                    nbytes_elem);
+              }
+              agm_set_cmd_data(rnid, hid + NUM_WORKERS, NULL, 0);
+            }
+            cmds_ptr += sizeof(*c) + c->num * sizeof(gather_ent_t);
+            COUNT_EVENT(HELPER_CMD_GATHER);
+          }
+          break;
+        case GMT_CMD_SCATTER:
+          {
+            cmd_scatter_t *c = (cmd_scatter_t *) gcmd;
+            gentry_t *g = mem_get_gentry(c->gmt_array);
+            uint32_t nbytes_elem = g->nbytes_elem;
+            uint32_t val_bytes = (c->op == SCATTER_OP_ADD) ?
+              sizeof(int64_t) : nbytes_elem;
+            uint8_t *ent = (uint8_t *) (c + 1);
+            uint32_t j;
+            for (j = 0; j < c->num; j++, ent += sizeof(uint64_t) + val_bytes) {
+              uint8_t *ptr = mem_get_loc_ptr(g, *(uint64_t *) ent, nbytes_elem);
+              if (c->op == SCATTER_OP_ADD)
+                mem_atomic_add(ptr, *(int64_t *) (ent + sizeof(uint64_t)),
+                    nbytes_elem);
+              else
+                memcpy(ptr, ent + sizeof(uint64_t), nbytes_elem);
+            }
+            helper_add_rep_ack_bytes(&ab, rnid, hid, c->tid,
+                c->num * sizeof(uint64_t));
+            cmds_ptr += sizeof(*c) + c->num * (sizeof(uint64_t) + val_bytes);
+            COUNT_EVENT(HELPER_CMD_SCATTER);
+          }
+          break;
         case GMT_CMD_MEM_GET:
           {
             cmd_mem_get_t *c = (cmd_mem_get_t *) gcmd;
@@ -598,6 +896,9 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
               loc_ret_size = &ret_size_value;
             }
 
+            /* do not hold acks and replies while running user code */
+            helper_flush_rep_acks(&ab, hid);
+            agm_send_ctrl_cmd(hid + NUM_WORKERS);
             worker_do_execute((void *)((uint64_t) c->func_ptr),
                 args, c->args_bytes, loc_buf, (uint32_t *)loc_ret_size,
                 GMT_HANDLE_NULL);
@@ -667,11 +968,8 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             uint32_t nnode =
               (node_id == num_nodes - 1) ? 0 : node_id + 1;
             cmd_check_handle_t *rc =
-              (cmd_check_handle_t *) agm_get_cmd(nnode,
-                  hid + NUM_WORKERS,
-                  sizeof
-                  (cmd_check_handle_t),
-                  0, NULL);
+              (cmd_check_handle_t *) agm_get_ctrl_cmd(nnode,
+                  hid + NUM_WORKERS, sizeof(cmd_check_handle_t));
             /* phase 1 - doing check terminated 
                increment and forward to next node */
             if (c->node_counter < num_nodes) {
@@ -688,7 +986,6 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
               rc->mtasks_terminated = c->mtasks_terminated;
               rc->handle = c->handle;
             }
-            agm_set_cmd_data(nnode, hid + NUM_WORKERS, NULL, 0);
             cmds_ptr += sizeof(*c);
             COUNT_EVENT(HELPER_CMD_CHECK_HANDLE_REQ);
           }
@@ -703,17 +1000,12 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
               uint32_t nnode =
                 (node_id == num_nodes - 1) ? 0 : node_id + 1;
               cmd_check_handle_t *rc =
-                (cmd_check_handle_t *) agm_get_cmd(nnode,
-                    hid +
-                    NUM_WORKERS,
-                    sizeof
-                    (cmd_check_handle_t),
-                    0, NULL);
+                (cmd_check_handle_t *) agm_get_ctrl_cmd(nnode,
+                  hid + NUM_WORKERS, sizeof(cmd_check_handle_t));
               memcpy(rc, c, sizeof(*rc));
               rc->node_counter++;
               rc->mtasks_created +=
                 mtm.handles[c->handle].mtasks_created;
-              agm_set_cmd_data(nnode, hid + NUM_WORKERS, NULL, 0);
             } else {
               /* check completed */
                 _assert(mtm.handles[c->handle].status ==
@@ -734,14 +1026,11 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
                 uint32_t nnode =
                   (node_id == num_nodes - 1) ? 0 : node_id + 1;
                 cmd_check_handle_t *rc =
-                  (cmd_check_handle_t *) agm_get_cmd(nnode,
-                      hid + NUM_WORKERS,
-                      sizeof(cmd_check_handle_t),
-                      0, NULL);
+                  (cmd_check_handle_t *) agm_get_ctrl_cmd(nnode,
+                  hid + NUM_WORKERS, sizeof(cmd_check_handle_t));
                 memcpy(rc, c, sizeof(*rc));
                 rc->type = GMT_CMD_HANDLE_RESET;
                 rc->node_counter=1;
-                agm_set_cmd_data(nnode, hid + NUM_WORKERS, NULL, 0);
               } else {
                 ret =
                   __sync_bool_compare_and_swap(&mtm.handles
@@ -766,19 +1055,13 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
               uint32_t nnode =
                 (node_id == num_nodes - 1) ? 0 : node_id + 1;
               cmd_check_handle_t *rc =
-                (cmd_check_handle_t *) agm_get_cmd(nnode,
-                    hid +
-                    NUM_WORKERS,
-                    sizeof
-                    (cmd_check_handle_t),
-                    0, NULL);
+                (cmd_check_handle_t *) agm_get_ctrl_cmd(nnode,
+                  hid + NUM_WORKERS, sizeof(cmd_check_handle_t));
               memcpy(rc, c, sizeof(*rc));
               rc->node_counter++;
 
               mtm.handles[c->handle].mtasks_created=0;
               mtm.handles[c->handle].mtasks_terminated=0;
-
-              agm_set_cmd_data(nnode, hid+NUM_WORKERS, NULL,0);
               ret = true;
             } else {
               mtm.handles[c->handle].mtasks_created=0;
@@ -830,6 +1113,36 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             COUNT_EVENT(HELPER_CMD_REPLY_ACK);
           }
           break;
+        case GMT_CMD_ROUTE:
+          {
+            cmd_route_t *c = (cmd_route_t *) gcmd;
+            if (c->dst == node_id) {
+              /* the commands that follow come from c->src */
+              rnid = c->src;
+              route_end = cmds_ptr + sizeof(*c) + c->cmds_bytes;
+              cmds_ptr += sizeof(*c);
+            } else {
+              /* we are the proxy, dst is in our group */
+              uint32_t size = sizeof(*c) + c->cmds_bytes;
+              void *fc = agm_get_cmd(c->dst, hid + NUM_WORKERS, size, 0, NULL);
+              memcpy(fc, c, size);
+              agm_set_cmd_data(c->dst, hid + NUM_WORKERS, NULL, 0);
+              cmds_ptr += size;
+              COUNT_EVENT(HELPER_CMD_ROUTE);
+            }
+          }
+          break;
+        case GMT_CMD_REPLY_ACK_BATCH:
+          {
+            cmd_rep_ack_batch_t *c = (cmd_rep_ack_batch_t *) gcmd;
+            rep_ack_t *acks = (rep_ack_t *) (c + 1);
+            uint32_t i;
+            for (i = 0; i < c->num_acks; i++)
+              uthread_incr_recv_nbytes(acks[i].tid, acks[i].nbytes);
+            cmds_ptr += sizeof(*c) + c->num_acks * sizeof(rep_ack_t);
+            COUNT_EVENT(HELPER_CMD_REPLY_ACK_BATCH);
+          }
+          break;
         case GMT_CMD_REPLY_VALUE:
           {
             cmd_rep_value_t *c = (cmd_rep_value_t *) gcmd;
@@ -841,6 +1154,21 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             COUNT_EVENT(HELPER_CMD_REPLY_VALUE);
           }
           break;
+        case GMT_CMD_REPLY_QUIET:
+          {
+            cmd_rep_quiet_t *c = (cmd_rep_quiet_t *) gcmd;
+            volatile uint64_t *conf = &workers_nf_confirmed[rnid];
+            uint64_t old = *conf;
+            while (old < c->applied &&
+                !__sync_bool_compare_and_swap(conf, old, c->applied))
+              old = *conf;
+            uint32_t *tids = (uint32_t *) (c + 1);
+            uint32_t i;
+            for (i = 0; i < c->num_tids; i++)
+              uthread_incr_recv_nbytes(tids[i], sizeof(uint64_t));
+            cmds_ptr += sizeof(*c) + c->num_tids * sizeof(uint32_t);
+          }
+          break;
         case GMT_CMD_REPLY_GET:
           {
             cmd_rep_get_t *c = (cmd_rep_get_t *) gcmd;
@@ -852,6 +1180,22 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
             COUNT_EVENT(HELPER_CMD_REPLY_GET);
           }
           break;
+        case GMT_CMD_REPLY_GATHER:
+          {
+            cmd_rep_gather_t *c = (cmd_rep_gather_t *) gcmd;
+            uint8_t *ptr = (uint8_t *) ((uint64_t) c->ret_data_ptr);
+            uint32_t *idx = (uint32_t *) (c + 1);
+            uint8_t *vals = (uint8_t *) (idx + c->num);
+            uint32_t j;
+            for (j = 0; j < c->num; j++)
+              memcpy(ptr + (uint64_t) idx[j] * c->nbytes_elem,
+                  vals + j * c->nbytes_elem, c->nbytes_elem);
+            uthread_incr_recv_nbytes(c->tid, c->num * c->nbytes_elem);
+            cmds_ptr += sizeof(*c) +
+              c->num * (sizeof(uint32_t) + c->nbytes_elem);
+            COUNT_EVENT(HELPER_CMD_REPLY_GATHER);
+          }
+          break;
         default:
           {
             ERRORMSG("n %d h %d - Command %d not recognized\n",
@@ -860,16 +1204,116 @@ INLINE void helper_check_in_buffers(bool postpone, uint32_t hid)
       }
     }
   }
+  helper_flush_rep_acks(&ab, hid);
+  helper_flush_rep_quiet(&qb, hid);
+  /* the replies to a buffer leave together */
+  agm_send_ctrl_cmd(hid + NUM_WORKERS);
   DEBUG0(printf
       ("n %d h %d - processing done of buffer of size %d\n",
-       node_id, hid, buff->num_bytes););
-#if  !ENABLE_HELPER_BUFF_COPY
-  comm_server_push_recv_buff(hid);
-#endif
+       node_id, hid, (int) (buff_end - buff_data)););
   //     if (mtask_enq > 0)
   //         _DEBUG("mtask_enq %d\n", mtask_enq);
 }
 
+/* control buffers are small and are processed in place, before any bulk
+   buffer, so that replies and handle checks do not queue behind data */
+INLINE bool helper_check_ctrl_buffers(bool postpone, uint32_t hid)
+{
+  bool found = false;
+  net_buffer_t *buff = comm_server_pop_ctrl_recv_buff(hid);
+  while (buff != NULL) {
+    found = true;
+    helper_process_buffer(buff, postpone, hid);
+    comm_server_push_ctrl_recv_buff(hid);
+    buff = comm_server_pop_ctrl_recv_buff(hid);
+  }
+  return found;
+}
+
+#if !ENABLE_HELPER_BUFF_COPY
+/* Give back the receive buffer parsed in place by helper hid. The helper
+ * keeps the data it is parsing and the buffer takes the spare array of its
+ * class, so that it can be posted again without copying anything. Called
+ * whenever the helper is about to block on a resource of the comm servers,
+ * so that holding the buffer never stops the remote nodes from progressing */
+void helper_release_recv_buff(uint32_t hid)
+{
+  net_buffer_t *buff = helpers[hid].in_place;
+  if (buff == NULL)
+    return;
+  helpers[hid].in_place = NULL;
+  uint32_t c = comm_server_buff_class(buff->size);
+  _assert(cs.class_size[c] == buff->size);
+  uint8_t *data = buff->data;
+  buff->data = helpers[hid].spare_data[c];
+  helpers[hid].spare_data[c] = data;
+  comm_server_push_buff_recv(buff);
+  COUNT_EVENT(HELPER_RECV_BUFF_RELEASED);
+}
+#endif
+
+/* process at most one buffer of each size class */
+INLINE bool helper_check_in_buffers(bool postpone, uint32_t hid)
+{
+  bool found = false;
+  uint32_t c;
+  for (c = 0; c < NUM_BUFF_CLASSES; c++) {
+    net_buffer_t *recv_buff = comm_server_pop_class_recv_buff(c, hid);
+    if (recv_buff == NULL)
+      continue;
+    found = true;
+#if TRACE_QUEUES
+    helpers[hid].rpop_hits++;
+#endif
+
+#if !ENABLE_HELPER_BUFF_COPY
+    /* shm ring slots belong to the sender and are copied as before */
+    if (recv_buff->transport != NET_TRANSPORT_SHM) {
+      helpers[hid].in_place = recv_buff;
+      helper_process_buffer(recv_buff, postpone, hid);
+      if (helpers[hid].in_place != NULL) {
+        helpers[hid].in_place = NULL;
+        comm_server_push_buff_recv(recv_buff);
+      }
+      continue;
+    }
+#endif
+    net_buffer_t *buff = &helpers[hid].tmp_buff;
+    buff->num_bytes = recv_buff->num_bytes;
+    buff->rnode_id = recv_buff->rnode_id;
+    memcpy(buff->data, recv_buff->data, recv_buff->num_bytes);
+    comm_server_push_buff_recv(recv_buff);
+    helper_process_buffer(buff, postpone, hid);
+  }
+  if (!found) {
+#if TRACE_QUEUES
+	helpers[hid].rpop_misses++;
+#endif
+    sched_yield();
+  }
+  return found;
+}
+
+/* ack the rendezvous transfers received by the comm servers */
+INLINE bool helper_check_rndv(uint32_t hid)
+{
+  rndv_req_t *r = comm_server_rndv_take(&cs.rndv_done);
+  bool found = (r != NULL);
+  ack_batch_t ab;
+  ab.num_acks = 0;
+  if (found)
+    ab.rnid = r->rnid;
+  while (r != NULL) {
+    rndv_req_t *next = r->next;
+    helper_add_rep_ack(&ab, r->rnid, hid, r->tid);
+    free(r);
+    r = next;
+  }
+  helper_flush_rep_acks(&ab, hid);
+  agm_send_ctrl_cmd(hid + NUM_WORKERS);
+  return found;
+}
+
 void *helper_loop(void *arg)
 {
   uint32_t hid = (uint64_t) arg;
@@ -911,10 +1355,22 @@ void *helper_loop(void *arg)
     postpone = helper_flush_pending(hid);
 #endif
 
-    /* check for incoming buffers */
+    /* check for incoming buffers, control first */
     START_TIME(ts3);
-    helper_check_in_buffers(postpone, hid);
+    bool found = helper_check_ctrl_buffers(postpone, hid);
+    found |= helper_check_in_buffers(postpone, hid);
     END_TIME(ts3, HELPER_SERVICE_BUF);
+
+    found |= helper_check_rndv(hid);
+
+    if (found || helper_stop_flag)
+      idle_reset(&helpers[hid].backoff);
+    else
+      idle_miss(&cs.recv_idle[hid], &helpers[hid].backoff, !postpone &&
+                idle_may_park(&helpers[hid].backoff) &&
+                agm_is_idle(hid + NUM_WORKERS,
+                            helpers[hid].part_start_node_id,
+                            helpers[hid].part_end_node_id));
   }
   pthread_exit(NULL);
 }
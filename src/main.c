@@ -138,7 +138,8 @@ int main(int argc, char *argv[])
 //     get_shmem_bytes(&mem.shmem_size_total, &mem.shmem_size_used,
 //                     &mem.shmem_size_avail);
     
-    pt_stacks_size = (NUM_WORKERS + NUM_HELPERS + 1) * PTHREAD_STACK_SIZE;
+    pt_stacks_size = (NUM_WORKERS + NUM_HELPERS + NUM_COMM_SERVERS) *
+        PTHREAD_STACK_SIZE;
 #ifdef SCHEDULER
     pt_stacks_size += PTHREAD_STACK_SIZE;
 #endif
@@ -151,6 +152,7 @@ int main(int argc, char *argv[])
 #if !(ENABLE_SINGLE_NODE_ONLY)
     if (num_nodes != 1) {
         comm_server_init();
+        network_rma_init();
         aggreg_init();
         helper_team_init();
     }
@@ -210,10 +212,19 @@ int main(int argc, char *argv[])
 
     mem_destroy();
     mtm_destroy();
+#if !(ENABLE_SINGLE_NODE_ONLY)
+    if (num_nodes != 1)
+        network_rma_destroy();
+#endif
 
     if (config.print_gmt_mem_usage) {
         printf("GMT internal structures usage - %ld MB\n",
                _total_malloc / 1024 / 1024);
+        printf("GMT huge page arrays - hugetlb %ld MB - transparent %ld MB "
+               "- fallback %ld MB\n",
+               mem.nbytes_pages[MEM_PAGES_HUGETLB] / 1024 / 1024,
+               mem.nbytes_pages[MEM_PAGES_THP] / 1024 / 1024,
+               mem.nbytes_pages[MEM_PAGES_SMALL] / 1024 / 1024);
     }
 #if !(ENABLE_SINGLE_NODE_ONLY)
     network_finalize();
@@ -40,6 +40,122 @@
 
 memory_t mem;
 
+/* FNV-1a */
+static uint64_t name_hash(const char *name)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*name != '\0') {
+        h ^= (uint8_t) * name++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void names_lock()
+{
+    while (!__sync_bool_compare_and_swap(&mem.names_lock, 0, 1)) ;
+}
+
+static void names_unlock()
+{
+    __sync_lock_release(&mem.names_lock);
+}
+
+/* returns the slot holding name or NULL, called with the lock held */
+static mem_name_slot_t *names_find(const char *name, uint64_t h)
+{
+    uint32_t mask = mem.names_cap - 1;
+    uint32_t i = h & mask;
+    while (mem.names[i].state != MEM_NAME_EMPTY) {
+        mem_name_slot_t *s = &mem.names[i];
+        if (s->state == MEM_NAME_USED && s->hash == h) {
+            gentry_t *ga = mem_gentry_lookup(s->gid);
+            _assert(ga != NULL && ga->name != NULL);
+            if (strcmp(ga->name, name) == 0)
+                return s;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+/* rebuild the index with new_cap slots dropping deleted slots, called with
+ * the lock held */
+static void names_rehash(uint32_t new_cap)
+{
+    mem_name_slot_t *old = mem.names;
+    uint32_t old_cap = mem.names_cap;
+    mem.names = (mem_name_slot_t *) _calloc(new_cap, sizeof(mem_name_slot_t));
+    mem.names_cap = new_cap;
+    mem.names_filled = 0;
+    uint32_t i;
+    for (i = 0; i < old_cap; i++) {
+        if (old[i].state != MEM_NAME_USED)
+            continue;
+        uint32_t j = old[i].hash & (new_cap - 1);
+        while (mem.names[j].state != MEM_NAME_EMPTY)
+            j = (j + 1) & (new_cap - 1);
+        mem.names[j] = old[i];
+        mem.names_filled++;
+    }
+    free(old);
+}
+
+void mem_name_insert(const char *name, uint32_t gid)
+{
+    uint64_t h = name_hash(name);
+    names_lock();
+    /* keep the load factor (deleted slots included) below 1/2 */
+    if ((mem.names_filled + 1) * 2 > mem.names_cap) {
+        uint32_t live = 0, i;
+        for (i = 0; i < mem.names_cap; i++)
+            live += (mem.names[i].state == MEM_NAME_USED);
+        uint32_t cap = mem.names_cap;
+        if ((live + 1) * 4 > cap)
+            cap *= 2;
+        names_rehash(cap);
+    }
+    uint32_t mask = mem.names_cap - 1;
+    uint32_t i = h & mask;
+    while (mem.names[i].state == MEM_NAME_USED)
+        i = (i + 1) & mask;
+    if (mem.names[i].state == MEM_NAME_EMPTY)
+        mem.names_filled++;
+    mem.names[i].hash = h;
+    mem.names[i].gid = gid;
+    mem.names[i].state = MEM_NAME_USED;
+    names_unlock();
+}
+
+void mem_name_remove(const char *name, uint32_t gid)
+{
+    uint64_t h = name_hash(name);
+    names_lock();
+    /* names are unique only in writable states, match the gid too */
+    uint32_t mask = mem.names_cap - 1;
+    uint32_t i = h & mask;
+    while (mem.names[i].state != MEM_NAME_EMPTY) {
+        mem_name_slot_t *s = &mem.names[i];
+        if (s->state == MEM_NAME_USED && s->gid == gid) {
+            _assert(s->hash == h);
+            s->state = MEM_NAME_DELETED;
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    names_unlock();
+}
+
+gentry_t *mem_name_lookup(const char *name)
+{
+    uint64_t h = name_hash(name);
+    names_lock();
+    mem_name_slot_t *s = names_find(name, h);
+    gentry_t *ga = (s == NULL) ? NULL : mem_gentry_lookup(s->gid);
+    names_unlock();
+    return ga;
+}
+
 static void create_state_dir(char *dir)
 {
     struct stat s;
@@ -65,19 +181,31 @@ static void create_state_dir(char *dir)
 static void load_state(char *path, bool is_shm)
 {
     char tmp[PATH_MAX];
+    char prefix[PATH_MAX + 16];
     DIR *d;
     struct dirent *dir;
-    sprintf(tmp, "%s/GMT_STATES/%s", path, config.state_name);
+    /* SHM state files are flat in path (see af_shm_name()), the others are
+     * in the state directory */
+    if (is_shm) {
+        sprintf(prefix, "GMT_STATES.%s.", config.state_name);
+        sprintf(tmp, "%s", path);
+    } else {
+        prefix[0] = '\0';
+        sprintf(tmp, "%s/GMT_STATES/%s", path, config.state_name);
+    }
+    size_t prefix_len = strlen(prefix);
     d = opendir(tmp);
     if (d) {
         while ((dir = readdir(d)) != NULL) {
             if (strcmp(dir->d_name, ".") == 0 || strcmp(dir->d_name, "..") == 0)
                 continue;
+            if (strncmp(dir->d_name, prefix, prefix_len) != 0)
+                continue;
 
             char name[PATH_MAX];
             uint32_t node;
-            sscanf(dir->d_name, "n%d-%s", &node, name);
-            if (node != node_id)
+            if (sscanf(dir->d_name + prefix_len, "n%d-%s", &node, name) != 2 ||
+                node != node_id)
                 continue;
 
             gmt_data_t gdata = gmt_attach(name);
@@ -91,7 +219,7 @@ static void load_state(char *path, bool is_shm)
                 flag = O_RDWR;
             int fd;
             if (is_shm) {
-                sprintf(tmp, "GMT_STATES/%s/%s", config.state_name, dir->d_name);
+                sprintf(tmp, "/%s", dir->d_name);
                 fd = shm_open(tmp, flag, (S_IREAD | S_IWRITE));
             } else {
                 sprintf(tmp, "%s/GMT_STATES/%s/%s", path, config.state_name,
@@ -107,7 +235,7 @@ static void load_state(char *path, bool is_shm)
             if (config.state_populate)
                 flag = flag | MAP_POPULATE;
 
-            gentry_t *ga = &mem.gentry[GD_GET_ID(h->gmt_array)];
+            gentry_t *ga = mem_gentry_materialize(GD_GET_ID(h->gmt_array));
             memcpy(ga, h, sizeof(gentry_t));
             munmap(h, sizeof(gentry_t));
             uint64_t nbytes = ga->nbytes_tot + sizeof(gentry_t);
@@ -116,8 +244,16 @@ static void load_state(char *path, bool is_shm)
                 ERRORMSG("ERROR map GMT permanent array");
 
             ga->data += sizeof(gentry_t);
+            /* huge page arrays are unmapped on free with this length */
+            if (ga->page_mode == MEM_PAGES_HUGETLB)
+                ga->nbytes_mapped = CEILING(nbytes, mem_hugepage_bytes()) *
+                    mem_hugepage_bytes();
+            /* restored arrays are not attached to the RMA window */
+            ga->rma_attached = false;
+            ga->rma_raddr = NULL;
             ga->name = (char *)_malloc(strlen(name) + 1);
             memcpy(ga->name, name, strlen(name) + 1);
+            mem_name_insert(ga->name, GD_GET_ID(ga->gmt_array));
             printf("node %d - RESTORE NAME:%s\n", node_id, ga->name);
 
             close(fd);
@@ -137,19 +273,39 @@ void mem_init()
 
 
     if (config.state_name[0] != '\0' && config.state_prot == (PROT_READ | PROT_WRITE)) {
-        create_state_dir("/dev/shm/");
         create_state_dir(config.ssd_path);
         create_state_dir(config.disk_path);
+        if (config.hugetlbfs_path[0] != '\0')
+            create_state_dir(config.hugetlbfs_path);
     }
 
-    /* create memory entry table and initialize to zero */
-    uint32_t num = GMT_MAX_ALLOC_PER_NODE * num_nodes;
-    mem.gentry = (gentry_t *) _calloc(num, sizeof(gentry_t));
+    if (GMT_MAX_ALLOC_PER_NODE % GENTRY_CHUNK_SIZE != 0)
+        ERRORMSG("GMT_MAX_ALLOC_PER_NODE must be a multiple of "
+                 "GENTRY_CHUNK_SIZE");
+
+    /* create the directory of the memory entry table, chunks of entries 
+     * are allocated (zeroed) on their first use */
+    mem.gentry_dir_size = GMT_MAX_ALLOC_PER_NODE / GENTRY_CHUNK_SIZE *
+        num_nodes;
+    mem.gentry_dir = (gentry_t * volatile *) _calloc(mem.gentry_dir_size,
+                                                     sizeof(gentry_t *));
+    mem.dists = (gmt_dist_funcs_t *) _calloc(GMT_MAX_DIST_PER_NODE * num_nodes,
+                                             sizeof(gmt_dist_funcs_t));
+    mem.num_dists = 0;
+
+    mem.names_cap = MEM_NAMES_INIT_SLOTS;
+    mem.names = (mem_name_slot_t *) _calloc(mem.names_cap,
+                                            sizeof(mem_name_slot_t));
+    mem.names_filled = 0;
+    mem.names_lock = 0;
+    memset(mem.nbytes_pages, 0, sizeof(mem.nbytes_pages));
     
     if (config.state_name[0] != '\0') {
         load_state("/dev/shm/", true);
         load_state(config.ssd_path, false);
         load_state(config.disk_path, false);
+        if (config.hugetlbfs_path[0] != '\0')
+            load_state(config.hugetlbfs_path, false);
     }
 
     /* reinitialize the pool for allocations ids (omitting ids used 
@@ -157,9 +313,9 @@ void mem_init()
     mem_id_pool_init(&mem.mem_id_pool);
     uint32_t i;
     for (i = 0; i < GMT_MAX_ALLOC_PER_NODE; i++) {
-        gentry_t *ga = &mem.gentry[i];
-        _assert(ga->nbytes_tot == 0);
-        if (ga->nbytes_tot == 0)
+        gentry_t *ga = mem_gentry_lookup(i);
+        _assert(ga == NULL || ga->nbytes_tot == 0);
+        if (ga == NULL || ga->nbytes_tot == 0)
             mem_id_pool_push(&mem.mem_id_pool, i);
     }
     mem.num_used_allocs = 0;
@@ -168,17 +324,21 @@ void mem_init()
 void mem_destroy()
 {
     uint64_t unallocated_mem = 0;
-    uint32_t i;
-    uint32_t nentries = num_nodes * GMT_MAX_ALLOC_PER_NODE;
-    for (i = 0; i < nentries; i++) {
-        gentry_t *ga = &mem.gentry[i];
-        if (ga->nbytes_tot > 0 && ga->is_tmp) {            
-            unallocated_mem += ga->nbytes_tot;
-            if (node_id == 0)
-                printf("Warning node %d - GMT_ARRAY name=%s - gid=%d "
-                "allocated at exit %ld bytes\n", node_id, ga->name, i, 
-                ga->nbytes_tot);
-            mem_free(ga->gmt_array);
+    uint32_t c, i;
+    /* only the chunks that were used can have live entries */
+    for (c = 0; c < mem.gentry_dir_size; c++) {
+        if (mem.gentry_dir[c] == NULL)
+            continue;
+        for (i = 0; i < GENTRY_CHUNK_SIZE; i++) {
+            gentry_t *ga = &mem.gentry_dir[c][i];
+            if (ga->nbytes_tot > 0 && ga->is_tmp) {            
+                unallocated_mem += ga->nbytes_tot;
+                if (node_id == 0)
+                    printf("Warning node %d - GMT_ARRAY name=%s - gid=%d "
+                    "allocated at exit %ld bytes\n", node_id, ga->name,
+                    c * GENTRY_CHUNK_SIZE + i, ga->nbytes_tot);
+                mem_free(ga->gmt_array);
+            }
         }
     }
 
@@ -187,6 +347,10 @@ void mem_destroy()
             ("GMT WARNING - %ld bytes of GMT non permanent allocated space"
              " are still allocated at exit!\n", unallocated_mem);
 
-    free(mem.gentry);
+    for (c = 0; c < mem.gentry_dir_size; c++)
+        free(mem.gentry_dir[c]);
+    free((void *) mem.gentry_dir);
+    free(mem.dists);
+    free(mem.names);
     mem_id_pool_destroy(&mem.mem_id_pool);
 }
@@ -46,6 +46,8 @@ void mtm_init()
 {
 	uint32_t i;
 
+	idle_init(&mtm.idle);
+
 	/* initialize structures for task allocation */
 #if ALL_TO_ALL || SCHEDULER
 	mtm.pool_size = config.num_workers * config.mtasks_per_queue;
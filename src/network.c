@@ -32,37 +32,230 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "gmt/network.h"
+#include "gmt/utils.h"
 
 #if !ENABLE_SINGLE_NODE_ONLY
 
+network_t net;
+
 /************* net_buffer_t ***************************/
-void netbuffer_init(net_buffer_t * buff, uint32_t id, void *context)
+void netbuffer_init(net_buffer_t * buff, uint32_t id, void *context,
+                    uint32_t size, int tag)
 {
     memset(buff, 0, sizeof(net_buffer_t));    
-    buff->data = (uint8_t *)_malloc(COMM_BUFFER_SIZE);
-    memset(buff->data, COMM_BUFFER_SIZE, sizeof(uint8_t));    
+    buff->data = (uint8_t *)_malloc(size);
+    memset(buff->data, size, sizeof(uint8_t));    
     buff->num_bytes = 0;
+    buff->size = size;
+    buff->tag = tag;
     buff->id = id;
     buff->context = context;
 }
 
 
+void netbuffer_init_sg(net_buffer_t * buff)
+{
+    buff->sg_addrs = (MPI_Aint *) _malloc(SG_MAX_SEGMENTS * sizeof(MPI_Aint));
+    buff->sg_lens = (int *)_malloc(SG_MAX_SEGMENTS * sizeof(int));
+    buff->sg_hold = (void **)_malloc(SG_MAX_SEGMENTS * sizeof(void *));
+}
+
 void netbuffer_destroy(net_buffer_t * buff)
 {    
     free(buff->data);
+    free(buff->sg_addrs);
+    free(buff->sg_lens);
+    free(buff->sg_hold);
 }
 
 /****************** Network ***************/
 void network_init(int *argc, char ***argv)
 {
-    int ret = MPI_Init(argc, argv);
+    /* config is not parsed yet, look ahead for the number of comm servers 
+     * and RMA since both need MPI_THREAD_MULTIPLE */
+    uint32_t num_comm_servers = 1;
+    uint64_t rma_threshold = 0;
+    int i;
+    for (i = 1; i < *argc - 1; i++) {
+        if (strcmp((*argv)[i], "--gmt_num_comm_servers") == 0)
+            num_comm_servers = strtol_suffix((*argv)[i + 1]);
+        if (strcmp((*argv)[i], "--gmt_rma_threshold") == 0)
+            rma_threshold = strtol_suffix((*argv)[i + 1]);
+    }
+
+    int ret;
+    if (num_comm_servers > 1 || rma_threshold > 0) {
+        int provided;
+        ret = MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+        if (ret == MPI_SUCCESS && provided < MPI_THREAD_MULTIPLE)
+            ERRORMSG("MPI_THREAD_MULTIPLE is required by "
+                     "--gmt_num_comm_servers and --gmt_rma_threshold\n");
+    } else
+        ret = MPI_Init(argc, argv);
     if (ret != MPI_SUCCESS)
         ERRORMSG("Error initializing MPI\n");
     MPI_Comm_rank(MPI_COMM_WORLD, (int *)&node_id);
     MPI_Comm_size(MPI_COMM_WORLD, (int *)&num_nodes);
 }
 
+void network_comms_init(uint32_t num_comms)
+{
+    uint32_t i;
+    net.num_comms = num_comms;
+    net.comms = (MPI_Comm *) _malloc(num_comms * sizeof(MPI_Comm));
+    for (i = 0; i < num_comms; i++)
+        MPI_Comm_dup(MPI_COMM_WORLD, &net.comms[i]);
+
+    int *tag_ub, flag;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &flag);
+    net.rndv_tag_ub = flag ? *tag_ub : 32767;
+    net.rndv_next_tag = 0;
+}
+
+void network_comms_destroy()
+{
+    uint32_t i;
+    for (i = 0; i < net.num_comms; i++)
+        MPI_Comm_free(&net.comms[i]);
+    free(net.comms);
+    net.num_comms = 0;
+}
+
+/****************** Shared-memory transport ***************/
+static void network_shm_name(char *name, uint32_t key, uint32_t lr)
+{
+    sprintf(name, "/gmt-%u-%u", key, lr);
+}
+
+void network_shm_init()
+{
+    uint32_t i;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, node_id,
+                        MPI_INFO_NULL, &net.local_comm);
+    MPI_Comm_rank(net.local_comm, (int *)&net.local_rank);
+    MPI_Comm_size(net.local_comm, (int *)&net.local_size);
+
+    /* map each node to its local rank (-1 if on another host) */
+    net.local_ranks = (int32_t *) _malloc(num_nodes * sizeof(int32_t));
+    for (i = 0; i < num_nodes; i++)
+        net.local_ranks[i] = -1;
+    int *world = (int *)_malloc(net.local_size * sizeof(int));
+    MPI_Allgather(&node_id, 1, MPI_INT, world, 1, MPI_INT, net.local_comm);
+    for (i = 0; i < net.local_size; i++)
+        if ((uint32_t) world[i] != node_id)
+            net.local_ranks[world[i]] = i;
+    net.local_nodes = (uint32_t *) _malloc(net.local_size * sizeof(uint32_t));
+    for (i = 0; i < net.local_size; i++)
+        net.local_nodes[i] = world[i];
+    free(world);
+
+    /* all the nodes on the host have to agree on using the shm transport */
+    int enable = config.shm_transport && net.local_size > 1;
+    MPI_Allreduce(MPI_IN_PLACE, &enable, 1, MPI_INT, MPI_LAND,
+                  net.local_comm);
+    net.shm_enabled = enable;
+    if (!net.shm_enabled)
+        return;
+
+    net.shm_slots = config.shm_ring_slots;
+    net.shm_slot_bytes = SHM_SLOT_HEADER_SIZE + COMM_BUFFER_SIZE;
+    net.shm_seg_bytes = (uint64_t) net.local_size * net.shm_slots *
+        net.shm_slot_bytes;
+    net.shm_segs = (uint8_t **) _calloc(net.local_size, sizeof(uint8_t *));
+    net.shm_send_head = (uint32_t *) _calloc(net.local_size, sizeof(uint32_t));
+    net.shm_recv_head = (uint32_t *) _calloc(net.local_size, sizeof(uint32_t));
+    net.shm_recv_next = (uint32_t *) _calloc(net.num_comms, sizeof(uint32_t));
+
+    /* the pid of local rank 0 makes the segment names unique on the host */
+    uint32_t key = getpid();
+    MPI_Bcast(&key, 1, MPI_UINT32_T, 0, net.local_comm);
+
+    char name[NAME_MAX];
+    network_shm_name(name, key, net.local_rank);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+        ERRORMSG("shm_open %s failed: %s", name, strerror(errno));
+    if (ftruncate(fd, net.shm_seg_bytes) != 0)
+        ERRORMSG("ftruncate %s failed: %s", name, strerror(errno));
+    net.shm_segs[net.local_rank] = (uint8_t *) mmap(NULL, net.shm_seg_bytes,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (net.shm_segs[net.local_rank] == MAP_FAILED)
+        ERRORMSG("mmap %s failed: %s", name, strerror(errno));
+    close(fd);
+    MPI_Barrier(net.local_comm);
+
+    for (i = 0; i < net.local_size; i++) {
+        if (i == net.local_rank)
+            continue;
+        network_shm_name(name, key, i);
+        fd = shm_open(name, O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd == -1)
+            ERRORMSG("shm_open %s failed: %s", name, strerror(errno));
+        net.shm_segs[i] = (uint8_t *) mmap(NULL, net.shm_seg_bytes,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (net.shm_segs[i] == MAP_FAILED)
+            ERRORMSG("mmap %s failed: %s", name, strerror(errno));
+        close(fd);
+    }
+
+    /* everybody has mapped, names are not needed anymore */
+    MPI_Barrier(net.local_comm);
+    network_shm_name(name, key, net.local_rank);
+    shm_unlink(name);
+}
+
+void network_shm_destroy()
+{
+    uint32_t i;
+    if (net.shm_enabled) {
+        for (i = 0; i < net.local_size; i++)
+            munmap(net.shm_segs[i], net.shm_seg_bytes);
+        free(net.shm_segs);
+        free(net.shm_send_head);
+        free(net.shm_recv_head);
+        free(net.shm_recv_next);
+    }
+    free(net.local_ranks);
+    free(net.local_nodes);
+    MPI_Comm_free(&net.local_comm);
+    net.shm_enabled = false;
+}
+
+/****************** One-sided RMA ***************/
+void network_rma_init()
+{
+    net.rma_enabled = config.rma_threshold > 0;
+    if (!net.rma_enabled)
+        return;
+    /* the last home slot probes past the end of the table */
+    uint64_t dir_bytes = (NET_RMA_DIR_SLOTS + NET_RMA_DIR_PROBE - 1) *
+        sizeof(rma_dir_slot_t);
+    net.rma_dir = (rma_dir_slot_t *) _calloc(1, dir_bytes);
+    net.rma_dir_lock = 0;
+    net.rma_num_attached = 0;
+    MPI_Win_create(net.rma_dir, dir_bytes, 1, MPI_INFO_NULL,
+                   MPI_COMM_WORLD, &net.rma_dir_win);
+    MPI_Win_create_dynamic(MPI_INFO_NULL, MPI_COMM_WORLD, &net.rma_win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, net.rma_dir_win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, net.rma_win);
+}
+
+void network_rma_destroy()
+{
+    if (!net.rma_enabled)
+        return;
+    MPI_Win_unlock_all(net.rma_win);
+    MPI_Win_unlock_all(net.rma_dir_win);
+    MPI_Win_free(&net.rma_win);
+    MPI_Win_free(&net.rma_dir_win);
+    free(net.rma_dir);
+    net.rma_enabled = false;
+}
+
 void network_finalize()
 {
     MPI_Finalize();
@@ -73,4 +266,11 @@ void network_barrier()
     MPI_Barrier(MPI_COMM_WORLD);
 }
 
+bool network_all_agree(bool value)
+{
+    int v = value;
+    MPI_Allreduce(MPI_IN_PLACE, &v, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return v;
+}
+
 #endif
@@ -59,8 +59,10 @@ uint64_t print_events(char *event_str, event_type_t type,
                        && i < (int)(NUM_WORKERS + NUM_HELPERS)) {
                 sprintf(name, "H ");
                 id = i - NUM_WORKERS;
-            } else
+            } else {
                 sprintf(name, "CS");
+                id = i - NUM_WORKERS - NUM_HELPERS;
+            }
             printf("%30s\t\t%s %u\t\t%2d\t%12lu\n",
                    event_str, name, id, nid, count);
             tot += count;
@@ -82,10 +84,33 @@ void print_all_profile(uint64_t * profile, uint32_t nid)
                  COMM_RECV_COMPLETED,
                  COMM_SEND_BYTES,
                  COMM_RECV_BYTES,
+                 COMM_SHM_SEND_COMPLETED,
+                 COMM_SHM_RECV_COMPLETED,
+                 COMM_RNDV_SEND_COMPLETED,
+                 COMM_RNDV_RECV_COMPLETED,
+                 COMM_POLL_CALLS,
+                 COMM_POLL_CYCLES,
                  WORKER_ITS_STARTED,
                  WORKER_ITS_SELF_EXECUTE,
                  WORKER_ITS_EXECUTE_LOCAL,
                  WORKER_ITS_ENQUEUE_LOCAL, WORKER_ITS_ENQUEUE_REMOTE,
+                 WORKER_GMT_PUT_RMA, WORKER_GMT_GET_RMA,
+                 AGGREGATION_CTRL_CMD, AGGREGATION_CTRL_BUFF,
+                 AGGREGATION_CTRL_WAIT, AGGREGATION_SG_BYTES,
+                 HELPER_CMD_REPLY_ACK_BATCH, HELPER_ACKS_COALESCED,
+                 AGGREGATION_COMB_CMDS, AGGREGATION_COMB_HITS,
+                 AGGREGATION_ROUTE_CMDS, HELPER_CMD_ROUTE,
+                 HELPER_RECV_BUFF_RELEASED,
+                 WORKER_GMT_GATHER_REMOTE, HELPER_CMD_GATHER,
+                 HELPER_CMD_REPLY_GATHER,
+                 WORKER_GMT_SCATTER_REMOTE, HELPER_CMD_SCATTER,
+                 WORKER_GMT_ATOMIC_OP_LOCAL, WORKER_GMT_ATOMIC_OP_REMOTE,
+                 HELPER_CMD_ATOMIC_OP,
+                 WORKER_GMT_ATOMIC_NOFETCH_REMOTE, HELPER_CMD_ATOMIC_NOFETCH,
+                 WORKER_GMT_QUIET_QUERIES, HELPER_CMD_QUIET,
+                 AGGREGATION_ADAPT_UPDATES, AGGREGATION_ADAPT_TICKS,
+                 AGGREGATION_ADAPT_LATENCY,
+                 IDLE_SPIN_CYCLES, IDLE_PARK_CYCLES, IDLE_PARKS,
                  /*        
                     WORKER_WAIT_DATA,
                     WORKER_WAIT_MTASKS,
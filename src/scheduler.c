@@ -70,6 +70,7 @@ void *scheduler_loop(void *)
         ++scheduler.pop_hits;
 #endif
         sched_queue_push(&mtm.mtasks_sched_out_queues[buf->qid], buf);
+        idle_wake(&mtm.idle);
 	}
 	else {
 #ifdef TRACE_QUEUES
@@ -91,7 +92,8 @@ void scheduler_run()
 
   /* set stack address for this worker */
   void *stack_addr =
-      (void *)((uint64_t)pt_stacks + (NUM_WORKERS + NUM_HELPERS + 1) * PTHREAD_STACK_SIZE);
+      (void *)((uint64_t)pt_stacks + (NUM_WORKERS + NUM_HELPERS +
+                NUM_COMM_SERVERS) * PTHREAD_STACK_SIZE);
 
   int ret = pthread_attr_setstack(&attr, stack_addr, PTHREAD_STACK_SIZE);
   if (ret)
@@ -41,8 +41,8 @@ cpu_set_t * workers_cpuset; // array of the computed cpusets for each worker (as
 hwloc_cpuset_t * helpers_cpuset_hwloc; // array of the computed cpusets for each helper (hwloc)
 cpu_set_t * helpers_cpuset; // array of the computed cpusets for each helper (as per sched.h of libc)
 
-hwloc_cpuset_t communicator_cpuset_hwloc; // cpuset of the communicator server (hwloc)
-cpu_set_t * communicator_cpuset; // cpuset of the communicator server (as per sched.h of libc)
+hwloc_cpuset_t * communicator_cpuset_hwloc; // array of the computed cpusets for each communication server (hwloc)
+cpu_set_t * communicator_cpuset; // array of the computed cpusets for each communication server (as per sched.h of libc)
 
 uint32_t available_cores; // number of physical cores available in the system (does not count hyperthreading)
 hwloc_topology_t topology; // topology of the current system
@@ -216,8 +216,8 @@ uint32_t get_num_cores_hwloc(){
     -   communicator_cpuset[_hwloc]
 */
 void affinity_masks_init(){
-    if(config.num_cores  < config.num_workers + config.num_helpers + 1 || config.num_cores < 3 ){ // not enough cores for gmt (1 worker + 1 helper + 1 comm_server)
-        printf("ERROR: The current configuration is not valid. Workers=%d, Helpers=%d, Comm_server=1 but available_cores=%d\n", config.num_workers, config.num_helpers, available_cores);
+    if(config.num_cores  < config.num_workers + config.num_helpers + config.num_comm_servers || config.num_cores < 3 ){ // not enough cores for gmt (1 worker + 1 helper + 1 comm_server)
+        printf("ERROR: The current configuration is not valid. Workers=%d, Helpers=%d, Comm_servers=%d but available_cores=%d\n", config.num_workers, config.num_helpers, config.num_comm_servers, available_cores);
         exit(-1);  // not enough cores
     }
 
@@ -226,7 +226,8 @@ void affinity_masks_init(){
     workers_cpuset = (cpu_set_t*) malloc(sizeof(cpu_set_t) * config.num_workers );
     helpers_cpuset_hwloc = (hwloc_cpuset_t*) malloc(sizeof(hwloc_cpuset_t) * config.num_helpers);
     helpers_cpuset = (cpu_set_t*) malloc(sizeof(cpu_set_t) * config.num_helpers );
-    communicator_cpuset = (cpu_set_t*) malloc(sizeof(cpu_set_t) * 1);
+    communicator_cpuset_hwloc = (hwloc_cpuset_t*) malloc(sizeof(hwloc_cpuset_t) * config.num_comm_servers);
+    communicator_cpuset = (cpu_set_t*) malloc(sizeof(cpu_set_t) * config.num_comm_servers);
 
     /* 
         to print the current setup
@@ -234,14 +235,18 @@ void affinity_masks_init(){
         i.e. if we have two workers and those two workers are pinned to a single core
         the "complete_workers" is a mask containing the two cores
     */
+    hwloc_cpuset_t complete_comm_servers;
     hwloc_cpuset_t complete_workers;
     hwloc_cpuset_t complete_helpers; 
     hwloc_cpuset_t complete_wasted;
     
     if(config.affinity_policy_id == NO_SMT_POLICY){
         // helpers/workers/comm_server will all point to the same cpuset (i.e. the process cpuset removed of SMT cores)
-        communicator_cpuset_hwloc = hwloc_bitmap_dup(current_process_cpuset_hwloc);
-        hwloc_cpuset_to_glibc_sched_affinity(topology, communicator_cpuset_hwloc, communicator_cpuset, sizeof(cpu_set_t));
+        for(uint32_t i=0; i<config.num_comm_servers; i++){
+            communicator_cpuset_hwloc[i] = hwloc_bitmap_dup(current_process_cpuset_hwloc);
+            hwloc_cpuset_to_glibc_sched_affinity(topology, communicator_cpuset_hwloc[i], &communicator_cpuset[i], sizeof(cpu_set_t));
+        }
+        complete_comm_servers = hwloc_bitmap_dup(current_process_cpuset_hwloc);
         
         for(int i=0; i<config.num_workers; i++){
             workers_cpuset_hwloc[i] = hwloc_bitmap_dup(current_process_cpuset_hwloc);
@@ -260,13 +265,18 @@ void affinity_masks_init(){
         hwloc_bitmap_zero(complete_wasted);
 
     }else if(config.affinity_policy_id == PIN_POLICY){
-        // Compute the optimal position of the communication server i.e. near the fastest network interface
-        communicator_cpuset_hwloc = near_network(current_process_cpuset_hwloc);
-        hwloc_cpuset_to_glibc_sched_affinity(topology, communicator_cpuset_hwloc, communicator_cpuset, sizeof(cpu_set_t));
-
-        // compute the remaining cpuset after assining the communicator server
-        auto remaining_cpuset_hwloc = hwloc_bitmap_alloc();
-        hwloc_bitmap_andnot(remaining_cpuset_hwloc, current_process_cpuset_hwloc, communicator_cpuset_hwloc);
+        // Compute the optimal position of the communication servers i.e. near the fastest network interface,
+        // each server takes the closest core among the ones not yet assigned
+        auto remaining_cpuset_hwloc = hwloc_bitmap_dup(current_process_cpuset_hwloc);
+        complete_comm_servers = hwloc_bitmap_alloc();
+        for(uint32_t i=0; i<config.num_comm_servers; i++){
+            communicator_cpuset_hwloc[i] = near_network(remaining_cpuset_hwloc);
+            hwloc_cpuset_to_glibc_sched_affinity(topology, communicator_cpuset_hwloc[i], &communicator_cpuset[i], sizeof(cpu_set_t));
+            hwloc_bitmap_or(complete_comm_servers, complete_comm_servers, communicator_cpuset_hwloc[i]);
+
+            // compute the remaining cpuset after assining the communicator server
+            hwloc_bitmap_andnot(remaining_cpuset_hwloc, remaining_cpuset_hwloc, communicator_cpuset_hwloc[i]);
+        }
 
         unsigned int id;
         int array_index=0;
@@ -307,7 +317,7 @@ void affinity_masks_init(){
 
     // print the computed configuration
     char * core_comm_server, *cores_workers, *cores_helpers, *cores_wasted, *cores_currentproc;
-    hwloc_bitmap_list_asprintf(&core_comm_server, communicator_cpuset_hwloc);
+    hwloc_bitmap_list_asprintf(&core_comm_server, complete_comm_servers);
     hwloc_bitmap_list_asprintf(&cores_currentproc, current_process_cpuset_hwloc);
     hwloc_bitmap_list_asprintf(&cores_wasted, complete_wasted);
     hwloc_bitmap_list_asprintf(&cores_workers, complete_workers);
@@ -357,16 +367,16 @@ void set_thread_affinity(uint32_t tid)
 }
 
 /* 
-    This function is used to pin the communication server to the core closest to the network interface (previously computed).
+    This function is used to pin a communication server to the core closest to the network interface (previously computed).
 */
-void comm_server_set_thread_affinity(){
+void comm_server_set_thread_affinity(uint32_t csid){
     if(node_id==0){
         char* cpuset;
-        hwloc_bitmap_list_asprintf(&cpuset, communicator_cpuset_hwloc);
-        DEBUG0(printf("#   Node[%d]: PIN [get_thread_id: %d, gettid:%d, pthread_id:%lu] TO CORE %s (COMM_SERVER) \n", node_id, get_thread_id(), syscall(SYS_gettid), pthread_self(), cpuset););
+        hwloc_bitmap_list_asprintf(&cpuset, communicator_cpuset_hwloc[csid]);
+        DEBUG0(printf("#   Node[%d]: PIN [get_thread_id: %d, gettid:%d, pthread_id:%lu] TO CORE %s (COMM_SERVER %u) \n", node_id, get_thread_id(), syscall(SYS_gettid), pthread_self(), cpuset, csid););
     }
 
-    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), communicator_cpuset)) {
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &communicator_cpuset[csid])) {
         printf("Error setting affinity\n");
     }
 }
@@ -229,6 +229,8 @@ void uthread_init(int tid, int wid)
     uthreads[tid].wid = wid;
     uthreads[tid].req_nbytes = 0;
     uthreads[tid].recv_nbytes = 0;
+    uthreads[tid].rma_pending = false;
+    uthreads[tid].nofetch_pending = false;
     uthreads[tid].created_mtasks = (uint64_t *)_malloc(MAX_NESTING * sizeof(uint64_t));
     uthreads[tid].terminated_mtasks = (uint64_t *)_malloc(MAX_NESTING * sizeof(uint64_t));
     uthreads[tid].mt = NULL;
@@ -59,6 +59,8 @@ volatile bool workers_stop_flag;
 /* worker array */
 worker_t *workers;
 
+volatile uint64_t *workers_nf_confirmed;
+
 extern uint32_t prime_numbers[1000];
 
 void worker_team_init()
@@ -79,8 +81,12 @@ void worker_team_init()
 
         workers[i].cnt_mtasks_check = 0;
         workers[i].tick_cmdb_timeout = rdtsc();
+        backoff_init(&workers[i].backoff);
+        workers[i].num_waiting = 0;
         workers[i].cnt_print_sched = 0;
         workers[i].rr_cnt = 0;
+        workers[i].nf_issued =
+            (volatile uint64_t *)_calloc(num_nodes, sizeof(uint64_t));
 
 #if !DTA
         workers[i].num_mt_res = 0;
@@ -102,6 +108,9 @@ void worker_team_init()
         }
     }
 
+    workers_nf_confirmed =
+        (volatile uint64_t *)_calloc(num_nodes, sizeof(uint64_t));
+
     /* set stop flag to true as workers have not started yet */
     workers_stop_flag = true;
 }
@@ -193,8 +202,17 @@ void *worker_loop(void *args)
         }
     }
 
-    while (!workers_stop_flag)
+    while (!workers_stop_flag) {
         worker_schedule(-1, thread_id);
+        /* idle when no uthread is alive, park only if there is no command
+         * block to flush at timeout */
+        backoff_t *bo = &workers[wid].backoff;
+        if (uthread_queue_size(&workers[wid].uthread_queue) == 0)
+            idle_miss(&mtm.idle, bo, idle_may_park(bo) &&
+                      agm_is_idle(wid, 0, 0));
+        else
+            idle_reset(bo);
+    }
 
     /* free stack used during segmentation fault */
     free(segv_stack.ss_sp);
@@ -235,6 +253,7 @@ void worker_team_stop()
 {
     while (workers_stop_flag) ;
     workers_stop_flag = true;
+    idle_wake(&mtm.idle);
 }
 
 void worker_team_destroy()
@@ -300,7 +319,9 @@ void worker_team_destroy()
         free(workers[i].mt_res);
         free(workers[i].mt_ret);
 #endif
+        free((void *)workers[i].nf_issued);
     }
+    free((void *)workers_nf_confirmed);
 
     uthread_destroy_all();
     free(workers);
@@ -365,8 +386,8 @@ void worker_task_wrapper(uint32_t start_it_L32, uint32_t start_it_H32)
             uint64_t its = MIN(mt.step_it, mt.end_it - start_it);
             //  GMT_DEBUG_PRINTF("start_it %lu end_it %lu step_it %u\n", 
             //  start_it, (uint64_t)mt.end_it, (uint64_t)mt.step_it);
-            worker_do_for(mt.func, start_it, its, mt.args, mt.gmt_array,
-                          mt.handle);
+            worker_do_for(mt.func, node_id, start_it, its, mt.args,
+                          mt.gmt_array, mt.handle);
             uint64_t ret = __sync_add_and_fetch(&ut->mt->executed_it, its);
             if (ret == mt.end_it) {
                 if (mt.handle != GMT_HANDLE_NULL)
@@ -0,0 +1,130 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Contention benchmark of the aggregation queues. Every worker of every node
+ * runs tasks that issue small non blocking commands (put_value and 
+ * atomic_add) to the elements of a few hot nodes, so that all the workers 
+ * fill command blocks for the same destinations at the same time.
+ *
+ * Usage:
+ *   mpirun -n <nodes> ./bench_aggregation -t <tasks> -n <ops per task>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+
+#define ELEMS_PER_NODE 4096
+
+typedef struct bench_args_t {
+    gmt_data_t array;
+    uint64_t num_ops;
+    uint32_t hot_nodes;
+} bench_args_t;
+
+void bench_task(uint64_t it, uint64_t num, const void *args,
+                gmt_handle_t handle)
+{
+    _unused(handle);
+    const bench_args_t *a = (const bench_args_t *)args;
+    uint32_t nid = gmt_node_id();
+    uint32_t nn = gmt_num_nodes();
+    uint64_t i;
+    for (i = 0; i < num * a->num_ops; i++) {
+        /* one of the hot nodes, skipping this one */
+        uint32_t rnid = (uint32_t) ((it + i) % a->hot_nodes);
+        if (rnid == nid)
+            rnid = (rnid + a->hot_nodes) % nn;
+        uint64_t offset = rnid * ELEMS_PER_NODE + (it * 31 + i) %
+            ELEMS_PER_NODE;
+        if (i & 1)
+            gmt_atomic_add_nb(a->array, offset, 1, NULL);
+        else
+            gmt_put_value_nb(a->array, offset, it);
+    }
+    gmt_wait_data();
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t num_tasks = 1024;
+    bench_args_t args;
+    args.num_ops = 1024;
+    args.hot_nodes = 2;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "t:n:h:")) != -1) {
+        switch (c) {
+        case 't':
+            num_tasks = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            args.num_ops = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            args.hot_nodes = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: %s -t <tasks> -n <ops per task> "
+                   "-h <hot nodes>\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint32_t nn = gmt_num_nodes();
+    if (nn < 2) {
+        printf("bench_aggregation needs at least 2 nodes\n");
+        return 1;
+    }
+    if (args.hot_nodes == 0 || args.hot_nodes > nn)
+        args.hot_nodes = nn;
+
+    args.array = gmt_alloc(nn * ELEMS_PER_NODE, sizeof(uint64_t),
+                           GMT_ALLOC_PARTITION_FROM_ZERO, NULL);
+
+    double start = gmt_timer();
+    gmt_for_loop(num_tasks, 1, bench_task, &args, sizeof(args),
+                 GMT_SPAWN_SPREAD);
+    double end = gmt_timer();
+
+    uint64_t ops = num_tasks * args.num_ops;
+    printf("nodes %u workers %u hot nodes %u tasks %lu ops %lu\n", nn,
+           gmt_num_workers(), args.hot_nodes, num_tasks, ops);
+    printf("time %f sec - %f Mops/sec\n", end - start,
+           ops / (end - start) / 1e6);
+
+    gmt_free(args.array);
+    return 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* Random min and floating point add updates, as in label propagation or 
+ * PageRank, issued by tasks spread over all the nodes. The same updates are
+ * applied once with the usual gmt_atomic_cas() retry loop and once with 
+ * gmt_atomic_op_nb() / gmt_atomic_fadd_nb(), which need a single command 
+ * for each update. Integer adds and mins are also applied with the
+ * non-fetching calls, which are not acknowledged one by one, against
+ * gmt_atomic_add_nb() with no return value. Every pass is timed and checked.
+ *
+ *   mpirun -n <nodes> ./bench_atomic_op -n <updates> -e <elems per node> \
+ *          -s <updates per task>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+
+typedef enum bench_mode_t {
+    CAS_MIN, OP_MIN, NOFETCH_MIN, CAS_FADD, OP_FADD, ACK_ADD, NOFETCH_ADD
+} bench_mode_t;
+
+typedef struct bench_args_t {
+    gmt_data_t array;
+    uint64_t total;
+    bench_mode_t mode;
+} bench_args_t;
+
+static uint64_t splitmix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* update k changes element offset(k) by value(k), small integers keep the
+ * floating point sums exact in any order */
+static uint64_t upd_offset(uint64_t k, uint64_t total)
+{
+    return splitmix(k) % total;
+}
+
+static int64_t upd_value(uint64_t k)
+{
+    return (int64_t) (splitmix(~k) % 1000000) - 500000;
+}
+
+static void cas_min(gmt_data_t array, uint64_t offset, int64_t value)
+{
+    int64_t old = gmt_atomic_cas(array, offset, INT64_MAX, value);
+    while (value < old) {
+        int64_t cur = gmt_atomic_cas(array, offset, old, value);
+        if (cur == old)
+            break;
+        old = cur;
+    }
+}
+
+static void cas_fadd(gmt_data_t array, uint64_t offset, double value)
+{
+    /* all bits zero is 0.0 */
+    int64_t old = gmt_atomic_cas(array, offset, 0, 0);
+    while (true) {
+        double old_d, new_d;
+        int64_t new_bits;
+        memcpy(&old_d, &old, sizeof(old_d));
+        new_d = old_d + value;
+        memcpy(&new_bits, &new_d, sizeof(new_bits));
+        int64_t cur = gmt_atomic_cas(array, offset, old, new_bits);
+        if (cur == old)
+            break;
+        old = cur;
+    }
+}
+
+void bench_task(uint64_t it, uint64_t num, const void *args,
+                gmt_handle_t handle)
+{
+    _unused(handle);
+    const bench_args_t *a = (const bench_args_t *)args;
+    uint64_t k;
+    for (k = it; k < it + num; k++) {
+        uint64_t offset = upd_offset(k, a->total);
+        int64_t value = upd_value(k);
+        switch (a->mode) {
+        case CAS_MIN:
+            cas_min(a->array, offset, value);
+            break;
+        case OP_MIN:
+            gmt_atomic_op_nb(a->array, offset, GMT_ATOMIC_MIN, value, NULL);
+            break;
+        case NOFETCH_MIN:
+            gmt_atomic_op_nofetch_nb(a->array, offset, GMT_ATOMIC_MIN, value);
+            break;
+        case CAS_FADD:
+            cas_fadd(a->array, offset, (double) value);
+            break;
+        case OP_FADD:
+            gmt_atomic_fadd_nb(a->array, offset, (double) value, NULL);
+            break;
+        case ACK_ADD:
+            gmt_atomic_add_nb(a->array, offset, value, NULL);
+            break;
+        case NOFETCH_ADD:
+            gmt_atomic_add_nofetch_nb(a->array, offset, value);
+            break;
+        }
+    }
+    gmt_wait_data();
+}
+
+static void reset(gmt_data_t array, uint64_t total, int64_t value)
+{
+    int64_t *init = (int64_t *) malloc(total * sizeof(int64_t));
+    uint64_t i;
+    for (i = 0; i < total; i++)
+        init[i] = value;
+    gmt_put(array, 0, init, total);
+    free(init);
+}
+
+/* elements that differ from expected, compared bit by bit */
+static uint64_t check(gmt_data_t array, const int64_t * expected,
+                      uint64_t total)
+{
+    int64_t *values = (int64_t *) malloc(total * sizeof(int64_t));
+    gmt_get(array, 0, values, total);
+    uint64_t i, bad = 0;
+    for (i = 0; i < total; i++)
+        if (values[i] != expected[i])
+            bad++;
+    free(values);
+    return bad;
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t num_upd = 1 << 18;
+    uint64_t elems = 1 << 12;
+    uint32_t step = 64;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "n:e:s:")) != -1) {
+        switch (c) {
+        case 'n':
+            num_upd = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            elems = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            step = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: %s -n <updates> -e <elems per node> "
+                   "-s <updates per task>\n", argv[0]);
+            return 1;
+        }
+    }
+    if (step == 0)
+        step = 1;
+
+    uint32_t nn = gmt_num_nodes();
+    bench_args_t args;
+    args.total = nn * elems;
+    args.array = gmt_alloc(args.total, sizeof(int64_t),
+                           GMT_ALLOC_PARTITION_FROM_ZERO, NULL);
+
+    int64_t *exp_min = (int64_t *) malloc(args.total * sizeof(int64_t));
+    double *exp_sum = (double *) calloc(args.total, sizeof(double));
+    int64_t *exp_add = (int64_t *) calloc(args.total, sizeof(int64_t));
+    uint64_t i;
+    for (i = 0; i < args.total; i++)
+        exp_min[i] = INT64_MAX;
+    for (i = 0; i < num_upd; i++) {
+        uint64_t offset = upd_offset(i, args.total);
+        if (upd_value(i) < exp_min[offset])
+            exp_min[offset] = upd_value(i);
+        exp_sum[offset] += (double) upd_value(i);
+        exp_add[offset] += upd_value(i);
+    }
+
+    const char *names[] = { "cas min", "op min", "nf min", "cas fadd",
+        "op fadd", "ack add", "nf add" };
+    int m;
+    for (m = CAS_MIN; m <= NOFETCH_ADD; m++) {
+        args.mode = (bench_mode_t) m;
+        bool is_min = (m == CAS_MIN || m == OP_MIN || m == NOFETCH_MIN);
+        const int64_t *expected = is_min ? exp_min :
+            (m == CAS_FADD || m == OP_FADD) ? (int64_t *) exp_sum : exp_add;
+        reset(args.array, args.total, is_min ? INT64_MAX : 0);
+        double start = gmt_timer();
+        gmt_for_loop(num_upd, step, bench_task, &args, sizeof(args),
+                     GMT_SPAWN_SPREAD);
+        double end = gmt_timer();
+        uint64_t errors = check(args.array, expected, args.total);
+        printf("%-8s nodes %u updates %lu time %f sec - %f Mupdates/sec - "
+               "errors %lu\n", names[m], nn, num_upd, end - start,
+               num_upd / (end - start) / 1e6, errors);
+    }
+
+    free(exp_min);
+    free(exp_sum);
+    free(exp_add);
+    gmt_free(args.array);
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Named array lookups. For each array count c = 64, 256, ... up to n, c
+ * named arrays are allocated, attached by name and freed, and the three
+ * phases are timed. When started with a writable GMT state every named 
+ * allocation also checks that the name is not already in the state.
+ *
+ *   mpirun -n <nodes> ./bench_attach -n <max arrays> \
+ *          [--gmt_state_name <state> --gmt_state_rw]
+ *
+ * State restore: -k allocates n named arrays on shared memory and leaves 
+ * them in the state, a later run with -r times the attach of the restored
+ * arrays and frees them (time the whole run to include the restore done at
+ * startup).
+ *
+ *   mpirun -n 1 ./bench_attach -k -n <arrays> --gmt_state_name s --gmt_state_rw
+ *   time mpirun -n 1 ./bench_attach -r -n <arrays> --gmt_state_name s \
+ *          --gmt_state_rw
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+
+#define NAME_LEN 48
+
+static void array_name(char *name, uint64_t i)
+{
+    snprintf(name, NAME_LEN, "bench_attach_%lu", i);
+}
+
+static uint64_t attach_all(const gmt_data_t * arrays, uint64_t num)
+{
+    char name[NAME_LEN];
+    uint64_t i, bad = 0;
+    for (i = 0; i < num; i++) {
+        array_name(name, i);
+        gmt_data_t a = gmt_attach(name);
+        if (a == GMT_DATA_NULL || (arrays != NULL && a != arrays[i]))
+            bad++;
+    }
+    return bad;
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t max_arrays = 4096;
+    bool keep = false, restored = false;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "n:kr")) != -1) {
+        switch (c) {
+        case 'n':
+            max_arrays = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            keep = true;
+            break;
+        case 'r':
+            restored = true;
+            break;
+        default:
+            printf("usage: %s -n <max arrays> [-k | -r]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char name[NAME_LEN];
+    uint64_t i;
+    gmt_data_t *arrays = (gmt_data_t *) malloc(max_arrays * sizeof(gmt_data_t));
+
+    if (keep) {
+        for (i = 0; i < max_arrays; i++) {
+            array_name(name, i);
+            arrays[i] = gmt_alloc_nb(1, sizeof(uint64_t), GMT_ALLOC_SHM, name);
+        }
+        gmt_wait_data();
+        printf("kept %lu named arrays in the state\n", max_arrays);
+        free(arrays);
+        return 0;
+    }
+
+    if (restored) {
+        double start = gmt_timer();
+        uint64_t bad = attach_all(NULL, max_arrays);
+        double end = gmt_timer();
+        printf("restored arrays %lu attach %f sec - %f usec/attach - "
+               "errors %lu\n", max_arrays, end - start,
+               (end - start) * 1e6 / max_arrays, bad);
+        for (i = 0; i < max_arrays; i++) {
+            array_name(name, i);
+            gmt_free(gmt_attach(name));
+        }
+        free(arrays);
+        return 0;
+    }
+
+    uint64_t num;
+    for (num = 64; num <= max_arrays; num *= 4) {
+        double start = gmt_timer();
+        for (i = 0; i < num; i++) {
+            array_name(name, i);
+            arrays[i] = gmt_alloc_nb(1, sizeof(uint64_t), GMT_ALLOC_LOCAL,
+                                     name);
+        }
+        gmt_wait_data();
+        double t_alloc = gmt_timer() - start;
+
+        start = gmt_timer();
+        uint64_t bad = attach_all(arrays, num);
+        double t_attach = gmt_timer() - start;
+
+        start = gmt_timer();
+        for (i = 0; i < num; i++)
+            gmt_free(arrays[i]);
+        double t_free = gmt_timer() - start;
+
+        printf("arrays %6lu alloc %f sec - attach %f sec (%f usec/attach) - "
+               "free %f sec - errors %lu\n", num, t_alloc, t_attach,
+               t_attach * 1e6 / num, t_free, bad);
+    }
+
+    free(arrays);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Wire size of the command encodings. A GUPS-like stream of random updates
+ * from this node is encoded into per destination command blocks twice, once
+ * with the fixed packed structs and once with the compact encoding, and the
+ * bytes per operation of each are reported. Then the updates are really
+ * issued as non blocking atomic adds to time them.
+ *
+ * Compare the timed part with and without the compact encoding:
+ *   mpirun -n <nodes> ./bench_cmd_encoding -n <updates> -e <elems per node>
+ *   mpirun -n <nodes> ./bench_cmd_encoding -n <updates> -e <elems per node> \
+ *          --gmt_compact_cmds
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+#include "gmt/commands.h"
+#include "gmt/aggregation.h"
+
+typedef struct enc_block_t {
+    uint8_t cmds[CMD_C_MAX_BYTES];
+    uint32_t bytes;
+    cmd_c_state_t st;
+} enc_block_t;
+
+static uint64_t xorshift(uint64_t * s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/* bytes on the wire for num_ops updates of type, fixed_size is the size 
+ * of the packed struct of the same command. Returns the remote updates */
+static uint64_t encode_stream(gmt_data_t array, uint64_t elems, uint64_t num_ops,
+                          uint8_t type, uint32_t fixed_size,
+                          uint64_t * fixed_bytes, uint64_t * compact_bytes)
+{
+    uint32_t nn = gmt_num_nodes();
+    uint32_t nid = gmt_node_id();
+    enc_block_t *blocks = (enc_block_t *) calloc(nn, sizeof(enc_block_t));
+    uint64_t *fixed_used = (uint64_t *) calloc(nn, sizeof(uint64_t));
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    uint64_t i, remote = 0;
+
+    *fixed_bytes = 0;
+    *compact_bytes = 0;
+    for (i = 0; i < nn; i++)
+        cmd_c_state_reset(&blocks[i].st);
+
+    for (i = 0; i < num_ops; i++) {
+        uint64_t idx = xorshift(&seed) % (nn * elems);
+        uint32_t rnid = (uint32_t) (idx / elems);
+        if (rnid == nid)
+            continue;
+        uint64_t offset = (idx % elems) * sizeof(uint64_t);
+        remote++;
+
+        /* fixed size commands, one block_info every full block */
+        if (fixed_used[rnid] + fixed_size > CMD_BLOCK_SIZE) {
+            *fixed_bytes += sizeof(block_info_t);
+            fixed_used[rnid] = 0;
+        }
+        fixed_used[rnid] += fixed_size;
+        *fixed_bytes += fixed_size;
+
+        /* compact commands, the encoder state restarts with each block */
+        enc_block_t *b = &blocks[rnid];
+        if (b->bytes + CMD_C_MAX_BYTES > CMD_BLOCK_SIZE) {
+            *compact_bytes += sizeof(block_info_t);
+            b->bytes = 0;
+            cmd_c_state_reset(&b->st);
+        }
+        uint64_t value = (type == GMT_CMD_ATOMIC_ADD_C) ? cmd_zigzag(1) : i;
+        uint32_t n = cmd_c_encode(b->cmds, &b->st, type, 0, array, offset,
+                                  value, 0);
+        b->bytes += n;
+        *compact_bytes += n;
+    }
+    for (i = 0; i < nn; i++) {
+        if (fixed_used[i] > 0)
+            *fixed_bytes += sizeof(block_info_t);
+        if (blocks[i].bytes > 0)
+            *compact_bytes += sizeof(block_info_t);
+    }
+    free(blocks);
+    free(fixed_used);
+    return remote;
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t num_ops = 1 << 20;
+    uint64_t elems = 1 << 16;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "n:e:")) != -1) {
+        switch (c) {
+        case 'n':
+            num_ops = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            elems = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: %s -n <updates> -e <elems per node>\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint32_t nn = gmt_num_nodes();
+    if (nn < 2) {
+        printf("bench_cmd_encoding needs at least 2 nodes\n");
+        return 1;
+    }
+    gmt_data_t array = gmt_alloc(nn * elems, sizeof(uint64_t),
+                                 GMT_ALLOC_PARTITION_FROM_ZERO, NULL);
+
+    uint64_t fixed, compact, remote;
+    remote = encode_stream(array, elems, num_ops, GMT_CMD_ATOMIC_ADD_C,
+                           sizeof(cmd_atomic_add_t), &fixed, &compact);
+    printf("atomic_add  bytes/op fixed %.2f compact %.2f\n",
+           (double)fixed / remote, (double)compact / remote);
+    remote = encode_stream(array, elems, num_ops, GMT_CMD_PUT_VALUE_C,
+                           sizeof(cmd_put_value_t), &fixed, &compact);
+    printf("put_value   bytes/op fixed %.2f compact %.2f\n",
+           (double)fixed / remote, (double)compact / remote);
+
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    uint64_t i;
+    double start = gmt_timer();
+    for (i = 0; i < num_ops; i++)
+        gmt_atomic_add_nb(array, xorshift(&seed) % (nn * elems), 1, NULL);
+    gmt_wait_data();
+    double end = gmt_timer();
+    printf("nodes %u updates %lu time %f sec - %f Mops/sec\n", nn, num_ops,
+           end - start, num_ops / (end - start) / 1e6);
+
+    gmt_free(array);
+    return 0;
+}
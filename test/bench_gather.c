@@ -0,0 +1,142 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Random reads of single elements, as in neighbour lookups of graph codes.
+ * The same random offsets are read once with one gmt_get_nb() for each 
+ * element and once with gmt_gather_nb() in batches of b elements, both are
+ * timed and checked.
+ *
+ *   mpirun -n <nodes> ./bench_gather -n <reads> -e <elems per node> \
+ *          -b <batch>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+
+static uint64_t xorshift(uint64_t * s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static uint64_t check(const uint64_t * offsets, const uint64_t * values,
+                      uint64_t num)
+{
+    uint64_t i, bad = 0;
+    for (i = 0; i < num; i++)
+        if (values[i] != offsets[i])
+            bad++;
+    return bad;
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t num_reads = 1 << 20;
+    uint64_t elems = 1 << 16;
+    uint64_t batch = 1024;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "n:e:b:")) != -1) {
+        switch (c) {
+        case 'n':
+            num_reads = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            elems = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            batch = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: %s -n <reads> -e <elems per node> -b <batch>\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (batch == 0 || batch > num_reads)
+        batch = num_reads;
+
+    uint32_t nn = gmt_num_nodes();
+    uint64_t total = nn * elems;
+    gmt_data_t array = gmt_alloc(total, sizeof(uint64_t),
+                                 GMT_ALLOC_PARTITION_FROM_ZERO, NULL);
+
+    /* element i holds i */
+    uint64_t *init = (uint64_t *) malloc(total * sizeof(uint64_t));
+    uint64_t i;
+    for (i = 0; i < total; i++)
+        init[i] = i;
+    gmt_put(array, 0, init, total);
+    free(init);
+
+    uint64_t *offsets = (uint64_t *) malloc(num_reads * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *) malloc(num_reads * sizeof(uint64_t));
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (i = 0; i < num_reads; i++)
+        offsets[i] = xorshift(&seed) % total;
+
+    memset(values, 0, num_reads * sizeof(uint64_t));
+    double start = gmt_timer();
+    for (i = 0; i < num_reads; i++)
+        gmt_get_nb(array, offsets[i], &values[i], 1);
+    gmt_wait_data();
+    double end = gmt_timer();
+    printf("get_nb    nodes %u reads %lu time %f sec - %f Mreads/sec - "
+           "errors %lu\n", nn, num_reads, end - start,
+           num_reads / (end - start) / 1e6,
+           check(offsets, values, num_reads));
+
+    memset(values, 0, num_reads * sizeof(uint64_t));
+    start = gmt_timer();
+    for (i = 0; i < num_reads; i += batch) {
+        uint64_t n = (num_reads - i < batch) ? num_reads - i : batch;
+        gmt_gather_nb(array, &offsets[i], n, &values[i]);
+    }
+    gmt_wait_data();
+    end = gmt_timer();
+    printf("gather_nb nodes %u reads %lu batch %lu time %f sec - "
+           "%f Mreads/sec - errors %lu\n", nn, num_reads, batch, end - start,
+           num_reads / (end - start) / 1e6,
+           check(offsets, values, num_reads));
+
+    free(offsets);
+    free(values);
+    gmt_free(array);
+    return 0;
+}
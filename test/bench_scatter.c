@@ -0,0 +1,179 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* Random updates of single elements, as in histograms or GUPS. The same 
+ * random offsets are updated once with one gmt_atomic_add_nb() for each 
+ * element and once with gmt_scatter_add_nb() in batches of b elements, then
+ * written with gmt_put_value_nb() and with gmt_scatter_nb(). Every pass is 
+ * timed and checked.
+ *
+ *   mpirun -n <nodes> ./bench_scatter -n <updates> -e <elems per node> \
+ *          -b <batch>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gmt/gmt.h"
+
+static uint64_t xorshift(uint64_t * s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/* elements that differ from expected */
+static uint64_t check(gmt_data_t array, const uint64_t * expected,
+                      uint64_t total)
+{
+    uint64_t *values = (uint64_t *) malloc(total * sizeof(uint64_t));
+    gmt_get(array, 0, values, total);
+    uint64_t i, bad = 0;
+    for (i = 0; i < total; i++)
+        if (values[i] != expected[i])
+            bad++;
+    free(values);
+    return bad;
+}
+
+static void print_time(const char *name, uint32_t nn, uint64_t num,
+                       uint64_t batch, double time, uint64_t errors)
+{
+    printf("%-14s nodes %u updates %lu batch %lu time %f sec - "
+           "%f Mupdates/sec - errors %lu\n", name, nn, num, batch, time,
+           num / time / 1e6, errors);
+}
+
+int gmt_main(uint64_t argc, char *argv[])
+{
+    uint64_t num_upd = 1 << 20;
+    uint64_t elems = 1 << 16;
+    uint64_t batch = 1024;
+
+    int c;
+    while ((c = getopt((int)argc, argv, "n:e:b:")) != -1) {
+        switch (c) {
+        case 'n':
+            num_upd = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            elems = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            batch = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: %s -n <updates> -e <elems per node> -b <batch>\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (batch == 0 || batch > num_upd)
+        batch = num_upd;
+
+    uint32_t nn = gmt_num_nodes();
+    uint64_t total = nn * elems;
+    gmt_data_t array = gmt_alloc(total, sizeof(uint64_t),
+                                 (alloc_type_t) (GMT_ALLOC_PARTITION_FROM_ZERO
+                                                 | GMT_ALLOC_ZERO), NULL);
+
+    uint64_t *offsets = (uint64_t *) malloc(num_upd * sizeof(uint64_t));
+    int64_t *ones = (int64_t *) malloc(num_upd * sizeof(int64_t));
+    uint64_t *expected = (uint64_t *) calloc(total, sizeof(uint64_t));
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    uint64_t i;
+    for (i = 0; i < num_upd; i++) {
+        offsets[i] = xorshift(&seed) % total;
+        ones[i] = 1;
+        expected[offsets[i]]++;
+    }
+
+    double start = gmt_timer();
+    for (i = 0; i < num_upd; i++)
+        gmt_atomic_add_nb(array, offsets[i], 1, NULL);
+    gmt_wait_data();
+    double end = gmt_timer();
+    print_time("atomic_add_nb", nn, num_upd, 1, end - start,
+               check(array, expected, total));
+
+    /* counts double */
+    start = gmt_timer();
+    for (i = 0; i < num_upd; i += batch) {
+        uint64_t n = (num_upd - i < batch) ? num_upd - i : batch;
+        gmt_scatter_add_nb(array, &offsets[i], &ones[i], n);
+    }
+    gmt_wait_data();
+    end = gmt_timer();
+    for (i = 0; i < total; i++)
+        expected[i] *= 2;
+    print_time("scatter_add_nb", nn, num_upd, batch, end - start,
+               check(array, expected, total));
+
+    /* every updated element is written with its own offset, repeated 
+     * offsets write the same value so the order does not matter */
+    for (i = 0; i < num_upd; i++)
+        expected[offsets[i]] = offsets[i];
+    start = gmt_timer();
+    for (i = 0; i < num_upd; i++)
+        gmt_put_value_nb(array, offsets[i], offsets[i]);
+    gmt_wait_data();
+    end = gmt_timer();
+    print_time("put_value_nb", nn, num_upd, 1, end - start,
+               check(array, expected, total));
+
+    /* and then with its complement */
+    uint64_t *values = (uint64_t *) malloc(num_upd * sizeof(uint64_t));
+    for (i = 0; i < num_upd; i++) {
+        values[i] = ~offsets[i];
+        expected[offsets[i]] = ~offsets[i];
+    }
+    start = gmt_timer();
+    for (i = 0; i < num_upd; i += batch) {
+        uint64_t n = (num_upd - i < batch) ? num_upd - i : batch;
+        gmt_scatter_nb(array, &offsets[i], &values[i], n);
+    }
+    gmt_wait_data();
+    end = gmt_timer();
+    print_time("scatter_nb", nn, num_upd, batch, end - start,
+               check(array, expected, total));
+
+    free(values);
+    free(offsets);
+    free(ones);
+    free(expected);
+    gmt_free(array);
+    return 0;
+}
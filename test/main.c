@@ -82,6 +82,15 @@ void usage() {
     printf ( " %s -b atomic_cas -i <iterations> -n <operations per iteration> -c <elem size>  \n",glob.prog_name );
     printf ( " %s -b yield      -i <iterations> -n <operations per iteration> -c <elem size>  \n",glob.prog_name );
     printf ( " %s -b memcpy      -i <iterations> -n <operations per iteration> -c <chunk size>  \n",glob.prog_name );
+    printf ( " %s -b custom_dist  -i <iterations> -n <elements per node per iteration>\n",glob.prog_name );
+    printf ( " %s -b gather       -i <iterations> -n <elements per iteration> -c 8\n",glob.prog_name );
+    printf ( " %s -b gather_range -i <iterations> -n <elements per iteration> -c 8 (fails on purpose)\n",glob.prog_name );
+    printf ( " %s -b scatter      -i <iterations> -n <elements per iteration> -c 8\n",glob.prog_name );
+    printf ( " %s -b scatter_range -i <iterations> -n <elements per iteration> -c 8 (fails on purpose)\n",glob.prog_name );
+    printf ( " %s -b atomic_op    -i <iterations> -n <operations per iteration> -c 8\n",glob.prog_name );
+    printf ( " %s -b nofetch      -i <iterations> -n <operations per iteration> -c 8\n",glob.prog_name );
+    printf ( " %s -b attach       -i <iterations> -n <allocations per iteration>\n",glob.prog_name );
+    printf ( " %s -b hugepage     -i <iterations> -n <allocations per iteration> -c <bytes per node>\n",glob.prog_name );
     printf ( "\n Optional arguments:\n" );
     printf("-k <num non-blocking operations> (number of NB operations before calling a wait\n");
     printf("-a <alloc policy> (GMT_ALLOC_LOCAL, GMT_ALLOC_PARTITION, GMT_ALLOC_RANDOM or GMT_ALLOC_REMOTE)\n");
@@ -110,6 +119,8 @@ void alloc_type_str(alloc_type_t a, char * str){
         strcpy(str, "GMT_ALLOC_REMOTE");
     else if (a == GMT_ALLOC_REPLICATE)
         strcpy(str, "GMT_ALLOC_REPLICATE");
+    else if (a == GMT_ALLOC_BLOCK_CYCLIC)
+        strcpy(str, "GMT_ALLOC_BLOCK_CYCLIC");
     else if (a == GMT_ALLOC_ZERO)
         strcpy(str, "GMT_ALLOC_ZERO");
     else if (a == GMT_ALLOC_RAM)
@@ -211,6 +222,24 @@ void test_parse_args ( int argc, char** argv ) {
                     glob.test_num=TEST_FOR_EACH;
                 } else if ( strcmp ( optarg, "execute_on_node") ==0) {
                     glob.test_num=TEST_EXECUTE_ON_NODE;
+                } else if ( strcmp ( optarg, "custom_dist") ==0) {
+                    glob.test_num=TEST_CUSTOM_DIST;
+                } else if ( strcmp ( optarg, "gather") ==0) {
+                    glob.test_num=TEST_GATHER;
+                } else if ( strcmp ( optarg, "gather_range") ==0) {
+                    glob.test_num=TEST_GATHER_RANGE;
+                } else if ( strcmp ( optarg, "scatter") ==0) {
+                    glob.test_num=TEST_SCATTER;
+                } else if ( strcmp ( optarg, "scatter_range") ==0) {
+                    glob.test_num=TEST_SCATTER_RANGE;
+                } else if ( strcmp ( optarg, "atomic_op") ==0) {
+                    glob.test_num=TEST_ATOMIC_OP;
+                } else if ( strcmp ( optarg, "nofetch") ==0) {
+                    glob.test_num=TEST_NOFETCH;
+                } else if ( strcmp ( optarg, "attach") ==0) {
+                    glob.test_num=TEST_ATTACH;
+                } else if ( strcmp ( optarg, "hugepage") ==0) {
+                    glob.test_num=TEST_HUGEPAGE;
                 }
                    else {
                     printf ( "\nERROR: test not recognized\n" );
@@ -279,6 +308,8 @@ void test_parse_args ( int argc, char** argv ) {
                     glob.alloc_type=GMT_ALLOC_REMOTE;
                 } else if ( strcmp ( optarg,"GMT_ALLOC_REPLICATE" ) ==0 ) {
                     glob.alloc_type=GMT_ALLOC_REPLICATE;
+                } else if ( strcmp ( optarg,"GMT_ALLOC_BLOCK_CYCLIC" ) ==0 ) {
+                    glob.alloc_type=GMT_ALLOC_BLOCK_CYCLIC;
                 } else if ( strcmp ( optarg,"GMT_ALLOC_ZERO" ) ==0 ) {
                     glob.alloc_type=GMT_ALLOC_ZERO;
                 } else if ( strcmp ( optarg,"GMT_ALLOC_RAM" ) ==0 ) {
@@ -384,7 +415,10 @@ void alloc_func(const void* _arg, uint32_t sz, void* _ret, uint32_t* _retsize, g
 
   if( arg->test_num != TEST_ALLOC
       && arg->test_num !=TEST_YIELD
-      && arg->test_num !=TEST_FILE_WRITE){
+      && arg->test_num !=TEST_FILE_WRITE
+      && arg->test_num !=TEST_HUGEPAGE
+      && arg->test_num !=TEST_ATTACH
+      && arg->test_num !=TEST_CUSTOM_DIST){
     /* allocate gdata because most tests need it*/
     TestUtils_allocateElems(arg->elem_bytes, node_alloc_size, dataset_size,
                             arg->num_iterations,arg->random_elems, arg->random_offsets, &info);
@@ -421,7 +455,10 @@ void free_func(const void* _arg, uint32_t sz, void* _ret, uint32_t* _retsize, gm
 
   if( arg->test_num != TEST_ALLOC
       && arg->test_num !=TEST_YIELD
-      && arg->test_num !=TEST_FILE_WRITE ){
+      && arg->test_num !=TEST_FILE_WRITE
+      && arg->test_num !=TEST_HUGEPAGE
+      && arg->test_num !=TEST_ATTACH
+      && arg->test_num !=TEST_CUSTOM_DIST ){
     /*each node frees its gdata*/
     gmt_free(info.gdata);
     TestUtils_freeElems(&info);
@@ -464,6 +501,10 @@ void perform_tests(){
     arg.alloc_type = glob.alloc_type;
     arg.preempt_policy = glob.preempt_policy;
     arg.spawn_policy = glob.spawn_policy;
+    /* distributions are registered once, there is a limit per node */
+    arg.dist = 0;
+    if (glob.test_num == TEST_CUSTOM_DIST)
+        arg.dist = test_register_dist();
 
     printf("******************* GMT test results ****************\n");
 
@@ -525,6 +566,33 @@ void perform_tests(){
         case TEST_EXECUTE_ON_NODE:
               DO_TEST (test_execute_on_node, &arg, sizeof(arg));
             break;
+        case TEST_CUSTOM_DIST:
+              DO_TEST (test_custom_dist, &arg, sizeof(arg));
+            break;
+        case TEST_GATHER:
+              DO_TEST (test_gather, &arg, sizeof(arg));
+            break;
+        case TEST_GATHER_RANGE:
+              DO_TEST (test_gather_range, &arg, sizeof(arg));
+            break;
+        case TEST_SCATTER:
+              DO_TEST (test_scatter, &arg, sizeof(arg));
+            break;
+        case TEST_SCATTER_RANGE:
+              DO_TEST (test_scatter_range, &arg, sizeof(arg));
+            break;
+        case TEST_ATOMIC_OP:
+              DO_TEST (test_atomic_op, &arg, sizeof(arg));
+            break;
+        case TEST_NOFETCH:
+              DO_TEST (test_nofetch, &arg, sizeof(arg));
+            break;
+        case TEST_ATTACH:
+              DO_TEST (test_attach, &arg, sizeof(arg));
+            break;
+        case TEST_HUGEPAGE:
+              DO_TEST (test_hugepage, &arg, sizeof(arg));
+            break;
         default:
             usage();
     }
@@ -88,6 +88,15 @@ typedef enum {
     TEST_FILE_WRITE,
     TEST_FOR_EACH,
     TEST_EXECUTE_ON_NODE,
+    TEST_CUSTOM_DIST,
+    TEST_GATHER,
+    TEST_GATHER_RANGE,
+    TEST_SCATTER,
+    TEST_SCATTER_RANGE,
+    TEST_ATOMIC_OP,
+    TEST_NOFETCH,
+    TEST_ATTACH,
+    TEST_HUGEPAGE,
     TEST_ALL
 } test_type_t;
 
@@ -131,6 +140,7 @@ typedef struct arg_tag {
     uint64_t num_elems;
     uint64_t allocated_elements;
     gmt_data_t glocal;
+    gmt_dist_t dist;
 } arg_t;
 
 typedef struct exec_args_tag{
@@ -197,6 +207,16 @@ void test_local_ptr ( uint64_t iter_id, uint64_t num, const void * args, gmt_han
 void test_yield ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
 void test_alloc ( uint64_t it, uint64_t num, const void *args, gmt_handle_t handle);
 void test_memcpy ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_hugepage ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_attach ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_nofetch ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_atomic_op ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_scatter_range ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_scatter ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_gather_range ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+void test_gather ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
+gmt_dist_t test_register_dist();
+void test_custom_dist ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle);
 
 #endif
 
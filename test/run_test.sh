@@ -64,6 +64,29 @@ function do_test()
     done
 }
 
+# runs tests that must be stopped by GMT with an error containing 
+# $expected_error (e.g. out of range accesses)
+function do_error_test()
+{
+    LAUNCHER="mpirun -n $nodes -npernode 1"
+    for test_name in $test_names; do
+        echo "Running test $test_name (expecting an error)"
+        for alloc_policy in $alloc_policies; do
+            cmd="$LAUNCHER ./gmttest -b $test_name -i $num_iterations -n $num_oper_per_iter -c $chunk_sizes -s GMT_SPAWN_LOCAL -a $alloc_policy $gmt_opt "$mode
+            echo -n $cmd
+            $cmd &> tmp.out
+            return_code=$?
+            if [ "$return_code" -eq "0" ] || ! grep -q "$expected_error" tmp.out; then
+                echo -e '\n\n' "Test NOT PASSED! (error not reported)" '\n\n'
+                cat tmp.out
+                exit
+            fi
+            echo " ...error reported"
+        done
+        echo -e '\n\n' "Test PASSED!!!!" '\n\n'
+    done
+}
+
 nodes=$1;
 
 mode=""
@@ -83,22 +106,60 @@ do_test
 
 test_names="for_each" 
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
-alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_BLOCK_CYCLIC"
 preempt_policies="NA"
 num_iterations="$(($nodes))"
 num_oper_per_iter="128"
 chunk_sizes="8"
 do_test
 
+test_names="custom_dist"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*$nodes))"
+num_oper_per_iter="64"
+chunk_sizes="8"
+do_test
+
 test_names="alloc" 
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
-alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
 preempt_policies="NA"
 num_iterations="$(($NUM_WORKERS*MAX_TASK_PER_WORKER-1))"
 num_oper_per_iter="128"
 chunk_sizes="10240 64"
 do_test
 
+# keep SHM huge page arrays on hugetlbfs when a mount exists, otherwise they
+# fall back to transparent or normal pages
+hugetlbfs_path=`awk '$3 == "hugetlbfs" { print $2; exit }' /proc/mounts`
+gmt_opt_saved=$gmt_opt
+if [ "$hugetlbfs_path" != "" ]; then
+    gmt_opt="$gmt_opt --gmt_hugetlbfs_path $hugetlbfs_path --gmt_state_name gmttest_hugepage_$$ --gmt_state_rw"
+fi
+test_names="hugepage"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*2))"
+num_oper_per_iter="4"
+chunk_sizes="4096 2097152"
+do_test
+gmt_opt=$gmt_opt_saved
+if [ "$hugetlbfs_path" != "" ]; then
+    rm -rf $hugetlbfs_path/GMT_STATES/gmttest_hugepage_$$ /dev/shm/GMT_STATES.gmttest_hugepage_$$.*
+fi
+
+test_names="attach"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*MAX_TASK_PER_WORKER-1))"
+num_oper_per_iter="16"
+chunk_sizes="64"
+do_test
+
 test_names="for_loop_whandle for_loop for_loop_nested"
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
 alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE"
@@ -119,13 +180,23 @@ do_test
 
 test_names="yield putvalue atomic_add atomic_cas"
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
-alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
 preempt_policies="NA"
 num_iterations="$(($NUM_WORKERS*MAX_TASK_PER_WORKER-1))" # 4096 1024"
 num_oper_per_iter="32"
 chunk_sizes="8"
 do_test
 
+# extended and non-fetching atomics are not valid on replicated arrays
+test_names="atomic_op nofetch"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_BLOCK_CYCLIC"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*$nodes))"
+num_oper_per_iter="32"
+chunk_sizes="8"
+do_test
+
 test_names="memcpy" 
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
 alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE"
@@ -135,9 +206,31 @@ num_oper_per_iter="32"
 chunk_sizes="1024 8"
 do_test
 
+test_names="gather"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*$nodes))"
+num_oper_per_iter="64"
+chunk_sizes="8"
+do_test
+
+# scatter-add is an atomic, not valid on replicated arrays
+test_names="scatter"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_BLOCK_CYCLIC"
+do_test
+
+test_names="gather_range scatter_range"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_REMOTE GMT_ALLOC_BLOCK_CYCLIC"
+num_iterations="1"
+num_oper_per_iter="64"
+chunk_sizes="8"
+expected_error="Trying to access byte"
+do_error_test
+
 test_names="get put" 
 spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_PARTITION_FROM_ZERO GMT_SPAWN_PARTITION_FROM_RANDOM GMT_SPAWN_PARTITION_FROM_HERE GMT_SPAWN_SPREAD"
-alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_PARTITION_FROM_RANDOM GMT_ALLOC_PARTITION_FROM_HERE GMT_ALLOC_REMOTE GMT_ALLOC_REPLICATE GMT_ALLOC_BLOCK_CYCLIC"
 preempt_policies="NA"
 num_iterations="$(($NUM_WORKERS*MAX_TASK_PER_WORKER-1))"
 num_oper_per_iter="32"
@@ -153,5 +246,19 @@ num_oper_per_iter="8"
 chunk_sizes="128"
 do_test
 
+# replies, acks and handle checks over an emulated network, control buffers
+# must not wait behind the bulk data of the same link
+gmt_opt_saved=$gmt_opt
+gmt_opt="$gmt_opt --gmt_emu_latency 20000 --gmt_emu_ticks_per_kb 2000"
+test_names="putvalue atomic_add get put for_loop_whandle"
+spawn_policies="GMT_SPAWN_LOCAL GMT_SPAWN_REMOTE GMT_SPAWN_SPREAD"
+alloc_policies="GMT_ALLOC_PARTITION_FROM_ZERO GMT_ALLOC_REMOTE"
+preempt_policies="NA"
+num_iterations="$(($NUM_WORKERS*$nodes))"
+num_oper_per_iter="32"
+chunk_sizes="1024 8"
+do_test
+gmt_opt=$gmt_opt_saved
+
 exit
 #
@@ -71,3 +71,78 @@ void test_alloc ( uint64_t iter_id, uint64_t num_it, const void * args, gmt_hand
     }
 }
 
+
+/* a named array must not be found by gmt_attach() once freed and the name
+ * must resolve to the new array when it is allocated again */
+void test_attach ( uint64_t iter_id, uint64_t num_it, const void * args, gmt_handle_t handle ) {
+    _unused(num_it); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    char name[64];
+    uint64_t n;
+    snprintf(name, sizeof(name), "gmttest_attach_%u_%lu", node_id, iter_id);
+    for(n = 0; n < arg->num_oper; n++){
+        uint64_t value = iter_id * arg->num_oper + n;
+        uint64_t data = 0;
+        gmt_data_t ga = gmt_alloc(num_nodes, sizeof(uint64_t), arg->alloc_type, name);
+        TEST(gmt_attach(name) == ga);
+        gmt_put(ga, n % num_nodes, &value, 1);
+        gmt_free(ga);
+        TEST(gmt_attach(name) == GMT_DATA_NULL);
+
+        gmt_data_t ga_new = gmt_alloc(num_nodes, sizeof(uint64_t),
+                                      (alloc_type_t) (arg->alloc_type | GMT_ALLOC_ZERO), name);
+        gmt_data_t gat = gmt_attach(name);
+        TEST(gat == ga_new);
+        if( arg->check ){
+            /* the old contents must not leak into the new array */
+            gmt_get(gat, n % num_nodes, &data, 1);
+            TEST(data == 0);
+            gmt_put(gat, n % num_nodes, &value, 1);
+            gmt_get(ga_new, n % num_nodes, &data, 1);
+            TEST(data == value);
+        }
+        gmt_free(ga_new);
+        TEST(gmt_attach(name) == GMT_DATA_NULL);
+    }
+}
+
+/* huge page arrays in RAM and in SHM (on hugetlbfs when the process runs
+ * with --gmt_hugetlbfs_path and a writable state, falling back to 
+ * transparent or normal pages otherwise) are zeroed, usable and freed */
+void test_hugepage ( uint64_t iter_id, uint64_t num_it, const void * args, gmt_handle_t handle ) {
+    _unused(num_it); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    uint64_t nelems = MAX(arg->elem_bytes / sizeof(uint64_t), 1) * num_nodes;
+    uint64_t *values = (uint64_t *) malloc(nelems * sizeof(uint64_t));
+    char name[64];
+    uint64_t n, i;
+    for(n = 0; n < arg->num_oper; n++){
+        int media;
+        for (media = 0; media < 2; media++) {
+            int type = arg->alloc_type | GMT_ALLOC_HUGEPAGE | GMT_ALLOC_ZERO;
+            gmt_data_t ga;
+            if (media == 0) {
+                ga = gmt_alloc(nelems, sizeof(uint64_t), (alloc_type_t) type, NULL);
+            } else {
+                snprintf(name, sizeof(name), "gmttest_hugepage_%u_%lu_%lu",
+                         node_id, iter_id, n);
+                ga = gmt_alloc(nelems, sizeof(uint64_t),
+                               (alloc_type_t) (type | GMT_ALLOC_SHM), name);
+            }
+            if( arg->check ){
+                gmt_get(ga, 0, values, nelems);
+                for (i = 0; i < nelems; i++)
+                    TEST(values[i] == 0);
+                for (i = 0; i < nelems; i++)
+                    values[i] = iter_id * nelems + i;
+                gmt_put(ga, 0, values, nelems);
+                memset(values, 0, nelems * sizeof(uint64_t));
+                gmt_get(ga, 0, values, nelems);
+                for (i = 0; i < nelems; i++)
+                    TEST(values[i] == iter_id * nelems + i);
+            }
+            gmt_free(ga);
+        }
+    }
+    free(values);
+}
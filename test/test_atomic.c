@@ -104,3 +104,119 @@ void test_atomic_add ( uint64_t iter_id, uint64_t num, const void * args, gmt_ha
 
 
 }
+
+/* each element of the task goes through every extended atomic, the value
+ * returned by each operation is the result of the previous one */
+void test_atomic_op ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1); 
+
+    uint64_t idx = iter_id % arg->num_iterations;
+    int64_t check_value = node_id+info.gdata+TEST_ATOMIC_OP;
+    const atomic_op_t ops[] = { GMT_ATOMIC_AND, GMT_ATOMIC_OR, GMT_ATOMIC_XOR,
+        GMT_ATOMIC_MIN, GMT_ATOMIC_MAX, GMT_ATOMIC_MIN, GMT_ATOMIC_SWAP };
+    const uint32_t num_ops = sizeof(ops) / sizeof(ops[0]);
+
+    uint64_t i;
+    for (i = 0; i < info.nElemsPerTask; i++) {
+        uint64_t offset = (idx*info.nElemsPerTask+i);
+        int64_t v = check_value + (int64_t) i;
+        const int64_t operands[] = { ~(int64_t) 0x5, 0x30, 0x11, v + 7, -3,
+            -(v << 2), v * 3 };
+        gmt_put_value_nb( info.gdata, offset, v);
+        gmt_wait_data();
+
+        /* blocking */
+        uint32_t k;
+        for (k = 0; k < num_ops; k++) {
+            int64_t old = gmt_atomic_op(info.gdata, offset, ops[k], operands[k]);
+            if(arg->check)
+                TEST(old == v);
+            switch (ops[k]) {
+            case GMT_ATOMIC_AND: v &= operands[k]; break;
+            case GMT_ATOMIC_OR: v |= operands[k]; break;
+            case GMT_ATOMIC_XOR: v ^= operands[k]; break;
+            case GMT_ATOMIC_MIN: v = MIN(v, operands[k]); break;
+            case GMT_ATOMIC_MAX: v = MAX(v, operands[k]); break;
+            default: v = operands[k]; break;
+            }
+        }
+
+        /* non-blocking, ops on the same element are applied in order */
+        int64_t rets[2];
+        gmt_atomic_op_nb(info.gdata, offset, GMT_ATOMIC_XOR, 0xff, &rets[0]);
+        gmt_atomic_op_nb(info.gdata, offset, GMT_ATOMIC_SWAP, v, &rets[1]);
+        gmt_wait_data();
+        if(arg->check)
+            TEST(rets[0] == v && rets[1] == (v ^ 0xff));
+
+        /* floating point add on the bits of a double */
+        double d = 1.5 + (double) i;
+        int64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        gmt_put_value_nb( info.gdata, offset, bits);
+        gmt_wait_data();
+        double old_d = gmt_atomic_fadd(info.gdata, offset, 2.25);
+        double ret_d = 0;
+        gmt_atomic_fadd_nb(info.gdata, offset, -0.5, &ret_d);
+        gmt_wait_data();
+        if(arg->check){
+            TEST(old_d == d && ret_d == d + 2.25);
+            gmt_get(info.gdata, offset, &bits, 1);
+            memcpy(&old_d, &bits, sizeof(bits));
+            TEST(old_d == d + 1.75);
+        }
+    }
+}
+
+/* non-fetching operations must be visible to a gmt_get() issued after
+ * gmt_quiet() (or gmt_wait_data()) returns */
+void test_nofetch ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1); 
+
+    uint64_t idx = iter_id % arg->num_iterations;
+    uint64_t base = idx * info.nElemsPerTask;
+    uint64_t n = info.nElemsPerTask;
+    int64_t check_value = node_id+info.gdata+TEST_NOFETCH;
+    int64_t *values = (int64_t *) malloc(n * sizeof(int64_t));
+    uint64_t i;
+
+    for (i = 0; i < n; i++)
+        gmt_put_value_nofetch_nb(info.gdata, base + i, check_value + i);
+    gmt_quiet();
+    if(arg->check){
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == check_value + (int64_t) i);
+    }
+
+    /* several updates on the same element */
+    uint32_t r;
+    for (r = 0; r < 3; r++)
+        for (i = 0; i < n; i++)
+            gmt_atomic_add_nofetch_nb(info.gdata, base + i, (int64_t) r + 1);
+    gmt_quiet();
+    if(arg->check){
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == check_value + (int64_t) i + 6);
+    }
+
+    /* completion through gmt_wait_data() */
+    for (i = 0; i < n; i += 2)
+        gmt_atomic_op_nofetch_nb(info.gdata, base + i, GMT_ATOMIC_MAX,
+                                 check_value + 1000);
+    gmt_wait_data();
+    if(arg->check){
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == (i % 2 == 0 ? check_value + 1000 :
+                               check_value + (int64_t) i + 6));
+    }
+    free(values);
+}
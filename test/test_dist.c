@@ -0,0 +1,162 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "main.h"
+
+/* Pairs of blocks are dealt round robin starting from the last node, so
+ * owners, local indexes and per-node counts all differ from what 
+ * GMT_ALLOC_BLOCK_CYCLIC would give */
+static uint32_t rev_owner(uint64_t block, uint64_t num_blocks, uint32_t nn)
+{
+    _unused(num_blocks);
+    return nn - 1 - (uint32_t) ((block / 2) % nn);
+}
+
+static uint64_t rev_local_block(uint64_t block, uint64_t num_blocks,
+                                uint32_t nn)
+{
+    _unused(num_blocks);
+    return (block / 2 / nn) * 2 + block % 2;
+}
+
+static uint64_t rev_global_block(uint32_t nid, uint64_t lblock,
+                                 uint64_t num_blocks, uint32_t nn)
+{
+    _unused(num_blocks);
+    return ((lblock / 2) * nn + (nn - 1 - nid)) * 2 + lblock % 2;
+}
+
+static uint64_t rev_num_local_blocks(uint32_t nid, uint64_t num_blocks,
+                                     uint32_t nn)
+{
+    uint64_t pairs = (num_blocks + 1) / 2;
+    uint32_t first_pair = nn - 1 - nid;
+    if (pairs <= first_pair)
+        return 0;
+    uint64_t n = ((pairs - first_pair - 1) / nn + 1) * 2;
+    /* the last pair has a single block */
+    if (num_blocks % 2 == 1 && (pairs - 1) % nn == first_pair)
+        n--;
+    return n;
+}
+
+gmt_dist_t test_register_dist() {
+    gmt_dist_funcs_t funcs;
+    funcs.owner = rev_owner;
+    funcs.local_block = rev_local_block;
+    funcs.global_block = rev_global_block;
+    funcs.num_local_blocks = rev_num_local_blocks;
+    return gmt_register_dist(&funcs);
+}
+
+typedef struct dist_args_tag {
+    gmt_data_t ga;
+    uint64_t num_elems;
+    uint64_t block_elems;
+    uint64_t control_value;
+} dist_args_t;
+
+static uint32_t elem_owner(const dist_args_t * d, uint64_t elem) {
+    uint64_t num_blocks = (d->num_elems + d->block_elems - 1) / d->block_elems;
+    return rev_owner(elem / d->block_elems, num_blocks, num_nodes);
+}
+
+/* runs on the owner of [start_el, start_el + num_el) */
+void dist_for_each_body(gmt_data_t data, uint64_t start_el, uint64_t num_el,
+                        const void *args, gmt_handle_t handle) {
+    _unused(handle);
+    const dist_args_t *d = (const dist_args_t *) args;
+    uint64_t i;
+    for (i = start_el; i < start_el + num_el; i++) {
+        TEST(elem_owner(d, i) == node_id);
+        uint64_t *ptr = (uint64_t *) gmt_get_local_ptr(data, i);
+        TEST(ptr != NULL);
+        TEST(*ptr == d->control_value + i);
+        (*ptr)++;
+    }
+}
+
+/* every node holds exactly the elements the distribution gives it */
+void dist_check_local(const void *args, uint32_t args_size, void *ret,
+                      uint32_t * ret_size, gmt_handle_t handle) {
+    _unused(args_size); _unused(ret); _unused(ret_size); _unused(handle);
+    const dist_args_t *d = (const dist_args_t *) args;
+    uint64_t i, local = 0;
+    for (i = 0; i < d->num_elems; i++) {
+        bool mine = elem_owner(d, i) == node_id;
+        TEST((gmt_get_local_ptr(d->ga, i) != NULL) == mine);
+        if (mine)
+            local++;
+    }
+    TEST(gmt_count_local_elements(d->ga) == local);
+}
+
+void test_custom_dist ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+
+    /* vary the block size and leave a partial last block */
+    dist_args_t d;
+    d.block_elems = 1 + iter_id % 5;
+    d.num_elems = arg->num_oper * num_nodes + iter_id % 7;
+    d.control_value = CONTROL_VALUE;
+    d.ga = gmt_alloc_custom(d.num_elems, sizeof(uint64_t), d.block_elems,
+                            arg->dist, GMT_ALLOC_ZERO, NULL);
+
+    uint64_t i;
+    uint64_t *values = (uint64_t *) malloc(d.num_elems * sizeof(uint64_t));
+    for (i = 0; i < d.num_elems; i++)
+        values[i] = d.control_value + i;
+    gmt_put(d.ga, 0, values, d.num_elems);
+
+    if (arg->check) {
+        memset(values, 0, d.num_elems * sizeof(uint64_t));
+        gmt_get(d.ga, 0, values, d.num_elems);
+        for (i = 0; i < d.num_elems; i++)
+            TEST(values[i] == d.control_value + i);
+    }
+
+    /* each element is visited once, on its owner */
+    gmt_for_each(d.ga, 4, 0, d.num_elems, dist_for_each_body, &d, sizeof(d));
+
+    if (arg->check) {
+        gmt_get(d.ga, 0, values, d.num_elems);
+        for (i = 0; i < d.num_elems; i++)
+            TEST(values[i] == d.control_value + i + 1);
+        gmt_execute_on_all(dist_check_local, &d, sizeof(d), GMT_PREEMPTABLE);
+    }
+
+    free(values);
+    gmt_free(d.ga);
+}
@@ -0,0 +1,98 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "main.h"
+
+/* elements of the task are read in a shuffled order that also repeats 
+ * some of them */
+void test_gather ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1);
+
+    uint64_t idx = iter_id % arg->num_iterations;
+    uint64_t base = idx * info.nElemsPerTask;
+    uint64_t check_value = node_id + info.gdata + TEST_GATHER;
+
+    uint64_t i;
+    if(arg->check){ /* put check values */
+        for (i = 0; i < info.nElemsPerTask; i++)
+            gmt_put_value_nb(info.gdata, base + i, check_value + base + i);
+        gmt_wait_data();
+    }
+
+    uint64_t *offsets = (uint64_t *) malloc(info.nElemsPerTask * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *) malloc(info.nElemsPerTask * sizeof(uint64_t));
+    for (i = 0; i < info.nElemsPerTask; i++)
+        offsets[i] = base + (i * 7 + idx) % info.nElemsPerTask;
+
+    /* non-blocking gathers of arg->non_blocking elements, then one 
+     * blocking gather of all of them */
+    uint64_t done = 0;
+    while (done < info.nElemsPerTask) {
+        uint64_t n = MIN(arg->non_blocking, info.nElemsPerTask - done);
+        gmt_gather_nb(info.gdata, offsets + done, n, values + done);
+        done += n;
+    }
+    gmt_wait_data();
+    if(arg->check){
+        for (i = 0; i < info.nElemsPerTask; i++)
+            TEST(values[i] == check_value + offsets[i]);
+        memset(values, 0, info.nElemsPerTask * sizeof(uint64_t));
+    }
+
+    gmt_gather(info.gdata, offsets, info.nElemsPerTask, values);
+    if(arg->check){
+        for (i = 0; i < info.nElemsPerTask; i++)
+            TEST(values[i] == check_value + offsets[i]);
+    }
+
+    free(offsets);
+    free(values);
+}
+
+/* an index one past the end must be reported by the calling node, 
+ * run_test.sh expects this test to fail */
+void test_gather_range ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(iter_id); _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1);
+
+    uint64_t offsets[2] = { 0, info.nElems };
+    uint64_t values[2];
+    gmt_gather(info.gdata, offsets, 2, values);
+    TEST(false);
+}
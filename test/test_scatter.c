@@ -0,0 +1,118 @@
+/*
+ * Global Memory and Threading (GMT)
+ *
+ * Copyright © 2018, Battelle Memorial Institute
+ * All rights reserved.
+ *
+ * Battelle Memorial Institute (hereinafter Battelle) hereby grants permission to
+ * any person or entity lawfully obtaining a copy of this software and associated
+ * documentation files (hereinafter “the Software”) to redistribute and use the
+ * Software in source and binary forms, with or without modification.  Such
+ * person or entity may use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and may permit others to do
+ * so, subject to the following conditions:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name `Battelle Memorial Institute` or `Battelle` may be used in
+ *    any form whatsoever without the express written consent of `Battelle`.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL `BATTELLE` OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "main.h"
+
+/* elements of the task are written in reverse order, then incremented
+ * with scatter-adds that hit some of them more than once */
+void test_scatter ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1);
+
+    uint64_t idx = iter_id % arg->num_iterations;
+    uint64_t base = idx * info.nElemsPerTask;
+    uint64_t n = info.nElemsPerTask;
+    uint64_t check_value = node_id + info.gdata + TEST_SCATTER;
+
+    uint64_t *offsets = (uint64_t *) malloc(n * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *) malloc(n * sizeof(uint64_t));
+    int64_t *incs = (int64_t *) malloc(n * sizeof(int64_t));
+    uint64_t *hits = (uint64_t *) calloc(n, sizeof(uint64_t));
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        offsets[i] = base + n - 1 - i;
+        values[i] = check_value + offsets[i];
+    }
+    uint64_t done = 0;
+    while (done < n) {
+        uint64_t k = MIN(arg->non_blocking, n - done);
+        gmt_scatter_nb(info.gdata, offsets + done, values + done, k);
+        done += k;
+    }
+    gmt_wait_data();
+
+    if(arg->check){
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == check_value + base + i);
+    }
+
+    for (i = 0; i < n; i++) {
+        offsets[i] = base + (i * 7 + idx) % n;
+        incs[i] = (int64_t) (i % 3) + 1;
+        hits[offsets[i] - base] += incs[i];
+    }
+    gmt_scatter_add(info.gdata, offsets, incs, n);
+
+    if(arg->check){
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == check_value + base + i + hits[i]);
+    }
+
+    /* blocking scatter restores the written values */
+    for (i = 0; i < n; i++) {
+        offsets[i] = base + i;
+        values[i] = check_value + base + i;
+    }
+    gmt_scatter(info.gdata, offsets, values, n);
+    if(arg->check){
+        memset(values, 0, n * sizeof(uint64_t));
+        gmt_get(info.gdata, base, values, n);
+        for (i = 0; i < n; i++)
+            TEST(values[i] == check_value + base + i);
+    }
+
+    free(offsets);
+    free(values);
+    free(incs);
+    free(hits);
+}
+
+/* an index one past the end must be reported by the calling node, 
+ * run_test.sh expects this test to fail */
+void test_scatter_range ( uint64_t iter_id, uint64_t num, const void * args, gmt_handle_t handle ) {
+    _unused(iter_id); _unused(num); _unused(handle);
+    arg_t *arg = ( arg_t* ) args;
+    elemsInfo_t info;
+    gmt_get(arg->ginfo,node_id,&info, 1);
+
+    uint64_t offsets[2] = { 0, info.nElems };
+    uint64_t values[2] = { 0, 0 };
+    gmt_scatter(info.gdata, offsets, values, 2);
+    TEST(false);
+}